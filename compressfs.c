@@ -0,0 +1,243 @@
+/* compressfs - writes the compressed variant of a createfs image
+ *
+ * Build on the host with   gcc -O2 -o compressfs compressfs.c
+ * and run                  ./compressfs [-c] [-u] student-distrib/filesys_img filesys_img.lz
+ *
+ * The boot block and the inodes are copied as they are. The data blocks are
+ * each compressed on their own with LZ4, so the kernel can unpack any block
+ * without the ones before it. The layout is described with image_header_t
+ * in student-distrib/file_system.h.
+ *
+ *   -c  store the CRC-32 of every file in its directory entry, the kernel
+ *       checks them at mount (which reads every file of the image)
+ *   -u  leave the data blocks uncompressed
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_SIZE      4096
+#define IMAGE_MAGIC     0x315A4C46  /* LZ_IMAGE_MAGIC */
+#define CHECKSUM_MAGIC  0x4D555343  /* CHECKSUM_MAGIC */
+#define HEADER_OFFSET   12          /* reserved bytes of the boot block */
+#define DENTRY_OFFSET   64          /* first directory entry */
+#define DENTRY_SIZE     64
+#define MAX_DENTRIES    63
+#define FILE_TYPE_FILE  2
+#define EXTENT_MAGIC    0xE47E4701  /* EXTENT_INODE_MAGIC */
+#define LEGACY_BLOCKS   1023
+#define HASH_BITS       12
+#define MIN_MATCH       4
+#define LAST_LITERALS   5           /* the LZ4 format ends a block with literals */
+#define MATCH_LIMIT     12          /* no match starts this close to the end */
+
+static uint32_t
+read32 (const uint8_t* p)
+{
+    uint32_t v;
+    memcpy (&v, p, 4);
+    return v;
+}
+
+static uint8_t*
+put_length (uint8_t* op, uint32_t len)
+{
+    for (; len >= 255; len -= 255)
+	*op++ = 255;
+    *op++ = len;
+    return op;
+}
+
+static uint8_t*
+put_sequence (uint8_t* op, const uint8_t* lit, uint32_t lit_len, uint32_t offset, uint32_t match_len)
+{
+    uint8_t* token = op++;
+
+    *token = (lit_len >= 15 ? 15 : lit_len) << 4;
+    if (lit_len >= 15)
+	op = put_length (op, lit_len - 15);
+    memcpy (op, lit, lit_len);
+    op += lit_len;
+    if (match_len == 0)
+	return op;
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    match_len -= MIN_MATCH;
+    *token |= (match_len >= 15 ? 15 : match_len);
+    if (match_len >= 15)
+	op = put_length (op, match_len - 15);
+    return op;
+}
+
+/* Greedy LZ4 with a hash table of the last position of every 4-byte prefix,
+ * returns the compressed length */
+static uint32_t
+compress_block (const uint8_t* src, uint32_t len, uint8_t* dst)
+{
+    int32_t table[1 << HASH_BITS];
+    const uint8_t* anchor = src;
+    const uint8_t* ip = src;
+    const uint8_t* end = src + len;
+    uint8_t* op = dst;
+    uint32_t h, mlen;
+    int32_t ref;
+
+    memset (table, -1, sizeof (table));
+    while (len > MATCH_LIMIT && ip < end - MATCH_LIMIT) {
+	h = (read32 (ip) * 2654435761u) >> (32 - HASH_BITS);
+	ref = table[h];
+	table[h] = ip - src;
+	if (ref < 0 || ip - (src + ref) > 0xFFFF || read32 (src + ref) != read32 (ip)) {
+	    ip++;
+	    continue;
+	}
+	for (mlen = MIN_MATCH; ip + mlen < end - LAST_LITERALS && src[ref + mlen] == ip[mlen]; mlen++);
+	op = put_sequence (op, anchor, ip - anchor, ip - (src + ref), mlen);
+	ip += mlen;
+	anchor = ip;
+    }
+    return put_sequence (op, anchor, end - anchor, 0, 0) - dst;
+}
+
+static uint32_t
+crc32 (uint32_t crc, const uint8_t* p, uint32_t n)
+{
+    uint32_t j;
+
+    crc = ~crc;
+    while (n-- > 0) {
+	crc ^= *p++;
+	for (j = 0; j < 8; j++)
+	    crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+/* Stores the checksum of every regular file in its directory entry,
+ * returns -1 if a file has a block outside the image */
+static int
+add_checksums (uint8_t* image, uint32_t num_inodes, uint32_t num_blocks)
+{
+    uint32_t num_entries = read32 (image);
+    uint8_t* entry;
+    uint8_t* node;
+    uint32_t i, inode, length, pos, chunk, block, crc;
+
+    for (i = 0; i < num_entries && i < MAX_DENTRIES; i++) {
+	entry = image + DENTRY_OFFSET + i * DENTRY_SIZE;
+	inode = read32 (entry + 36);
+	if (read32 (entry + 32) != FILE_TYPE_FILE)
+	    continue;
+	node = image + (1 + inode) * BLOCK_SIZE;
+	length = read32 (node);
+	if (inode >= num_inodes || read32 (node + 4) == EXTENT_MAGIC || length > LEGACY_BLOCKS * BLOCK_SIZE)
+	    return -1;
+	crc = 0;
+	for (pos = 0; pos < length; pos += chunk) {
+	    chunk = length - pos < BLOCK_SIZE ? length - pos : BLOCK_SIZE;
+	    block = read32 (node + 4 + 4 * (pos / BLOCK_SIZE));
+	    if (block >= num_blocks)
+		return -1;
+	    crc = crc32 (crc, image + (1 + num_inodes + block) * BLOCK_SIZE, chunk);
+	}
+	memcpy (entry + 40, &crc, 4);
+    }
+    return 0;
+}
+
+int
+main (int argc, char** argv)
+{
+    FILE* f;
+    uint8_t* image;
+    uint8_t* packed;
+    uint32_t* offsets;
+    uint8_t out[2 * BLOCK_SIZE];
+    uint32_t num_inodes, num_blocks, meta, len, i;
+    int checksums = 0, packing = 1;
+    long size;
+
+    for (; argc > 3 && '-' == argv[1][0]; argc--, argv++) {
+	if (0 == strcmp (argv[1], "-c"))
+	    checksums = 1;
+	else if (0 == strcmp (argv[1], "-u"))
+	    packing = 0;
+	else
+	    break;
+    }
+    if (argc != 3) {
+	fprintf (stderr, "usage: %s [-c] [-u] <image> <output image>\n", argv[0]);
+	return 1;
+    }
+    if (NULL == (f = fopen (argv[1], "rb"))) {
+	perror (argv[1]);
+	return 1;
+    }
+    fseek (f, 0, SEEK_END);
+    size = ftell (f);
+    rewind (f);
+    image = calloc (size + BLOCK_SIZE, 1);
+    if (size < BLOCK_SIZE || fread (image, 1, size, f) != (size_t)size) {
+	fprintf (stderr, "%s: not a file system image\n", argv[1]);
+	return 1;
+    }
+    fclose (f);
+
+    num_inodes = read32 (image + 4);
+    num_blocks = read32 (image + 8);
+    meta = (1 + num_inodes) * BLOCK_SIZE;
+    if (read32 (image + HEADER_OFFSET) == IMAGE_MAGIC || meta + (uint64_t)num_blocks * BLOCK_SIZE > (uint64_t)size + BLOCK_SIZE) {
+	fprintf (stderr, "%s: not an uncompressed file system image\n", argv[1]);
+	return 1;
+    }
+    if (checksums) {
+	if (-1 == add_checksums (image, num_inodes, num_blocks)) {
+	    fprintf (stderr, "%s: a file has blocks outside the image\n", argv[1]);
+	    return 1;
+	}
+	len = CHECKSUM_MAGIC;
+	memcpy (image + HEADER_OFFSET + 8, &len, 4);
+    }
+    if (!packing) {
+	if (NULL == (f = fopen (argv[2], "wb"))) {
+	    perror (argv[2]);
+	    return 1;
+	}
+	fwrite (image, 1, size, f);
+	fclose (f);
+	return 0;
+    }
+
+    offsets = calloc (num_blocks + 1, sizeof (uint32_t));
+    packed = malloc ((uint64_t)num_blocks * BLOCK_SIZE + 1);
+    for (i = 0; i < num_blocks; i++) {
+	len = compress_block (image + meta + i * BLOCK_SIZE, BLOCK_SIZE, out);
+	if (len >= BLOCK_SIZE) {
+	    /* stored as it is, the kernel tells by the length */
+	    len = BLOCK_SIZE;
+	    memcpy (out, image + meta + i * BLOCK_SIZE, BLOCK_SIZE);
+	}
+	memcpy (packed + offsets[i], out, len);
+	offsets[i + 1] = offsets[i] + len;
+    }
+
+    /* header: magic, bytes from the offsets to the end */
+    len = IMAGE_MAGIC;
+    memcpy (image + HEADER_OFFSET, &len, 4);
+    len = (num_blocks + 1) * sizeof (uint32_t) + offsets[num_blocks];
+    memcpy (image + HEADER_OFFSET + 4, &len, 4);
+
+    if (NULL == (f = fopen (argv[2], "wb"))) {
+	perror (argv[2]);
+	return 1;
+    }
+    fwrite (image, 1, meta, f);
+    fwrite (offsets, sizeof (uint32_t), num_blocks + 1, f);
+    fwrite (packed, 1, offsets[num_blocks], f);
+    fclose (f);
+
+    printf ("%ld bytes -> %u bytes, %u data blocks\n", size, meta + len, num_blocks);
+    return 0;
+}
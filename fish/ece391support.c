@@ -51,3 +51,129 @@ ece391_strncmp (const uint8_t* s1, const uint8_t* s2, uint32_t n)
     return ((int32_t)*s1) - ((int32_t)*s2);
 }
 
+/*
+ * Heap allocator on top of sbrk.  Requests up to MALLOC_MAX_SMALL bytes
+ * are rounded up to a power of 2 size class and reuse the freed blocks of
+ * their class.  Larger ones are rounded up to whole pages and reuse the
+ * first freed large block that is big enough.  The heap never shrinks.
+ */
+#if !defined(NULL)
+#define NULL 0
+#endif
+#define MALLOC_MIN_SHIFT 4      /* 16 bytes, the smallest class */
+#define MALLOC_CLASSES   8      /* 16 to 2048 bytes */
+#define MALLOC_MAX_SMALL (1 << (MALLOC_MIN_SHIFT + MALLOC_CLASSES - 1))
+#define MALLOC_PAGE      4096
+#define MALLOC_GROW      16384  /* the least the break is moved by */
+
+/* in front of every block, 8 bytes so blocks stay 8 byte aligned */
+struct malloc_header {
+    uint32_t size;              /* bytes after the header */
+    uint32_t unused;
+};
+
+/* a freed block, the link is kept in the block itself */
+struct malloc_free {
+    struct malloc_free* next;
+};
+
+static struct malloc_free* malloc_lists[MALLOC_CLASSES];
+static struct malloc_free* malloc_large;
+static uint8_t* heap_next;      /* blocks are carved from heap_next up to heap_end */
+static uint8_t* heap_end;
+
+/* Take total bytes from the end of the heap, moving the break if needed */
+static void*
+heap_carve (uint32_t total)
+{
+    uint32_t grow;
+    uint8_t* p;
+
+    if ((uint32_t)(heap_end - heap_next) < total) {
+        grow = (total > MALLOC_GROW) ? total : MALLOC_GROW;
+        p = ece391_sbrk (grow);
+        if ((void*)-1 == p && grow > total)
+            p = ece391_sbrk (grow = total);
+        if ((void*)-1 == p)
+            return NULL;
+        /* a break moved by someone else leaves the rest of the old space unused */
+        if (p != heap_end)
+            heap_next = p;
+        heap_end = p + grow;
+    }
+    p = heap_next;
+    heap_next += total;
+    return p;
+}
+
+void*
+ece391_malloc (uint32_t size)
+{
+    struct malloc_header* h;
+    struct malloc_free** prev;
+    int32_t c;
+
+    if (0 == size || size > 0x7FFFFFFF - MALLOC_PAGE)
+        return NULL;
+    if (size <= MALLOC_MAX_SMALL) {
+        for (c = 0; (1 << (c + MALLOC_MIN_SHIFT)) < size; c++);
+        size = 1 << (c + MALLOC_MIN_SHIFT);
+        if (NULL != malloc_lists[c]) {
+            h = (struct malloc_header*)malloc_lists[c] - 1;
+            malloc_lists[c] = malloc_lists[c]->next;
+            return h + 1;
+        }
+    } else {
+        size = (size + sizeof (struct malloc_header) + MALLOC_PAGE - 1) / MALLOC_PAGE * MALLOC_PAGE - sizeof (struct malloc_header);
+        for (prev = &malloc_large; NULL != *prev; prev = &(*prev)->next) {
+            h = (struct malloc_header*)*prev - 1;
+            if (h->size >= size) {
+                *prev = (*prev)->next;
+                return h + 1;
+            }
+        }
+    }
+    h = heap_carve (sizeof (struct malloc_header) + size);
+    if (NULL == h)
+        return NULL;
+    h->size = size;
+    return h + 1;
+}
+
+void
+ece391_free (void* ptr)
+{
+    struct malloc_header* h = (struct malloc_header*)ptr - 1;
+    struct malloc_free* block = ptr;
+    int32_t c;
+
+    if (NULL == ptr)
+        return;
+    if (h->size > MALLOC_MAX_SMALL) {
+        block->next = malloc_large;
+        malloc_large = block;
+        return;
+    }
+    for (c = 0; (1 << (c + MALLOC_MIN_SHIFT)) < h->size; c++);
+    block->next = malloc_lists[c];
+    malloc_lists[c] = block;
+}
+
+void*
+ece391_realloc (void* ptr, uint32_t size)
+{
+    struct malloc_header* h = (struct malloc_header*)ptr - 1;
+    uint8_t* p;
+    uint32_t i;
+
+    if (NULL == ptr)
+        return ece391_malloc (size);
+    if (size <= h->size)
+        return ptr;
+    if (NULL == (p = ece391_malloc (size)))
+        return NULL;
+    for (i = 0; i < h->size; i++)
+        p[i] = ((uint8_t*)ptr)[i];
+    ece391_free (ptr);
+    return p;
+}
@@ -7,4 +7,9 @@ extern void ece391_fdputs (int32_t fd, const uint8_t* s);
 extern int32_t ece391_strcmp (const uint8_t* s1, const uint8_t* s2);
 extern int32_t ece391_strncmp (const uint8_t* s1, const uint8_t* s2, uint32_t n);
 
+/* heap memory from sbrk, NULL if the heap is full */
+extern void* ece391_malloc (uint32_t size);
+extern void ece391_free (void* ptr);
+extern void* ece391_realloc (void* ptr, uint32_t size);
+
 #endif /* ECE391SUPPORT_H */
@@ -0,0 +1,207 @@
+#include "clock.h"
+#include "lib.h"
+#include "pit.h"
+#include "paging.h"
+#include "syscall.h"
+#include "klog.h"
+#include "timer.h"
+
+#define PIT_GATE_PORT       0x61    // bit 0 gates channel 2, bit 1 drives the speaker
+#define PIT_GATE_CH2        0x01
+#define PIT_GATE_SPEAKER    0x02
+#define PIT_CH2_OUT         0x20    // channel 2 output, read back through PIT_GATE_PORT
+#define PIT_CMD_CH2_ONESHOT 0xB0    // 10 11 000 0 channel 2, lobyte/hibyte, mode 0 (count down once)
+#define PIT_CALIBRATE_COUNT (PIT_BASE_FREQ / (1000 / CLOCK_CALIBRATE_MS))
+#define PIT_CALIBRATE_LOOPS 1000000     // give up on a PIT that never counts down
+
+#define PIT_TICK_NS         (NSEC_PER_SEC / PIT_HZ)
+
+static uint8_t time_page_data[FOUR_K_BYTE] __attribute__((aligned(FOUR_K_BYTE)));
+static page_table_entry_t time_page_table[MAX_ENTRY] __attribute__((aligned(FOUR_K_BYTE)));
+static time_page_t* const time_page = (time_page_t*)time_page_data;
+
+
+/*
+    tsc_measure
+    Description: Counts the TSC cycles while PIT channel 2 counts down CLOCK_CALIBRATE_MS
+    Input: none
+    Output: TSC cycles per second, 0 if the PIT never finished
+    Effects: interrupts must be off, leaves the speaker gate as it was
+*/
+static uint32_t tsc_measure(void) {
+    uint8_t gate = inb(PIT_GATE_PORT);
+    uint64_t start, cycles;
+    uint32_t loops = 0;
+
+    outb((gate & ~PIT_GATE_SPEAKER) | PIT_GATE_CH2, PIT_GATE_PORT);
+    outb(PIT_CMD_CH2_ONESHOT, PIT_CMD_PORT);
+    outb(PIT_CALIBRATE_COUNT & 0xFF, PIT_CH2_PORT);
+    outb(PIT_CALIBRATE_COUNT >> 8, PIT_CH2_PORT);
+    start = rdtsc();
+    while (!(inb(PIT_GATE_PORT) & PIT_CH2_OUT)) {
+        if (++loops == PIT_CALIBRATE_LOOPS) break;
+    }
+    cycles = (rdtsc() - start) * (1000 / CLOCK_CALIBRATE_MS);
+    outb(gate, PIT_GATE_PORT);
+
+    // the rate has to fit the 32 bits of the time page
+    if (loops == PIT_CALIBRATE_LOOPS || (cycles >> 32) != 0) return 0;
+    return (uint32_t)cycles;
+}
+
+/*
+    clock_init
+    Description: Measures the TSC against the PIT, fills in the time page and
+                 maps it read-only for user programs at TIME_PAGE_ADDR
+    Input: none
+    Output: none
+    Effects: the clock starts at 0
+*/
+void clock_init(void) {
+    uint32_t tsc_hz;
+    uint64_t base;
+    long flags;
+
+    cli_and_save(flags);
+    tsc_hz = tsc_measure();
+    base = rdtsc();
+    restore_flags(flags);
+
+    memset(time_page_data, 0, sizeof(time_page_data));
+    // mult is (10^9 << CLOCK_SHIFT) / tsc_hz, it only fits divl for a TSC faster than 16MHz
+    if (tsc_hz > (uint32_t)(((uint64_t)NSEC_PER_SEC << CLOCK_SHIFT) >> 32)) {
+        time_page->mult = div64_32((uint64_t)NSEC_PER_SEC << CLOCK_SHIFT, tsc_hz, NULL);
+        time_page->shift = CLOCK_SHIFT;
+        time_page->tsc_base_lo = (uint32_t)base;
+        time_page->tsc_base_hi = (uint32_t)(base >> 32);
+        time_page->tsc_hz = tsc_hz;
+        klog(KLOG_INFO, "clock: TSC at %u kHz", tsc_hz / 1000);
+    } else {
+        klog(KLOG_WARN, "clock: no usable TSC, counting PIT ticks");
+    }
+
+    memset(time_page_table, 0, sizeof(time_page_table));
+    time_page_table[0].present = 1;
+    time_page_table[0].read_write = 0;
+    time_page_table[0].user_supervisor = 1;
+    time_page_table[0].base_addr = (uint32_t)time_page_data >> 12;
+
+    page_directory[TIME_PAGE_IDX].directory_4KB_entry_desc.present = 1;
+    page_directory[TIME_PAGE_IDX].directory_4KB_entry_desc.read_write = 0;
+    page_directory[TIME_PAGE_IDX].directory_4KB_entry_desc.user_supervisor = 1;
+    page_directory[TIME_PAGE_IDX].directory_4KB_entry_desc.page_size = 0;
+    page_directory[TIME_PAGE_IDX].directory_4KB_entry_desc.base_addr = (uint32_t)time_page_table >> 12;
+    flush_tlb();
+}
+
+/*
+    clock_cycles_to_ns
+    Input: cycles - a number of TSC cycles
+    Output: the nanoseconds they take, 0 without a usable TSC
+*/
+uint64_t clock_cycles_to_ns(uint64_t cycles) {
+    uint32_t mult = time_page->mult;
+
+    // cycles * mult needs up to 96 bits, multiply the halves separately
+    return (((uint64_t)(uint32_t)(cycles >> 32) * mult) << (32 - CLOCK_SHIFT)) +
+           (((uint64_t)(uint32_t)cycles * mult) >> CLOCK_SHIFT);
+}
+
+/*
+    clock_ns
+    Input: none
+    Output: nanoseconds since clock_init, in PIT ticks without a usable TSC
+*/
+uint64_t clock_ns(void) {
+    uint64_t base;
+
+    if (time_page->tsc_hz == 0) return (uint64_t)pit_ticks * PIT_TICK_NS;
+    base = ((uint64_t)time_page->tsc_base_hi << 32) | time_page->tsc_base_lo;
+    return clock_cycles_to_ns(rdtsc() - base);
+}
+
+/*
+    clock_tsc_hz
+    Input: none
+    Output: TSC cycles per second, 0 if the clock does not use the TSC
+*/
+uint32_t clock_tsc_hz(void) {
+    return time_page->tsc_hz;
+}
+
+
+/*
+*   clock_gettime
+*
+*   Input : ts - filled in with the time since boot
+*   Output: 0 - if it worked fine
+*           -1 - if it is failed
+*   Effect: none, user programs can read the same clock from the time page
+*/
+int32_t clock_gettime(timespec_t* ts) {
+    uint32_t nsec;
+
+    if (bad_userspace_addr(ts, sizeof(timespec_t))) return -1;
+    ts->tv_sec = div64_32(clock_ns(), NSEC_PER_SEC, &nsec);
+    ts->tv_nsec = nsec;
+    return 0;
+}
+
+/*
+    sleep_expired
+    Description: nanosleep timer function, wakes the sleeper
+    Input: woken - address of the flag the sleeper halts on
+    Output: none
+*/
+static void sleep_expired(uint32_t woken) {
+    *(volatile uint8_t*)woken = 1;
+}
+
+/*
+*   nanosleep
+*
+*   Input : req - how long to sleep, less than NANOSLEEP_MAX_SEC seconds
+*   Output: 0 - if it slept the whole time
+*           -1 - if it is failed or a signal came in while sleeping
+*   Effect: parks the process on a timer for the whole PIT ticks of the
+*           sleep, then waits the rest on the TSC
+*/
+int32_t nanosleep(const timespec_t* req) {
+    volatile uint8_t woken = 0;
+    timer_t timer;
+    uint64_t now, wake;
+    uint32_t ticks;
+
+    if (bad_userspace_addr(req, sizeof(timespec_t)) || req->tv_nsec >= NSEC_PER_SEC ||
+        req->tv_sec >= NANOSLEEP_MAX_SEC) {
+        return -1;
+    }
+    now = clock_ns();
+    wake = now + (uint64_t)req->tv_sec * NSEC_PER_SEC + req->tv_nsec;
+
+    // the timer runs at most ticks PIT periods from now, never after wake
+    ticks = div64_32(wake - now, PIT_TICK_NS, NULL);
+    if (ticks > 1) {
+        timer_init(&timer, sleep_expired, (uint32_t)&woken);
+        timer_add(&timer, ticks);
+        while (!woken) {
+            if (signal_pending()) {
+                timer_cancel(&timer);
+                return -1;
+            }
+            asm volatile ("hlt");
+        }
+        now = clock_ns();
+    }
+
+    while (now < wake) {
+        if (signal_pending()) return -1;
+        if (time_page->tsc_hz == 0 || wake - now > PIT_TICK_NS) {
+            asm volatile ("hlt");
+        } else {
+            asm volatile ("pause");
+        }
+        now = clock_ns();
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+/* clock.h - monotonic clock counted by the TSC
+ * The TSC rate is measured against PIT channel 2 at boot. The numbers needed
+ * to turn a TSC reading into nanoseconds are kept in the time page, which
+ * every process can read at TIME_PAGE_ADDR, so user programs can read the
+ * clock without a system call. Without a usable TSC the clock falls back on
+ * pit_ticks.
+ */
+
+#ifndef _CLOCK_H
+#define _CLOCK_H
+
+#include "types.h"
+
+#define TIME_PAGE_ADDR      0xA400000   // 164MB, right above the user stack
+#define TIME_PAGE_IDX       (TIME_PAGE_ADDR >> 22)
+
+#define CLOCK_SHIFT         26          // ns = cycles * mult >> CLOCK_SHIFT
+#define NSEC_PER_SEC        1000000000
+#define NANOSLEEP_MAX_SEC   (0x7FFFFFFF / PIT_HZ)   // the timer has to be less than 2^31 ticks away
+#define CLOCK_CALIBRATE_MS  50          // how long the PIT counts while the TSC is measured
+
+#ifndef ASM
+
+/* the read-only page mapped into every process, user programs have the same layout */
+typedef struct time_page_t {
+    uint32_t tsc_hz;        // 0 if the TSC could not be measured, clock_gettime has to be called
+    uint32_t mult;          // nanoseconds per cycle << CLOCK_SHIFT
+    uint32_t shift;         // CLOCK_SHIFT
+    uint32_t tsc_base_lo;   // TSC when the clock read 0
+    uint32_t tsc_base_hi;
+} time_page_t;
+
+typedef struct timespec_t {
+    uint32_t tv_sec;
+    uint32_t tv_nsec;       // less than NSEC_PER_SEC
+} timespec_t;
+
+/* Measures the TSC and maps the time page, after paging and the PIT are set up */
+void clock_init(void);
+
+/* Nanoseconds since clock_init */
+uint64_t clock_ns(void);
+
+/* Nanoseconds in a number of TSC cycles */
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+
+/* Measured TSC rate, 0 if it is not used */
+uint32_t clock_tsc_hz(void);
+
+int32_t clock_gettime(timespec_t* ts);
+int32_t nanosleep(const timespec_t* req);
+
+#endif /* ASM */
+
+#endif /* _CLOCK_H */
@@ -1,134 +1,1413 @@
 #include "file_system.h"
+#include "klog.h"
 #include "syscall.h"
+#include "page_cache.h"
+#include "mmap.h"
+#include "lz.h"
+
+static void fs_alloc_init();
+static uint32_t fs_block_limit();
+static void unpack_image();
+static int32_t check_boot_block();
+static int32_t check_inode(index_node_t* node);
+static uint32_t file_checksum(uint32_t inode);
+static uint32_t map_block(index_node_t* node, uint32_t idx, uint32_t* run);
+static uint8_t* block_data(uint32_t block, uint32_t count);
+static int32_t fs_fill_page(uint32_t inode, uint32_t index, uint8_t* data);
+static void mark_dir(uint32_t dir, uint32_t depth);
+static int32_t dir_lookup (uint32_t dir, const int8_t* name, dir_entry_t* dentry);
+static int32_t dir_add_entry (uint32_t dir, const int8_t* name, int32_t file_type, uint32_t inode);
+static int32_t write_locked (uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length);
+static int32_t truncate_locked (uint32_t inode, uint32_t length);
+
+/* an entry of the dentry cache, keyed by (dir, dentry.file_name) */
+typedef struct dcache_entry_t {
+    uint32_t dir;           // inode of the directory the entry is in
+    dir_entry_t dentry;
+    uint8_t valid;
+} dcache_entry_t;
+
+static dcache_entry_t dcache[DCACHE_SIZE];
+static void dcache_insert (uint32_t dir, const dir_entry_t* dentry);
+uint32_t dcache_hits = 0;
+uint32_t dcache_misses = 0;
 
 uint32_t inode_index; // index to print files in directories
 
+// Data blocks added by writes go after the image, below the kernel stacks of the processes
+#define FS_MEM_END  (EIGHT_MB - EIGHT_KB * MAX_PID)
+
+static uint8_t block_bitmap[FS_MAX_DATA_BLOCKS / 8];  // 1 = data block belongs to a file
+static uint8_t inode_bitmap[FS_MAX_INODES / 8];       // 1 = inode belongs to a file
+static uint8_t inode_valid[FS_MAX_INODES / 8];        // 1 = inode passed the mount checks, reads trust its blocks
+static uint32_t fs_num_bad;                           // files the mount checks rejected
+static uint8_t fs_checksums;                          // 1 = the file entries of the image hold checksums
+static uint32_t fs_num_blocks;                        // data blocks that fit in memory
+static uint32_t fs_num_inodes;
+
+// Data blocks of a compressed image are unpacked into place the first time they are used
+static uint8_t block_packed[FS_MAX_DATA_BLOCKS / 8];  // 1 = data block is still compressed
+static uint32_t packed_count;                         // blocks still compressed
+static uint32_t* packed_offsets;                      // where the packed blocks were moved to
+static uint8_t* packed_data;                          // first packed block, after the offsets
+static uint8_t* packed_end;
+static uint32_t packed_image;                         // boot block of the compressed image
+
+// One writer at a time. Writers copy data with interrupts on and only disable them
+// while they change the bitmaps, inodes and directory entries readers look at
+static volatile uint8_t fs_write_busy = 0;
+
+#define BIT_GET(map, i)     ((map)[(i) >> 3] & (1 << ((i) & 7)))
+#define BIT_SET(map, i)     ((map)[(i) >> 3] |= (1 << ((i) & 7)))
+#define BIT_CLEAR(map, i)   ((map)[(i) >> 3] &= ~(1 << ((i) & 7)))
+
+// number of data blocks a file of length bytes uses
+#define BLOCKS_FOR(length)  (((length) + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE)
+
+
+/* file_sys_init
+ *
+ * Input :  boot_block_addr - the address where we set the boot_block
+ * Output: None
+ * Effect: Initialize the file system (ptr for the boot block, the first index node, and the first data block)
+ */
+
+void file_sys_init(uint32_t boot_block_addr){
+
+    image_header_t* header;
+
+    boot_block_ptr = (boot_block_t*) boot_block_addr;   // initialize boot block at mod-mod_start
+    index_node_start = (index_node_t*) (boot_block_ptr + 1);    // index node starts at (where boot block) + 1 : right after boot block
+    header = (image_header_t*)boot_block_ptr->reserved;
+    if(check_boot_block() == -1){
+        klog(KLOG_ERR, "file system: bad boot block, mounting an empty file system");
+        memset(boot_block_ptr, 0, sizeof(boot_block_t));
+        boot_block_ptr->num_inodes = 1;     // inode 0, which "." points at
+    }
+    data_block_start = (data_block_t*) (index_node_start + boot_block_ptr->num_inodes); // data block starts at (where index node starts) + (# of inodes)
+    inode_index = 0;
+
+    // checked once, files written later no longer match
+    fs_checksums = (header->checksums == CHECKSUM_MAGIC);
+    header->checksums = 0;
+
+    if(header->magic == LZ_IMAGE_MAGIC){
+        unpack_image();
+    }else if(boot_block_addr != packed_image){
+        packed_count = 0;   // a different image, nothing of it is packed
+    }
+
+    memset(dcache, 0, sizeof(dcache));
+    fs_alloc_init();
+    page_cache_init(fs_fill_page);
+}
+
+
+/* check_boot_block
+ *
+ * Input : None
+ * Output: 0 if the counts in the boot block describe an image that fits in memory, -1 if not
+ * Effect: None. A compressed image is checked further when it is unpacked
+ */
+
+static int32_t check_boot_block(){
+    uint32_t inodes_end;
+
+    if(boot_block_ptr->num_dir_entries > BOOT_BLOCK_DIR_ENTRY_SIZE || boot_block_ptr->num_inodes == 0 ||
+       boot_block_ptr->num_inodes > FS_MAX_INODES || boot_block_ptr->num_data_blocks > FS_MAX_DATA_BLOCKS){
+        return -1;
+    }
+    inodes_end = (uint32_t)(index_node_start + boot_block_ptr->num_inodes);
+    if(inodes_end > FS_MEM_END){
+        return -1;
+    }
+    if(((image_header_t*)boot_block_ptr->reserved)->magic != LZ_IMAGE_MAGIC &&
+       boot_block_ptr->num_data_blocks > (FS_MEM_END - inodes_end) / DATA_BLOCK_SIZE){
+        return -1;
+    }
+    return 0;
+}
+
+
+/* check_inode
+ *
+ * Input : node - inode of a file in the image
+ * Output: 0 if every block of the file is a data block of the image, -1 if not
+ * Effect: None. Reads only go through inodes that passed, so they do not check block numbers
+ */
+
+static int32_t check_inode(index_node_t* node){
+    uint32_t blocks = BLOCKS_FOR(node->length);
+    uint32_t num_blocks = boot_block_ptr->num_data_blocks;
+    uint32_t i, total = 0;
+
+    if(IS_EXTENT_INODE(node)){
+        extent_inode_t* ext = (extent_inode_t*)node;
+        if(ext->num_extents > EXTENTS_MAX){
+            return -1;
+        }
+        for(i = 0; i < ext->num_extents; ++i){
+            if(ext->extents[i].start >= num_blocks || ext->extents[i].count > num_blocks - ext->extents[i].start){
+                return -1;
+            }
+            total += ext->extents[i].count;
+        }
+        return (total >= blocks) ? 0 : -1;
+    }
+
+    if(node->length > LEGACY_MAX_FILE_SIZE){
+        return -1;
+    }
+    for(i = 0; i < blocks; ++i){
+        if(node->data_blocks[i] >= num_blocks){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/* file_checksum
+ *
+ * Input : inode - a file that passed check_inode
+ * Output: CRC-32 of the contents of the file
+ * Effect: None, reads the data blocks directly so the page cache is left alone
+ */
+
+static uint32_t file_checksum(uint32_t inode){
+    index_node_t* node = index_node_start + inode;
+    uint32_t pos, chunk, run, crc = 0;
+
+    for(pos = 0; pos < node->length; pos += chunk){
+        chunk = node->length - pos;
+        if(chunk > DATA_BLOCK_SIZE){
+            chunk = DATA_BLOCK_SIZE;
+        }
+        crc = crc32(crc, block_data(map_block(node, pos / DATA_BLOCK_SIZE, &run), 1), chunk);
+    }
+    return crc;
+}
+
+
+/* unpack_image
+ *
+ * Input : None
+ * Output: None
+ * Effect: moves the packed data blocks of a compressed image to the end of the file
+ *         system memory, out of the way of the blocks they unpack into, and marks every
+ *         block as packed. Mounts an empty file system if the image does not fit
+ */
+
+static void unpack_image(){
+    image_header_t* header = (image_header_t*)boot_block_ptr->reserved;
+    uint32_t num_blocks = boot_block_ptr->num_data_blocks;
+    uint32_t size = header->packed_size;
+    uint32_t dest = (FS_MEM_END - size) & ~3;
+    uint32_t i;
+
+    header->magic = 0;      // mounting again finds the blocks where this left them
+    packed_image = (uint32_t)boot_block_ptr;
+    packed_count = 0;
+    if(num_blocks > FS_MAX_DATA_BLOCKS || size < (num_blocks + 1) * sizeof(uint32_t) ||
+       size > FS_MEM_END - (uint32_t)data_block_start || dest < (uint32_t)(data_block_start + num_blocks)){
+        klog(KLOG_ERR, "file system: compressed image does not fit");
+        boot_block_ptr->num_dir_entries = 0;
+        return;
+    }
+
+    memmove((void*)dest, data_block_start, size);
+    packed_offsets = (uint32_t*)dest;
+    packed_data = (uint8_t*)(packed_offsets + num_blocks + 1);
+    packed_end = (uint8_t*)dest + size;
+    memset(block_packed, 0, sizeof(block_packed));
+    for(i = 0; i < num_blocks; ++i){
+        BIT_SET(block_packed, i);
+    }
+    packed_count = num_blocks;
+}
+
+
+/* packed_done
+ *
+ * Input : block - a data block that is still packed
+ * Output: None
+ * Effect: the block no longer needs unpacking. Once no block does, the memory of
+ *         the packed data goes back to the file system
+ */
+
+static void packed_done(uint32_t block){
+    BIT_CLEAR(block_packed, block);
+    if(--packed_count == 0){
+        fs_num_blocks = fs_block_limit();
+    }
+}
+
+
+/* block_data
+ *
+ * Input : block - data block number
+ *         count - number of blocks from block on that the caller uses
+ * Output: the data of the block
+ * Effect: unpacks the blocks that are still compressed
+ */
+
+static uint8_t* block_data(uint32_t block, uint32_t count){
+    uint32_t i, start, end;
+    int32_t len;
+    uint8_t* data;
+    long flags;
+
+    if(packed_count == 0){
+        return data_block_start[block].data_;
+    }
+    cli_and_save(flags);
+    for(i = block; i < block + count && packed_count > 0; ++i){
+        if(i >= FS_MAX_DATA_BLOCKS || !BIT_GET(block_packed, i)){
+            continue;
+        }
+        data = data_block_start[i].data_;
+        start = packed_offsets[i];
+        end = packed_offsets[i + 1];
+        len = -1;
+        if(start <= end && end - start <= DATA_BLOCK_SIZE && end <= packed_end - packed_data){
+            if(end - start == LZ_STORED){
+                memcpy(data, packed_data + start, DATA_BLOCK_SIZE);
+                len = DATA_BLOCK_SIZE;
+            }else{
+                len = lz_decompress(packed_data + start, end - start, data, DATA_BLOCK_SIZE);
+            }
+        }
+        if(len < 0){
+            klog(KLOG_ERR, "file system: packed data block %u is corrupt", i);
+            len = 0;
+        }
+        memset(data + len, 0, DATA_BLOCK_SIZE - len);
+        packed_done(i);
+    }
+    restore_flags(flags);
+    return data_block_start[block].data_;
+}
+
+
+/* map_block
+ *
+ * Input : node - inode of the file, either format
+ *         idx  - block of the file, must be below the length of the file
+ *         run  - set to the number of blocks from idx on that are consecutive data blocks
+ * Output: the data block that holds block idx of the file
+ * Effect: None
+ */
+
+static uint32_t map_block(index_node_t* node, uint32_t idx, uint32_t* run){
+    uint32_t i, r;
+
+    if(IS_EXTENT_INODE(node)){
+        extent_inode_t* ext = (extent_inode_t*)node;
+        for(i = 0; i < ext->num_extents; ++i){
+            if(idx < ext->extents[i].count){
+                *run = ext->extents[i].count - idx;
+                return ext->extents[i].start + idx;
+            }
+            idx -= ext->extents[i].count;
+        }
+        *run = 1;
+        return 0;   // past the last extent, only happens with a corrupt inode
+    }
+
+    // block list, count how many of the following entries continue the run
+    for(r = 1; idx + r < DATA_BLOCKS_MAX_NUM && node->data_blocks[idx + r] == node->data_blocks[idx] + r; ++r);
+    *run = r;
+    return node->data_blocks[idx];
+}
+
+
+/* max_file_size
+ *
+ * Input : node - inode of the file
+ * Output: the length the file can grow to
+ * Effect: None
+ */
+
+static uint32_t max_file_size(index_node_t* node){
+    if(IS_EXTENT_INODE(node)){
+        return fs_num_blocks * DATA_BLOCK_SIZE;
+    }
+    return LEGACY_MAX_FILE_SIZE;
+}
+
+
+/* fs_alloc_init
+ *
+ * Input : None
+ * Output: None
+ * Effect: builds the inode and data block bitmaps from the files in the directory.
+ *         Every inode and block no file uses is free for writes
+ */
+
+static void fs_alloc_init(){
+    uint32_t i;
+
+    memset(block_bitmap, 0, sizeof(block_bitmap));
+    memset(inode_bitmap, 0, sizeof(inode_bitmap));
+    memset(inode_valid, 0, sizeof(inode_valid));
+    fs_num_bad = 0;
+
+    fs_num_inodes = boot_block_ptr->num_inodes;
+    fs_num_blocks = fs_block_limit();
+
+    BIT_SET(inode_bitmap, 0);   // "." and rtc point at inode 0
+    mark_dir(ROOT_DIR_INODE, 0);
+
+    // packed blocks no file uses never have to be unpacked
+    for(i = 0; i < boot_block_ptr->num_data_blocks && packed_count > 0; ++i){
+        if(i < FS_MAX_DATA_BLOCKS && BIT_GET(block_packed, i) && !BIT_GET(block_bitmap, i)){
+            packed_done(i);
+        }
+    }
+}
+
+
+/* fs_block_limit
+ *
+ * Input : None
+ * Output: number of data blocks that fit in memory, below the packed blocks of a
+ *         compressed image while some are left
+ * Effect: None
+ */
+
+static uint32_t fs_block_limit(){
+    uint32_t end = (packed_count > 0) ? (uint32_t)packed_offsets : FS_MEM_END;
+    uint32_t num_blocks = FS_MAX_DATA_BLOCKS;
+
+    if((uint32_t)(data_block_start + num_blocks) > end){
+        num_blocks = (end - (uint32_t)data_block_start) / DATA_BLOCK_SIZE;
+    }
+    if(num_blocks < boot_block_ptr->num_data_blocks){
+        num_blocks = boot_block_ptr->num_data_blocks;
+    }
+    return num_blocks;
+}
+
+
+/* mark_dir
+ *
+ * Input : dir   - directory inode
+ *         depth - how deep dir is below the root
+ * Output: None
+ * Effect: marks the inodes and data blocks of everything in dir as used, and
+ *         goes into its subdirectories up to FS_MAX_DEPTH deep. Files whose inode
+ *         or checksum is bad keep their inode but cannot be read or written
+ */
+
+static void mark_dir(uint32_t dir, uint32_t depth){
+    uint32_t i, idx, blocks, block, run;
+    dir_entry_t entry;
+    index_node_t* node;
+    int8_t name[FILE_NAME_LENGTH + 1];
+
+    for(i = 0; read_dentry_in_dir(dir, i, &entry) == 0; ++i){
+        if(entry.file_type == FILE_TYPE_RTC || entry.inode == 0 ||
+           (entry.inode < fs_num_inodes && BIT_GET(inode_bitmap, entry.inode))){
+            continue;   // devices, "." and ".." and anything already marked
+        }
+        node = index_node_start + entry.inode;
+        if(entry.inode < fs_num_inodes){
+            BIT_SET(inode_bitmap, entry.inode);
+            if(check_inode(node) == 0){
+                BIT_SET(inode_valid, entry.inode);
+                if(fs_checksums && entry.file_type == FILE_TYPE_FILE && file_checksum(entry.inode) != entry.checksum){
+                    BIT_CLEAR(inode_valid, entry.inode);
+                }
+            }
+        }
+        if(entry.inode >= fs_num_inodes || !BIT_GET(inode_valid, entry.inode)){
+            strncpy(name, entry.file_name, FILE_NAME_LENGTH);
+            name[FILE_NAME_LENGTH] = '\0';
+            klog(KLOG_WARN, "file system: %s is corrupt", name);
+            ++fs_num_bad;
+            continue;
+        }
+        blocks = BLOCKS_FOR(node->length);
+        for(idx = 0; idx < blocks; ){
+            block = map_block(node, idx, &run);
+            for(; run > 0 && idx < blocks; --run, ++idx, ++block){
+                if(block < fs_num_blocks){
+                    BIT_SET(block_bitmap, block);
+                }
+            }
+        }
+        if(entry.file_type == FILE_TYPE_DIR && depth < FS_MAX_DEPTH){
+            mark_dir(entry.inode, depth + 1);
+        }
+    }
+}
+
+
+/* largest_free_run
+ *
+ * Input : len - set to the length of the run
+ * Output: first block of the longest run of free blocks, -1 if no block is free
+ * Effect: None. Starting a file in the longest run leaves the most room for it to grow in place
+ */
+
+static int32_t largest_free_run(uint32_t* len){
+    uint32_t start = 0, cur = 0, best_start = 0, best_len = 0, i;
+    for(i = 0; i <= fs_num_blocks; ++i){
+        if(i == fs_num_blocks || BIT_GET(block_bitmap, i)){
+            if(cur > best_len){
+                best_start = start;
+                best_len = cur;
+            }
+            cur = 0;
+            continue;
+        }
+        if(cur++ == 0){
+            start = i;
+        }
+    }
+    *len = best_len;
+    return best_len > 0 ? (int32_t)best_start : -1;
+}
+
+
+/* append_block
+ *
+ * Input : node  - inode of the file
+ *         have  - number of data blocks the file has
+ *         block - data block to add after them
+ * Output: 0 on success, -1 if the inode has no room for it
+ * Effect: adds block to the block list, or to the extents, growing the last extent
+ *         when block follows it
+ */
+
+static int32_t append_block(index_node_t* node, uint32_t have, uint32_t block){
+    if(IS_EXTENT_INODE(node)){
+        extent_inode_t* ext = (extent_inode_t*)node;
+        if(ext->num_extents > 0){
+            extent_t* last = &ext->extents[ext->num_extents - 1];
+            if(last->start + last->count == block){
+                last->count++;
+                return 0;
+            }
+        }
+        if(ext->num_extents >= EXTENTS_MAX){
+            return -1;
+        }
+        ext->extents[ext->num_extents].start = block;
+        ext->extents[ext->num_extents].count = 1;
+        ext->num_extents++;
+        return 0;
+    }
+
+    if(have >= DATA_BLOCKS_MAX_NUM){
+        return -1;
+    }
+    node->data_blocks[have] = block;
+    return 0;
+}
+
+
+/* grow_file
+ *
+ * Input : node - inode of the file
+ *         have - number of data blocks the file has
+ *         need - number of data blocks the file should have
+ * Output: number of data blocks the file has now, less than need if the file system is full
+ * Effect: adds zeroed data blocks to the file. A new block continues the last block of
+ *         the file if that one is free, else the file jumps to the start of the longest
+ *         free run, so sequential reads mostly walk consecutive blocks. Interrupts are
+ *         only off while each block is taken. Caller holds fs_lock
+ */
+
+static uint32_t grow_file(index_node_t* node, uint32_t have, uint32_t need){
+    uint32_t block, run, len;
+    int32_t start;
+    long flags;
+
+    while(have < need){
+        cli_and_save(flags);
+        block = fs_num_blocks;
+        if(have > 0){
+            block = map_block(node, have - 1, &run) + 1;
+        }
+        if(block >= fs_num_blocks || BIT_GET(block_bitmap, block)){
+            start = largest_free_run(&len);
+            if(start < 0){
+                restore_flags(flags);
+                break;
+            }
+            block = start;
+        }
+        if(append_block(node, have, block) == -1){
+            restore_flags(flags);
+            break;
+        }
+        BIT_SET(block_bitmap, block);
+        if(block >= boot_block_ptr->num_data_blocks){
+            boot_block_ptr->num_data_blocks = block + 1;
+        }
+        restore_flags(flags);
+        // past the length of the file, so no reader looks at it yet
+        memset(data_block_start + block, 0, DATA_BLOCK_SIZE);
+        ++have;
+    }
+    return have;
+}
+
+
+/* free_block
+ *
+ * Input : block - a data block of a file
+ * Output: None
+ * Effect: returns the block to the free bitmap, its packed data is not needed anymore
+ */
+
+static void free_block(uint32_t block){
+    BIT_CLEAR(block_bitmap, block);
+    if(packed_count > 0 && BIT_GET(block_packed, block)){
+        packed_done(block);
+    }
+}
+
+
+/* shrink_file
+ *
+ * Input : node - inode of the file
+ *         have - number of data blocks the file has
+ *         need - number of data blocks the file keeps
+ * Output: None
+ * Effect: returns the data blocks after the first need blocks to the free bitmap,
+ *         after unmapping them from every process that mapped the file.
+ *         Caller holds fs_lock and has interrupts off
+ */
+
+static void shrink_file(index_node_t* node, uint32_t have, uint32_t need){
+    uint32_t i, j, kept = 0;
+
+    page_cache_drop(node - index_node_start, need);
+    // blocks are mapped into processes as they are, take them away first
+    mmap_shrink(node - index_node_start, need);
+
+    if(IS_EXTENT_INODE(node)){
+        extent_inode_t* ext = (extent_inode_t*)node;
+        for(i = 0; i < ext->num_extents; ++i){
+            if(kept + ext->extents[i].count > need){
+                for(j = need - kept; j < ext->extents[i].count; ++j){
+                    free_block(ext->extents[i].start + j);
+                }
+                ext->extents[i].count = need - kept;
+            }
+            kept += ext->extents[i].count;
+        }
+        while(ext->num_extents > 0 && ext->extents[ext->num_extents - 1].count == 0){
+            ext->num_extents--;
+        }
+        return;
+    }
+
+    for(i = need; i < have; ++i){
+        if(node->data_blocks[i] < fs_num_blocks){
+            free_block(node->data_blocks[i]);
+        }
+    }
+}
+
+
+/* read_dentry_by_name
+ *
+ * Input : fname  : file name
+ *         dentry : address of dentry block where we copy the file we are looking for
+ * Output: If success, return 0. Otherwise (a non-existent file or invalid index), return -1.
+ * Effect: copy the file of the inputted file name into the dentry block  
+ */
+
+int32_t read_dentry_by_name (const uint8_t* fname, dir_entry_t* dentry){
+    int i;
+    
+    uint32_t fname_len = strlen((int8_t*)fname);
+    
+    if(fname_len > FILE_NAME_LENGTH){     // keep file name 32B max
+        return -1;
+    }
+
+    for(i = 0; i < boot_block_ptr->num_dir_entries; ++i){    // scan through the directory entries in the boot block to find the file name
+        if(!strncmp((int8_t*)fname, (int8_t*)(boot_block_ptr->d_entry[i].file_name), FILE_NAME_LENGTH)){  // check 32 letters
+            read_dentry_by_index(i, dentry);    // populate the dentry paramter
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+/* read_dentry_by_index
+ *
+ * Input : index  : index node
+ *         dentry : address of dentry block where we copy the file we are looking for
+ * Output: If success, return 0. Otherwise (a non-existent file or invalid index), return -1.
+ * Effect: copy the file of the inputted index file into the dentry block  
+ */
+
+int32_t read_dentry_by_index (uint32_t index, dir_entry_t* dentry){
+    
+    if(index >= boot_block_ptr->num_dir_entries){    // check index within the range
+        klog(KLOG_WARN, "read_dentry_by_index: bad index %u", index);
+        return -1;
+    }
+
+    // populate the dentry paramter
+    strcpy(dentry->file_name, boot_block_ptr->d_entry[index].file_name);    // populate the file name
+    dentry->file_type = boot_block_ptr->d_entry[index].file_type;           // populate the file type
+    dentry->inode = boot_block_ptr->d_entry[index].inode;                   // populate the inode number
+    dentry->checksum = boot_block_ptr->d_entry[index].checksum;
+    return 0;
+}
+
+
+/* read_dentry_in_dir
+ *
+ * Input : dir    : directory inode
+ *         index  : entry of the directory
+ *         dentry : address of dentry block where we copy the entry
+ * Output: If success, return 0. If index is past the last entry, return -1.
+ * Effect: copy entry index of the directory into the dentry block
+ */
+
+int32_t read_dentry_in_dir (uint32_t dir, uint32_t index, dir_entry_t* dentry){
+    if (dir == ROOT_DIR_INODE) {
+        if (index >= boot_block_ptr->num_dir_entries) {
+            return -1;
+        }
+        *dentry = boot_block_ptr->d_entry[index];
+        return 0;
+    }
+    if (index >= fs_file_length(dir) / sizeof(dir_entry_t)) {
+        return -1;
+    }
+    if (read_data(dir, index * sizeof(dir_entry_t), (uint8_t*)dentry, sizeof(dir_entry_t)) != sizeof(dir_entry_t)) {
+        return -1;
+    }
+    return 0;
+}
+
+
+/* dir_lookup
+ *
+ * Input : dir    : directory inode
+ *         name   : NULL terminated name, up to 32 characters
+ *         dentry : address of dentry block where we copy the entry
+ * Output: If found, return 0. Otherwise, return -1.
+ * Effect: scans the directory for name, without the dentry cache
+ */
+
+static int32_t dir_lookup (uint32_t dir, const int8_t* name, dir_entry_t* dentry){
+    uint32_t i;
+    for (i = 0; read_dentry_in_dir(dir, i, dentry) == 0; ++i) {
+        if (!strncmp(name, dentry->file_name, FILE_NAME_LENGTH)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+/* dcache_slot
+ *
+ * Input : dir  : directory inode
+ *         name : NULL terminated name, up to 32 characters
+ * Output: the dentry cache slot of (dir, name)
+ * Effect: None
+ */
+
+static dcache_entry_t* dcache_slot (uint32_t dir, const int8_t* name){
+    uint32_t h = 2166136261U ^ (dir * 2654435761U);     // FNV-1a over the name, seeded with dir
+    uint32_t i;
+    for (i = 0; i < FILE_NAME_LENGTH && name[i] != '\0'; ++i) {
+        h = (h ^ (uint8_t)name[i]) * 16777619U;
+    }
+    return &dcache[h & (DCACHE_SIZE - 1)];
+}
+
+
+/* dcache_insert
+ *
+ * Input : dir    : directory inode
+ *         dentry : entry of dir to remember
+ * Output: None
+ * Effect: replaces whatever was in the slot of (dir, name)
+ */
+
+static void dcache_insert (uint32_t dir, const dir_entry_t* dentry){
+    int8_t name[FILE_NAME_LENGTH + 1];
+    dcache_entry_t* slot;
+    long flags;
+
+    strncpy(name, dentry->file_name, FILE_NAME_LENGTH);
+    name[FILE_NAME_LENGTH] = '\0';
+    slot = dcache_slot(dir, name);
+    cli_and_save(flags);
+    slot->dir = dir;
+    slot->dentry = *dentry;
+    slot->valid = 1;
+    restore_flags(flags);
+}
+
+
+/* read_dentry_by_path
+ *
+ * Input : path   : '/' separated names, absolute if it starts with '/'
+ *         dir    : directory inode a relative path starts from
+ *         dentry : address of dentry block where we copy the entry the path leads to
+ * Output: If success, return 0. Otherwise (a part is missing, too long, or not a directory), return -1.
+ * Effect: walks the path one directory at a time. Each step checks the dentry cache
+ *         first, so a cached path costs one hash per part however big the directories are
+ */
+
+int32_t read_dentry_by_path (const uint8_t* path, uint32_t dir, dir_entry_t* dentry){
+    int8_t name[FILE_NAME_LENGTH + 1];
+    dir_entry_t cur;
+    dcache_entry_t* slot;
+    uint32_t len;
+    int32_t hit;
+    long flags;
+
+    if (path == NULL || *path == '\0' || strlen((int8_t*)path) > PATH_MAX_LENGTH) {
+        return -1;
+    }
+    if (*path == '/') {
+        dir = ROOT_DIR_INODE;
+    }
+
+    // start at the directory itself
+    memset(&cur, 0, sizeof(dir_entry_t));
+    strcpy(cur.file_name, ".");
+    cur.file_type = FILE_TYPE_DIR;
+    cur.inode = dir;
+
+    while (1) {
+        while (*path == '/') {
+            ++path;
+        }
+        if (*path == '\0') {
+            break;
+        }
+        for (len = 0; path[len] != '\0' && path[len] != '/'; ++len);
+        if (len > FILE_NAME_LENGTH || cur.file_type != FILE_TYPE_DIR) {
+            return -1;
+        }
+        memcpy(name, path, len);
+        name[len] = '\0';
+        path += len;
+
+        if (!strncmp(name, ".", 2) || (cur.inode == ROOT_DIR_INODE && !strncmp(name, "..", 3))) {
+            continue;   // the root has no ".." entry
+        }
+
+        dir = cur.inode;
+        slot = dcache_slot(dir, name);
+        // dcache_insert rewrites slots with interrupts off, so match and copy the same way
+        cli_and_save(flags);
+        hit = slot->valid && slot->dir == dir && !strncmp(name, slot->dentry.file_name, FILE_NAME_LENGTH);
+        if (hit) {
+            cur = slot->dentry;
+            ++dcache_hits;
+        } else {
+            ++dcache_misses;
+        }
+        restore_flags(flags);
+        if (hit) {
+            continue;
+        }
+        if (dir_lookup(dir, name, &cur) == -1) {
+            return -1;
+        }
+        dcache_insert(dir, &cur);
+    }
+
+    *dentry = cur;
+    return 0;
+}
+
+
+/* read_data
+ * 
+ * Input : inode  : index node of the starting position
+ *         offset : file address of the starting position
+ *         buf    : a buffer where the read data would be placed
+ *         length : number of bytes to read
+ * Output: If the offset is not within the range, return -1.
+ *         If it reaches the end of the file, return 0.
+ *         Otherwise, return the number of bytes read.
+ * Effect: The buffer store the copy of the read data within the given length of bytes
+ *
+ */
+
+int32_t read_data (uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length){
+    if (inode >= fs_num_inodes || !BIT_GET(inode_valid, inode)) {   // only inodes that passed the mount checks
+        return -1;
+    }
+
+    index_node_t* cur_inode = index_node_start + inode;  // address of the current inode
+    uint32_t file_length = cur_inode->length;
+    uint32_t pos, end, block, run, chunk;
+    page_t* page;
+
+    if(file_length <= offset){ // check the offset within the range
+        return 0;
+    }
+    if(length > file_length - offset){  // stop at the end of the file
+        length = file_length - offset;
+    }
+
+    // copy block by block out of the page cache
+    end = offset + length;
+    for (pos = offset; pos < end; pos += chunk) {
+        chunk = DATA_BLOCK_SIZE - pos % DATA_BLOCK_SIZE;
+        if (chunk > end - pos) {
+            chunk = end - pos;
+        }
+        page = page_get(inode, pos / DATA_BLOCK_SIZE);
+        if (page != NULL) {
+            memcpy(buf + (pos - offset), page->data + pos % DATA_BLOCK_SIZE, chunk);
+            page_put(page);
+        } else {    // no page to spare, read the block directly
+            block = map_block(cur_inode, pos / DATA_BLOCK_SIZE, &run);
+            memcpy(buf + (pos - offset), block_data(block, 1) + pos % DATA_BLOCK_SIZE, chunk);
+        }
+    }
+
+    return length;  // return the number of bytes read
+}
+
+
+/* fs_fill_page
+ * 
+ * Input : inode : index node of the file
+ *         index : block of the file
+ *         data  : page to fill
+ * Output: 0, or -1 if the block is past the end of the file
+ * Effect: backing store of the page cache, copies the data block in
+ *
+ */
+
+static int32_t fs_fill_page(uint32_t inode, uint32_t index, uint8_t* data){
+    uint8_t* block = fs_data_block(inode, index);
+
+    if (block == NULL) {
+        return -1;
+    }
+    memcpy(data, block, DATA_BLOCK_SIZE);
+    return 0;
+}
+
+
+/* fs_data_block
+ * 
+ * Input : inode : index node of the file
+ *         index : block of the file
+ * Output: the data block holding that block of the file, NULL if it is past the end
+ * Effect: None
+ *
+ */
+
+uint8_t* fs_data_block (uint32_t inode, uint32_t index){
+    index_node_t* node = index_node_start + inode;
+    uint32_t run;
+
+    if (inode >= fs_num_inodes || !BIT_GET(inode_valid, inode) || index >= BLOCKS_FOR(node->length)) {
+        return NULL;
+    }
+    return block_data(map_block(node, index, &run), 1);
+}
+
+
+/* fs_lock
+ * 
+ * Input : None
+ * Output: None
+ * Effect: waits for the writer that has the file system to finish, then has it. Only
+ *         processes write, so the writer always gets to run again and let go
+ *
+ */
+
+static void fs_lock(void){
+    long flags;
+
+    while (1) {
+        cli_and_save(flags);
+        if (!fs_write_busy) {
+            fs_write_busy = 1;
+            restore_flags(flags);
+            return;
+        }
+        restore_flags(flags);
+        asm volatile ("hlt");
+    }
+}
+
 
-/* file_sys_init
+/* fs_unlock
+ * 
+ * Input : None
+ * Output: None
+ * Effect: lets the next writer have the file system
  *
- * Input :  boot_block_addr - the address where we set the boot_block
+ */
+
+static void fs_unlock(void){
+    fs_write_busy = 0;
+}
+
+
+/* zero_tail
+ * 
+ * Input : node : inode of the file
  * Output: None
- * Effect: Initialize the file system (ptr for the boot block, the first index node, and the first data block)
+ * Effect: zeroes the rest of the last data block after the end of the file, so the
+ *         file reads zeros there once it grows
+ *
  */
 
-void file_sys_init(uint32_t boot_block_addr){
+static void zero_tail(index_node_t* node){
+    uint32_t run, block;
+    if (node->length % DATA_BLOCK_SIZE == 0) {
+        return;
+    }
+    page_cache_drop(node - index_node_start, node->length / DATA_BLOCK_SIZE);
+    block = map_block(node, node->length / DATA_BLOCK_SIZE, &run);
+    memset(block_data(block, 1) + node->length % DATA_BLOCK_SIZE, 0,
+           DATA_BLOCK_SIZE - node->length % DATA_BLOCK_SIZE);
+}
 
-    boot_block_ptr = (boot_block_t*) boot_block_addr;   // initialize boot block at mod-mod_start
-    index_node_start = (index_node_t*) (boot_block_ptr + 1);    // index node starts at (where boot block) + 1 : right after boot block
-    data_block_start = (data_block_t*) (index_node_start + boot_block_ptr->num_inodes); // data block starts at (where index node starts) + (# of inodes)
-    inode_index = 0;
 
+/* write_data
+ * 
+ * Input : inode  : index node of the file
+ *         offset : file address of the starting position
+ *         buf    : the data to write
+ *         length : number of bytes to write
+ * Output: If the inode is not a file or no data fits, return -1.
+ *         Otherwise, return the number of bytes written, less than length if the file system is full.
+ * Effect: Copies buf into the data blocks of the file and grows it past its end.
+ *         Writing past the end leaves a zeroed gap
+ *
+ */
+
+int32_t write_data (uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length){
+    int32_t ret;
+
+    fs_lock();
+    ret = write_locked(inode, offset, buf, length);
+    fs_unlock();
+    return ret;
 }
 
 
-/* read_dentry_by_name
+/* write_locked
+ * 
+ * Input : inode, offset, buf, length : as for write_data
+ * Output: as for write_data
+ * Effect: write_data for a caller that holds fs_lock. The data is copied with
+ *         interrupts on, the new length is only set once it is all there
  *
- * Input : fname  : file name
- *         dentry : address of dentry block where we copy the file we are looking for
- * Output: If success, return 0. Otherwise (a non-existent file or invalid index), return -1.
- * Effect: copy the file of the inputted file name into the dentry block  
  */
 
-int32_t read_dentry_by_name (const uint8_t* fname, dir_entry_t* dentry){
-    int i;
-    
-    uint32_t fname_len = strlen((int8_t*)fname);
-    
-    if(fname_len > FILE_NAME_LENGTH){     // keep file name 32B max
+static int32_t write_locked (uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length){
+    index_node_t* node;
+    uint32_t end, have, need, pos, block, chunk, run;
+    long flags;
+
+    if (buf == NULL || inode >= fs_num_inodes || !BIT_GET(inode_valid, inode)) {
+        return -1;
+    }
+    node = index_node_start + inode;
+    if (offset >= max_file_size(node)) {
         return -1;
     }
+    if (length > max_file_size(node) - offset) {
+        length = max_file_size(node) - offset;
+    }
+    if (length == 0) {
+        return 0;
+    }
 
-    for(i = 0; i < boot_block_ptr->num_inodes; ++i){    // scan through the directory entries in the boot block to find the file name
-        if(!strncmp((int8_t*)fname, (int8_t*)(boot_block_ptr->d_entry[i].file_name), FILE_NAME_LENGTH)){  // check 32 letters
-            read_dentry_by_index(i, dentry);    // populate the dentry paramter
-            return 0;
+    end = offset + length;
+    have = BLOCKS_FOR(node->length);
+    need = BLOCKS_FOR(end);
+
+    if (end > node->length) {
+        // the rest of the last block may hold old data, the file now reads it as zeros
+        zero_tail(node);
+        if (need > have) {
+            have = grow_file(node, have, need);
+            if (end > have * DATA_BLOCK_SIZE) {
+                end = have * DATA_BLOCK_SIZE;
+            }
+            if (end <= offset) {
+                return -1;
+            }
         }
     }
 
-    return -1;
+    // copy runs of consecutive blocks at once
+    for (pos = offset; pos < end; pos += chunk) {
+        block = map_block(node, pos / DATA_BLOCK_SIZE, &run);
+        chunk = run * DATA_BLOCK_SIZE - pos % DATA_BLOCK_SIZE;
+        if (chunk > end - pos) {
+            chunk = end - pos;
+        }
+        memcpy(block_data(block, BLOCKS_FOR(pos % DATA_BLOCK_SIZE + chunk)) + pos % DATA_BLOCK_SIZE,
+               buf + (pos - offset), chunk);
+        page_cache_write(inode, pos, buf + (pos - offset), chunk);
+    }
+
+    cli_and_save(flags);
+    if (end > node->length) {
+        node->length = end;
+    }
+    restore_flags(flags);
+    return end - offset;
 }
 
 
-/* read_dentry_by_index
+/* fs_create
+ * 
+ * Input : fname : name of the new file
+ * Output: the inode of the new file, -1 if it cannot be created
+ * Effect: adds an empty regular file to the root directory
  *
- * Input : index  : index node
- *         dentry : address of dentry block where we copy the file we are looking for
- * Output: If success, return 0. Otherwise (a non-existent file or invalid index), return -1.
- * Effect: copy the file of the inputted index file into the dentry block  
  */
 
-int32_t read_dentry_by_index (uint32_t index, dir_entry_t* dentry){
-    
-    if(index > boot_block_ptr->num_inodes || index < 0){    // check index within the range
-        printf("failed read index");
+int32_t fs_create (const uint8_t* fname){
+    if (fname == NULL || *fname == '/') {
         return -1;
     }
+    return fs_create_path(fname, ROOT_DIR_INODE, FILE_TYPE_FILE);
+}
 
-    // populate the dentry paramter
-    strcpy(dentry->file_name, boot_block_ptr->d_entry[index].file_name);    // populate the file name
-    dentry->file_type = boot_block_ptr->d_entry[index].file_type;           // populate the file type
-    dentry->inode = boot_block_ptr->d_entry[index].inode;                   // populate the inode number
-    return 0;
+
+/* fs_create_path
+ * 
+ * Input : path      : where the new file goes, the last part is its name
+ *         dir       : directory inode relative paths start from
+ *         file_type : FILE_TYPE_FILE or FILE_TYPE_DIR
+ * Output: the inode of the new file, -1 if the name is taken or too long, the
+ *         parent is not a directory, or there is no free directory entry or inode
+ * Effect: adds an entry to the parent directory. A new directory starts with
+ *         "." and ".." entries
+ *
+ */
+
+int32_t fs_create_path (const uint8_t* path, uint32_t dir, int32_t file_type){
+    int8_t parent_path[PATH_MAX_LENGTH + 1];
+    int8_t name[FILE_NAME_LENGTH + 1];
+    dir_entry_t parent, entry;
+    extent_inode_t* ext;
+    uint32_t len, inode, slash;
+    long flags;
+
+    if (path == NULL || (file_type != FILE_TYPE_FILE && file_type != FILE_TYPE_DIR)) {
+        return -1;
+    }
+    len = strlen((int8_t*)path);
+    while (len > 1 && path[len - 1] == '/') {     // "dir/" names dir
+        --len;
+    }
+    if (len == 0 || len > PATH_MAX_LENGTH) {
+        return -1;
+    }
+
+    // split into the parent directory and the name
+    for (slash = len; slash > 0 && path[slash - 1] != '/'; --slash);
+    if (len - slash == 0 || len - slash > FILE_NAME_LENGTH) {
+        return -1;
+    }
+    memcpy(name, path + slash, len - slash);
+    name[len - slash] = '\0';
+    if (!strncmp(name, ".", 2) || !strncmp(name, "..", 3)) {
+        return -1;
+    }
+    if (slash == 0) {
+        strcpy(parent_path, ".");
+    } else {
+        memcpy(parent_path, path, slash);
+        parent_path[slash] = '\0';
+    }
+
+    fs_lock();
+    if (read_dentry_by_path((uint8_t*)parent_path, dir, &parent) == -1 || parent.file_type != FILE_TYPE_DIR ||
+        dir_lookup(parent.inode, name, &entry) == 0) {
+        fs_unlock();
+        return -1;
+    }
+    if (parent.inode == ROOT_DIR_INODE && boot_block_ptr->num_dir_entries >= BOOT_BLOCK_DIR_ENTRY_SIZE) {
+        fs_unlock();
+        return -1;
+    }
+
+    cli_and_save(flags);
+    for (inode = 1; inode < fs_num_inodes; ++inode) {
+        if (!BIT_GET(inode_bitmap, inode)) {
+            break;
+        }
+    }
+    if (inode == fs_num_inodes) {
+        restore_flags(flags);
+        fs_unlock();
+        return -1;
+    }
+
+    // new files use extents
+    BIT_SET(inode_bitmap, inode);
+    BIT_SET(inode_valid, inode);
+    ext = (extent_inode_t*)(index_node_start + inode);
+    ext->length = 0;
+    ext->magic = EXTENT_INODE_MAGIC;
+    ext->num_extents = 0;
+    restore_flags(flags);
+
+    memset(&entry, 0, sizeof(dir_entry_t));
+    strncpy(entry.file_name, name, FILE_NAME_LENGTH);   // not NULL terminated at 32 characters, like the image
+    entry.file_type = file_type;
+    entry.inode = inode;
+
+    if (file_type == FILE_TYPE_DIR && (dir_add_entry(inode, ".", FILE_TYPE_DIR, inode) == -1 ||
+                                       dir_add_entry(inode, "..", FILE_TYPE_DIR, parent.inode) == -1)) {
+        truncate_locked(inode, 0);
+        cli_and_save(flags);
+        BIT_CLEAR(inode_bitmap, inode);
+        BIT_CLEAR(inode_valid, inode);
+        restore_flags(flags);
+        fs_unlock();
+        return -1;
+    }
+    if (dir_add_entry(parent.inode, entry.file_name, file_type, inode) == -1) {
+        truncate_locked(inode, 0);
+        cli_and_save(flags);
+        BIT_CLEAR(inode_bitmap, inode);
+        BIT_CLEAR(inode_valid, inode);
+        restore_flags(flags);
+        fs_unlock();
+        return -1;
+    }
+    dcache_insert(parent.inode, &entry);
+
+    fs_unlock();
+    return inode;
 }
 
 
-/* read_data
+/* dir_add_entry
  * 
- * Input : inode  : index node of the starting position
- *         offset : file address of the starting position
- *         buf    : a buffer where the read data would be placed
- *         length : number of bytes to read
- * Output: If the offset is not within the range, return -1.
- *         If it reaches the end of the file, return 0.
- *         Otherwise, return the number of bytes read.
- * Effect: The buffer store the copy of the read data within the given length of bytes
+ * Input : dir       : directory inode
+ *         name      : name of the entry, up to 32 characters
+ *         file_type : type of the entry
+ *         inode     : inode of the entry
+ * Output: If success, return 0. If the directory is full, return -1.
+ * Effect: adds the entry at the end of the directory. The root directory is the
+ *         boot block, other directories are files of dir_entry_t
  *
  */
 
-int32_t read_data (uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length){
-    if (offset < 0) {   // check if offset within the range
+static int32_t dir_add_entry (uint32_t dir, const int8_t* name, int32_t file_type, uint32_t inode){
+    dir_entry_t entry;
+    long flags;
+
+    memset(&entry, 0, sizeof(dir_entry_t));
+    strncpy(entry.file_name, name, FILE_NAME_LENGTH);
+    entry.file_type = file_type;
+    entry.inode = inode;
+
+    if (dir == ROOT_DIR_INODE) {
+        if (boot_block_ptr->num_dir_entries >= BOOT_BLOCK_DIR_ENTRY_SIZE) {
+            return -1;
+        }
+        cli_and_save(flags);
+        boot_block_ptr->d_entry[boot_block_ptr->num_dir_entries++] = entry;
+        restore_flags(flags);
+        return 0;
+    }
+    if (write_locked(dir, fs_file_length(dir), (uint8_t*)&entry, sizeof(dir_entry_t)) != sizeof(dir_entry_t)) {
         return -1;
     }
+    return 0;
+}
 
-    int i;
 
-    uint32_t num_byte_counter = 0;
-    
-    index_node_t* cur_inode = index_node_start + inode;  // address of the current inode
+/* fs_truncate
+ * 
+ * Input : inode  : index node of the file
+ *         length : new length of the file
+ * Output: If success, return 0. If the inode is not a file or there is not enough space, return -1.
+ * Effect: drops the data after length, or adds zeros up to length
+ *
+ */
 
-    uint32_t file_length = cur_inode->length;
+int32_t fs_truncate (uint32_t inode, uint32_t length){
+    int32_t ret;
 
-    if(file_length <= offset){ // check the offset within the range
+    fs_lock();
+    ret = truncate_locked(inode, length);
+    fs_unlock();
+    return ret;
+}
+
+
+/* truncate_locked
+ * 
+ * Input : inode, length : as for fs_truncate
+ * Output: as for fs_truncate
+ * Effect: fs_truncate for a caller that holds fs_lock. Interrupts are only off while
+ *         blocks are taken or given back and the length changes
+ *
+ */
+
+static int32_t truncate_locked (uint32_t inode, uint32_t length){
+    index_node_t* node;
+    uint32_t have, need, got;
+    long flags;
+
+    if (inode >= fs_num_inodes || !BIT_GET(inode_valid, inode)) {
+        return -1;
+    }
+    node = index_node_start + inode;
+    if (length > max_file_size(node)) {
+        return -1;
+    }
+
+    have = BLOCKS_FOR(node->length);
+    need = BLOCKS_FOR(length);
+
+    if (length < node->length) {
+        // readers stop at the new length before its blocks are given back
+        cli_and_save(flags);
+        node->length = length;
+        shrink_file(node, have, need);
+        restore_flags(flags);
         return 0;
     }
+    if (length > node->length) {
+        zero_tail(node);
+        if (need > have) {
+            got = grow_file(node, have, need);
+            if (got < need) {   // not enough space, give back what was added
+                cli_and_save(flags);
+                shrink_file(node, got, have);
+                restore_flags(flags);
+                return -1;
+            }
+        }
+    }
+    cli_and_save(flags);
+    node->length = length;
+    restore_flags(flags);
+    return 0;
+}
 
-    uint32_t data_block_index = offset / DATA_BLOCK_SIZE;   // index node of the starting position
-    
-    uint32_t data_offset = offset % DATA_BLOCK_SIZE;    // offset (xth data block #) of the starting position
 
-    data_block_t* cur_data_block = data_block_start + (cur_inode->data_blocks[data_block_index++]);  // address of the current data block
+/* fs_file_length
+ * 
+ * Input : inode : index node of the file
+ * Output: length of the file in bytes, 0 for an invalid inode
+ * Effect: None
+ *
+ */
 
-    uint32_t current_pos = data_offset; // current position of the data block -> keep track of determining if it reads the whole data block (move on to next data block or not)
+uint32_t fs_file_length (uint32_t inode){
+    if (inode >= fs_num_inodes || !BIT_GET(inode_valid, inode)) {
+        return 0;
+    }
+    return index_node_start[inode].length;
+}
 
-    for (i = 0; i < length; ++i)    {   // looping up to length bytes
-        
-        buf[i] = cur_data_block->data_[current_pos++];  // place current data in the buffer
 
-        ++num_byte_counter;
+/* fs_getdents
+ * 
+ * Input : dir    : inode of the directory
+ *         index  : first entry to pack, moved past the entries packed
+ *         buf    : where the records go
+ *         nbytes : size of buf
+ * Output: number of bytes packed, 0 after the last entry, -1 if the next record does not fit
+ * Effect: fills buf with as many dirent_t records as fit
+ *
+ */
 
-        if(num_byte_counter + offset >= file_length){    // if the end of the file has been reached, break
-            buf[i] = '\n';
-            break;
+int32_t fs_getdents (uint32_t dir, uint32_t* index, void* buf, int32_t nbytes){
+    dir_entry_t dentry;
+    dirent_t* rec;
+    uint32_t name_len, reclen;
+    int32_t used = 0;
+
+    while (read_dentry_in_dir(dir, *index, &dentry) == 0) {
+        for (name_len = 0; name_len < FILE_NAME_LENGTH && dentry.file_name[name_len] != '\0'; ++name_len);
+        reclen = DIRENT_RECLEN(name_len);
+        if (used + reclen > nbytes) {
+            return (used == 0) ? -1 : used;
+        }
+        rec = (dirent_t*)((uint8_t*)buf + used);
+        rec->reclen = reclen;
+        rec->name_len = name_len;
+        rec->type = dentry.file_type;
+        rec->inode = dentry.inode;
+        if (dentry.file_type == FILE_TYPE_RTC) {
+            rec->size = 0;
+        } else if (dentry.file_type == FILE_TYPE_DIR && dentry.inode == ROOT_DIR_INODE) {
+            rec->size = boot_block_ptr->num_dir_entries * sizeof(dir_entry_t);
+        } else {
+            rec->size = fs_file_length(dentry.inode);
         }
+        memcpy(rec->name, dentry.file_name, name_len);
+        rec->name[name_len] = '\0';
+        used += reclen;
+        ++*index;
+    }
+    return used;
+}
+
+
+/* fs_free_blocks
+ * 
+ * Input : None
+ * Output: number of data blocks writes can still use
+ * Effect: None
+ *
+ */
 
-        if(current_pos >= DATA_BLOCK_SIZE){ // if it reached the end of data block, move to the next data block
-            current_pos = 0;
-            cur_data_block = data_block_start + (cur_inode->data_blocks[data_block_index++]);    // address of the data block adter moving to the next data block
+uint32_t fs_free_blocks (){
+    uint32_t i, n = 0;
+    for (i = 0; i < fs_num_blocks; ++i) {
+        if (!BIT_GET(block_bitmap, i)) {
+            ++n;
         }
-        
     }
-    
-    return num_byte_counter;  // return the number of bytes read
+    return n;
+}
+
+
+/* fs_packed_blocks
+ * 
+ * Input : None
+ * Output: number of data blocks of a compressed image that are still packed
+ * Effect: None
+ *
+ */
+
+uint32_t fs_packed_blocks (){
+    return packed_count;
+}
+
+
+/* fs_bad_files
+ * 
+ * Input : None
+ * Output: number of files the mount checks found corrupt
+ * Effect: None
+ *
+ */
+
+uint32_t fs_bad_files (){
+    return fs_num_bad;
 }
 
 
@@ -246,6 +1525,8 @@ int32_t file_close(int32_t fd) {
     pcb_t* current_PCB = get_current_pcb();
     current_PCB->file_descriptor_ary[fd].flags = 0; // set file flag to free:0
     current_PCB->file_descriptor_ary[fd].file_position = 0;
+    page_put(current_PCB->file_descriptor_ary[fd].ra.page);
+    current_PCB->file_descriptor_ary[fd].ra.page = NULL;
     return 0;
 }
 
@@ -259,27 +1540,150 @@ int32_t file_close(int32_t fd) {
  *
  */
 int32_t file_read(int32_t fd, void* buf, int32_t nbytes) {   // read only system
-    int ret;
     if (buf == NULL) return -1;
     
     pcb_t* current_PCB = get_current_pcb(); // get current pcb address
-    ret = read_data(current_PCB->file_descriptor_ary[fd].inode, current_PCB->file_descriptor_ary[fd].file_position, buf, nbytes);
-    current_PCB->file_descriptor_ary[fd].file_position += ret;
+    return file_read_entry(&current_PCB->file_descriptor_ary[fd], buf, nbytes);
+}
+
+
+/* readahead
+ * 
+ * Input : entry - open file
+ *         pos   - where the read starts
+ *         end   - where the read ends
+ * Output: None
+ * Effect: A read that starts where the last one ended is sequential. Once a sequential
+ *         read reaches the mark, the next window of blocks is loaded into the page cache
+ *         and the window doubles. Any other read closes the window.
+ *
+ */
+
+static void readahead(file_descriptor_entry_t* entry, uint32_t pos, uint32_t end){
+    readahead_t* ra = &entry->ra;
+    uint32_t first;
+
+    if (pos != ra->next) {
+        ra->window = 0;
+        ra->mark = 0;
+        return;
+    }
+    if (ra->window == 0) {
+        ra->window = READAHEAD_MIN;
+        ra->mark = pos / DATA_BLOCK_SIZE;
+    }
+    if ((end - 1) / DATA_BLOCK_SIZE < ra->mark) {
+        return;
+    }
+    // load the blocks after the ones this read uses, the next read-ahead starts halfway in
+    first = BLOCKS_FOR(end);
+    if (first < ra->mark + 1) {
+        first = ra->mark + 1;
+    }
+    page_cache_readahead(entry->inode, first, ra->window);
+    ra->mark = first + ra->window / 2;
+    if (ra->window < READAHEAD_MAX) {
+        ra->window *= 2;
+    }
+}
+
 
+/* file_read_entry
+ * 
+ * Input : entry - open file
+ *         buf - a buffer where the read data would be placed
+ *         nbytes - number of bytes to read from file
+ * Output: the number of bytes read, 0 at the end of the file
+ * Effect: Reads at the file position and moves it past the data. A read that fits in the
+ *         page kept from the last read is copied straight from it, anything else goes
+ *         through read_data and keeps the page at the new position for the next read.
+ *
+ */
+
+int32_t file_read_entry(file_descriptor_entry_t* entry, void* buf, int32_t nbytes) {
+    readahead_t* ra = &entry->ra;
+    uint32_t pos = entry->file_position;
+    uint32_t length = fs_file_length(entry->inode);
+    page_t* page = ra->page;
+    int32_t ret;
+
+    if (nbytes <= 0 || pos >= length) {
+        return 0;
+    }
+    if (nbytes > length - pos) {
+        nbytes = length - pos;
+    }
+
+    if (page != NULL && page->valid && page->inode == entry->inode && page->index == pos / DATA_BLOCK_SIZE &&
+        pos % DATA_BLOCK_SIZE + nbytes <= DATA_BLOCK_SIZE) {
+        memcpy(buf, page->data + pos % DATA_BLOCK_SIZE, nbytes);
+        ret = nbytes;
+    } else {
+        readahead(entry, pos, pos + nbytes);
+        ret = read_data(entry->inode, pos, buf, nbytes);
+        if (ret <= 0) {
+            return ret;
+        }
+        page_put(page);
+        ra->page = (pos + ret < length) ? page_get(entry->inode, (pos + ret) / DATA_BLOCK_SIZE) : NULL;
+    }
+    entry->file_position = pos + ret;
+    ra->next = pos + ret;
     return ret;
 }
 
 
 /* file_write
+ * 
+ * Input : fd - file descriptor
+ *         buf - the data to write
+ *         nbytes - number of bytes to write
+ * Output: return the number of bytes written. If failed, return -1.
+ * Effect: Writes at the file position, or at the end of the file if fd has O_APPEND,
+ *         and moves the file position past the data.
+ *
+ */
+
+int32_t file_write(int32_t fd, const void* buf, int32_t nbytes) {
+    int32_t ret;
+    if (buf == NULL || bad_userspace_addr(buf, nbytes)) return -1;     // before write_data takes fs_lock
+
+    pcb_t* current_PCB = get_current_pcb(); // get current pcb address
+    file_descriptor_entry_t* entry = &current_PCB->file_descriptor_ary[fd];
+    if (entry->flags & O_APPEND) {
+        entry->file_position = fs_file_length(entry->inode);
+    }
+    ret = write_data(entry->inode, entry->file_position, buf, nbytes);
+    if (ret > 0) entry->file_position += ret;
+
+    return ret;
+}
+
+
+/* file_poll
+ * 
+ * Input : fd - file descriptor
+ * Output: POLLIN, data blocks are in memory so a read never waits
+ * Effect: None
+ *
+ */
+
+int32_t file_poll(int32_t fd) {
+    return POLLIN;
+}
+
+
+/* current_dir
  * 
  * Input : None
- * Output: Always return -1 since it is a read-only system
+ * Output: the working directory of the running process, the root if there is none
  * Effect: None
  *
  */
 
-int32_t file_write(int32_t fd, const void* buf, int32_t nbytes) {
-    return -1;
+static uint32_t current_dir() {
+    pcb_t* pcb = get_current_pcb();
+    return pcb == NULL ? ROOT_DIR_INODE : pcb->cwd;
 }
 
 
@@ -294,7 +1698,7 @@ int32_t file_write(int32_t fd, const void* buf, int32_t nbytes) {
 int32_t directory_open(const uint8_t* filename) {
     dir_entry_t dentry;
 
-    if(read_dentry_by_name(filename, &dentry) || dentry.file_type != 1) {
+    if(read_dentry_by_path(filename, current_dir(), &dentry) || dentry.file_type != FILE_TYPE_DIR) {
         return -1;
     }
     return 0;  
@@ -325,18 +1729,21 @@ int32_t directory_read(int32_t fd, void* buf, int32_t nbytes) {
 
     pcb_t * current_pcb = get_current_pcb();
     if(current_pcb == NULL) { return 0; }
-    if(current_pcb->file_descriptor_ary[fd].file_position > boot_block_ptr->num_inodes) { return 0; }
+
+    // the fd holds the inode of the directory, the position counts entries
+    dir_entry_t dentry;
+    file_descriptor_entry_t* entry = &current_pcb->file_descriptor_ary[fd];
+    if(read_dentry_in_dir(entry->inode, entry->file_position, &dentry) == -1) { return 0; }
 
     int8_t * target = (int8_t*)buf;
-    int8_t * temp = (int8_t*)boot_block_ptr->d_entry[current_pcb->file_descriptor_ary[fd].file_position].file_name;
     int i = 0;
 
-    while (temp[i] != '\0' && i < FILE_NAME_LENGTH)
+    while (dentry.file_name[i] != '\0' && i < FILE_NAME_LENGTH && i < nbytes)
     {
-        target[i] = temp[i];
+        target[i] = dentry.file_name[i];
         i++;
     }
-    current_pcb->file_descriptor_ary[fd].file_position++;
+    entry->file_position++;
     return i;
 
 }
@@ -354,3 +1761,15 @@ int32_t directory_write() {
     return -1;  // read-only system
 }
 
+
+/* directory_poll
+ * 
+ * Input : fd - file descriptor
+ * Output: POLLIN, the boot block is in memory so a read never waits
+ * Effect: None
+ *
+ */
+
+int32_t directory_poll(int32_t fd) {
+    return POLLIN;
+}
@@ -7,15 +7,35 @@
 
 #define FILE_NAME_LENGTH            32
 #define BOOT_BLOCK_RESERVED_SIZE    52
-#define DIR_ENTRY_RESERVED_SIZE     24        
+#define DIR_ENTRY_RESERVED_SIZE     20
 #define DATA_BLOCKS_MAX_NUM         1023
 #define BOOT_BLOCK_DIR_ENTRY_SIZE   63
 #define DATA_BLOCK_SIZE             4096
 
+#define FILE_TYPE_RTC               0
+#define FILE_TYPE_DIR               1
+#define FILE_TYPE_FILE              2
+
+#define FS_MAX_INODES               1024    // size of the inode bitmap
+#define FS_MAX_DATA_BLOCKS          4096    // data blocks the file system can grow to (16MB)
+#define LEGACY_MAX_FILE_SIZE        (DATA_BLOCKS_MAX_NUM * DATA_BLOCK_SIZE)
+
+#define ROOT_DIR_INODE              0       // the root directory is the boot block, its "." has inode 0
+#define PATH_MAX_LENGTH             128
+#define FS_MAX_DEPTH                16      // directories nested deeper are not scanned at mount
+#define DCACHE_SIZE                 256     // must be a power of 2
+
+#define READAHEAD_MIN               2       // blocks read ahead once reads turn sequential
+#define READAHEAD_MAX               32      // the window doubles up to this many blocks
+
+#define EXTENT_INODE_MAGIC          0xE47E4701  // where a block list inode has its first block number
+#define EXTENTS_MAX                 510         // extents that fit in an inode block
+
 typedef struct dir_entry_t{
     char file_name[FILE_NAME_LENGTH]; 
     int file_type;
     uint32_t inode;
+    uint32_t checksum;      // CRC-32 of the file, in images that have checksums
     uint8_t reserved[DIR_ENTRY_RESERVED_SIZE];
 } dir_entry_t;
 
@@ -32,22 +52,106 @@ typedef struct index_node_t{
     uint32_t data_blocks[DATA_BLOCKS_MAX_NUM];
 }   index_node_t;
 
+/* consecutive data blocks of a file */
+typedef struct extent_t{
+    uint32_t start;     // first data block
+    uint32_t count;     // number of blocks
+}   extent_t;
+
+/* inode that lists runs of blocks instead of every block. Files are only
+ * limited by the size of the file system. Told apart from index_node_t
+ * by the magic number, which is never a valid block number */
+typedef struct extent_inode_t{
+    uint32_t length;
+    uint32_t magic;
+    uint32_t num_extents;
+    extent_t extents[EXTENTS_MAX];
+}   extent_inode_t;
+
+#define IS_EXTENT_INODE(node)   (((extent_inode_t*)(node))->magic == EXTENT_INODE_MAGIC)
+
+#define LZ_IMAGE_MAGIC              0x315A4C46  // "FLZ1" at the start of the boot block reserved bytes
+#define LZ_STORED                   DATA_BLOCK_SIZE // packed length of a block kept uncompressed
+#define CHECKSUM_MAGIC              0x4D555343  // "CSUM", the file entries hold checksums
+
+/* Kept in the reserved bytes of the boot block by compressfs. In a compressed
+ * image the inodes are followed by num_data_blocks + 1 offsets, then the packed
+ * blocks: block i is bytes offsets[i] to offsets[i + 1] after the offsets,
+ * compressed with LZ4 unless it is LZ_STORED bytes long. Both magic numbers
+ * are cleared at mount, later mounts of the same memory find it unpacked and
+ * with files that may have been written since */
+typedef struct image_header_t{
+    uint32_t magic;         // LZ_IMAGE_MAGIC if the data blocks are packed
+    uint32_t packed_size;   // bytes from the offsets to the end of the image
+    uint32_t checksums;     // CHECKSUM_MAGIC if the file entries hold checksums
+}   image_header_t;
+
 typedef struct data_block_t{
     uint8_t data_[DATA_BLOCK_SIZE];
 }   data_block_t;
 
+/* record getdents packs for each directory entry, the name follows it */
+typedef struct dirent_t{
+    uint16_t reclen;    // bytes from this record to the next, a multiple of 4
+    uint8_t name_len;   // without the '\0' after the name
+    uint8_t type;       // FILE_TYPE_*
+    uint32_t inode;
+    uint32_t size;      // bytes in the file, or in the entries of a directory
+    int8_t name[0];
+}   dirent_t;
+
+#define DIRENT_RECLEN(name_len)     ((sizeof(dirent_t) + (name_len) + 1 + 3) & ~3)
+
+struct file_descriptor_entry_t;
+
 // initialize file system
 void file_sys_init(uint32_t boot_block_addr);
 
 // copy the file of the inputted file name into the dentry block
 int32_t read_dentry_by_name (const uint8_t* fname, dir_entry_t* dentry);
 
+// copy the entry a path leads to, starting from directory dir unless the path starts with '/'
+int32_t read_dentry_by_path (const uint8_t* path, uint32_t dir, dir_entry_t* dentry);
+
+// copy entry index of directory dir
+int32_t read_dentry_in_dir (uint32_t dir, uint32_t index, dir_entry_t* dentry);
+
 // copy the file of the inputted index file into the dentry block
 int32_t read_dentry_by_index (uint32_t index, dir_entry_t* dentry);
 
 // store the copy of the read data within the given length of bytes into the buffer
 int32_t read_data (uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
 
+// write length bytes from buf into the file at offset, growing the file if needed
+int32_t write_data (uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length);
+
+// add an empty regular file to the root directory, returns its inode
+int32_t fs_create (const uint8_t* fname);
+
+// add an empty file or directory at path, starting from directory dir, returns its inode
+int32_t fs_create_path (const uint8_t* path, uint32_t dir, int32_t file_type);
+
+// set the length of a file, freeing or adding zeroed blocks
+int32_t fs_truncate (uint32_t inode, uint32_t length);
+
+// return the length of a file
+uint32_t fs_file_length (uint32_t inode);
+
+// return the data block that holds block index of a file, NULL past its end
+uint8_t* fs_data_block (uint32_t inode, uint32_t index);
+
+// pack the entries of directory dir from *index on into buf as dirent_t records
+int32_t fs_getdents (uint32_t dir, uint32_t* index, void* buf, int32_t nbytes);
+
+// return the number of unused data blocks
+uint32_t fs_free_blocks ();
+
+// return the number of data blocks of a compressed image that were not read yet
+uint32_t fs_packed_blocks ();
+
+// return the number of files the mount checks rejected
+uint32_t fs_bad_files ();
+
 // store the the string to print which shows the file name, file type, and file size into the buffer
 int32_t dir_read(int32_t fd, void* buf, int32_t nbytes);
 
@@ -57,12 +161,19 @@ uint32_t get_num_dir_entry();
 int32_t file_open(const uint8_t* filename);
 int32_t file_close(int32_t fd);
 int32_t file_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t file_read_entry(struct file_descriptor_entry_t* entry, void* buf, int32_t nbytes);
 int32_t file_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t file_poll(int32_t fd);
 
 int32_t directory_open(const uint8_t* filename);
 int32_t directory_close();
 int32_t directory_read(int32_t fd, void* buf, int32_t nbytes);
 int32_t directory_write();
+int32_t directory_poll(int32_t fd);
+
+// dentry cache hits and misses of path lookups
+extern uint32_t dcache_hits;
+extern uint32_t dcache_misses;
 
 boot_block_t* boot_block_ptr;
 index_node_t* index_node_start;
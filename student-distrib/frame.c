@@ -0,0 +1,426 @@
+#include "paging.h"
+#include "lib.h"
+#include "klog.h"
+#include "syscall.h"
+
+#define PFN(addr)       ((uint32_t)(addr) / FOUR_K_BYTE)
+#define FRAME_ADDR(pfn) ((free_block_t*)((pfn) * FOUR_K_BYTE))
+#define FRAME_FREE      0x80    // first frame of a free block, the low bits are its order
+#define FRAME_USED      0x40    // handed out by frame_alloc or program_frame_alloc
+#define HIGH_FRAME(i)   (DIRECT_MAP_END + (i) * PROGRAM_SIZE)
+#define MEM_INFO_SIZE   512
+
+/* a free block of the direct zone, the list pointers live in its first frame */
+typedef struct free_block_t {
+    struct free_block_t* prev;
+    struct free_block_t* next;
+} free_block_t;
+
+/* RAM the boot loader reported and ranges that hold something already, both [start, end) */
+typedef struct mem_range_t {
+    uint32_t start;
+    uint32_t end;
+} mem_range_t;
+
+static mem_range_t ram[MEM_MAX_RANGES];
+static mem_range_t reserved[MEM_MAX_RANGES];
+static uint32_t ram_count;
+static uint32_t reserved_count;
+
+// direct zone, RAM below DIRECT_MAP_END handed out in blocks of 2^order frames
+static uint8_t frame_state[DIRECT_FRAMES];
+static free_block_t* free_lists[FRAME_ORDERS];
+static uint32_t free_blocks[FRAME_ORDERS];
+static uint32_t direct_total;   // frames
+static uint32_t direct_free;
+
+// high zone, RAM above DIRECT_MAP_END only used for 4MB program frames, 1 bit per free frame
+static uint32_t high_bitmap[(HIGH_FRAMES + 31) / 32];
+static uint32_t high_total;
+static uint32_t high_free;
+
+uint32_t frame_allocs = 0;
+uint32_t frame_frees = 0;
+uint32_t frame_failures = 0;
+
+
+/*
+    list_add
+    Description: Puts a block on the free list of its order
+    Input: pfn - first frame of the block
+           order - the block is 2^order frames
+    Output: none
+*/
+static void list_add(uint32_t pfn, uint32_t order) {
+    free_block_t* block = FRAME_ADDR(pfn);
+
+    block->prev = NULL;
+    block->next = free_lists[order];
+    if (free_lists[order]) free_lists[order]->prev = block;
+    free_lists[order] = block;
+    frame_state[pfn] = FRAME_FREE | order;
+    free_blocks[order]++;
+    direct_free += 1 << order;
+}
+
+/*
+    list_remove
+    Description: Takes a block off its free list
+    Input: pfn - first frame of a free block
+           order - the block is 2^order frames
+    Output: none
+*/
+static void list_remove(uint32_t pfn, uint32_t order) {
+    free_block_t* block = FRAME_ADDR(pfn);
+
+    if (block->prev) block->prev->next = block->next;
+    else free_lists[order] = block->next;
+    if (block->next) block->next->prev = block->prev;
+    frame_state[pfn] = 0;
+    free_blocks[order]--;
+    direct_free -= 1 << order;
+}
+
+/*
+    free_block
+    Description: Frees a block, merging it with its buddy as long as the buddy is free
+    Input: pfn - first frame, aligned to 2^order frames
+           order - the block is 2^order frames
+    Output: none
+*/
+static void free_block(uint32_t pfn, uint32_t order) {
+    uint32_t buddy;
+
+    while (order < FRAME_MAX_ORDER) {
+        buddy = pfn ^ (1 << order);
+        if (buddy >= DIRECT_FRAMES || frame_state[buddy] != (FRAME_FREE | order)) break;
+        list_remove(buddy, order);
+        pfn &= ~(1 << order);
+        order++;
+    }
+    list_add(pfn, order);
+}
+
+/*
+    free_range
+    Description: Frees frames in the largest aligned blocks that fit
+    Input: pfn - first frame
+           count - number of frames
+    Output: none
+*/
+static void free_range(uint32_t pfn, uint32_t count) {
+    uint32_t order;
+
+    while (count > 0) {
+        for (order = FRAME_MAX_ORDER; (pfn & ((1 << order) - 1)) || (1 << order) > count; order--);
+        free_block(pfn, order);
+        pfn += 1 << order;
+        count -= 1 << order;
+    }
+}
+
+/*
+    alloc_block
+    Description: Takes a block of 2^order frames, splitting a larger one if needed
+    Input: order - size of the block
+    Output: first frame of the block, -1 if no block is large enough
+*/
+static int32_t alloc_block(uint32_t order) {
+    uint32_t o, pfn;
+
+    for (o = order; o <= FRAME_MAX_ORDER && free_lists[o] == NULL; o++);
+    if (o > FRAME_MAX_ORDER) return -1;
+    pfn = PFN(free_lists[o]);
+    list_remove(pfn, o);
+    // the upper halves go back on the lists
+    while (o > order) {
+        o--;
+        list_add(pfn + (1 << o), o);
+    }
+    return pfn;
+}
+
+/*
+    is_reserved
+    Input: start, end - a range of physical memory
+    Output: 1 if the range overlaps the kernel, the BIOS area or a reserved range
+*/
+static uint32_t is_reserved(uint32_t start, uint32_t end) {
+    uint32_t i;
+
+    if (start < FRAME_LOW_START) return 1;
+    if (start < EIGHT_MB && end > KERNEL_ADDR) return 1;
+    for (i = 0; i < reserved_count; i++) {
+        if (start < reserved[i].end && end > reserved[i].start) return 1;
+    }
+    return 0;
+}
+
+
+/*
+    mem_add_range
+    Description: Records RAM reported by the boot loader, called before frame_init
+    Input: start - physical address
+           length - bytes, the range is cut off at 4GB
+    Output: none
+*/
+void mem_add_range(uint32_t start, uint32_t length) {
+    uint32_t end = start + length;
+
+    if (end < start) end = MEM_LIMIT;
+    if (ram_count == MEM_MAX_RANGES || end <= start) return;
+    ram[ram_count].start = start;
+    ram[ram_count].end = end;
+    ram_count++;
+}
+
+/*
+    mem_reserve
+    Description: Keeps a range of physical memory out of the allocator, called before frame_init
+    Input: start, end - the range, [start, end)
+    Output: none
+*/
+void mem_reserve(uint32_t start, uint32_t end) {
+    if (reserved_count == MEM_MAX_RANGES || end <= start) return;
+    reserved[reserved_count].start = start;
+    reserved[reserved_count].end = end;
+    reserved_count++;
+}
+
+/*
+    frame_init
+    Description: Hands every free frame of the recorded RAM to the allocator, RAM
+                 below DIRECT_MAP_END in 4KB frames and RAM above it in 4MB frames
+    Input: none
+    Output: none
+    Effects: needs paging, the direct zone is written through the direct map. Without
+             a memory map from the boot loader only the frames below the kernel are used
+*/
+void frame_init() {
+    uint32_t i, pfn, run, start, end;
+
+    if (ram_count == 0) mem_add_range(FRAME_LOW_START, KERNEL_ADDR - FRAME_LOW_START);
+
+    for (i = 0; i < ram_count; i++) {
+        start = (ram[i].start + FOUR_K_BYTE - 1) & ~(FOUR_K_BYTE - 1);
+        end = (ram[i].end < DIRECT_MAP_END) ? ram[i].end : DIRECT_MAP_END;
+        run = 0;
+        for (pfn = PFN(start); pfn < PFN(end); pfn++) {
+            if (!is_reserved(pfn * FOUR_K_BYTE, (pfn + 1) * FOUR_K_BYTE)) {
+                run++;
+                continue;
+            }
+            free_range(pfn - run, run);
+            direct_total += run;
+            run = 0;
+        }
+        free_range(pfn - run, run);
+        direct_total += run;
+
+        // whole 4MB frames above the direct zone
+        start = (ram[i].start > DIRECT_MAP_END) ? ram[i].start : DIRECT_MAP_END;
+        start = (start + PROGRAM_SIZE - 1) & ~(PROGRAM_SIZE - 1);
+        for (; start >= DIRECT_MAP_END && start < ram[i].end && ram[i].end - start >= PROGRAM_SIZE; start += PROGRAM_SIZE) {
+            pfn = (start - DIRECT_MAP_END) / PROGRAM_SIZE;
+            if (is_reserved(start, start + PROGRAM_SIZE) || (high_bitmap[pfn >> 5] & (1 << (pfn & 31)))) continue;
+            high_bitmap[pfn >> 5] |= 1 << (pfn & 31);
+            high_total++;
+            high_free++;
+        }
+    }
+}
+
+/*
+    frame_alloc
+    Description: Takes count physically contiguous 4KB frames from the direct zone
+    Input: count - number of frames
+    Output: address of the first frame (physical and kernel virtual), NULL if none are free
+    Effects: the frames past count in the block are freed again
+*/
+void* frame_alloc(uint32_t count) {
+    uint32_t order, i;
+    int32_t pfn;
+    long flags;
+
+    for (order = 0; order <= FRAME_MAX_ORDER && (1 << order) < count; order++);
+    cli_and_save(flags);
+    if (count == 0 || order > FRAME_MAX_ORDER || (pfn = alloc_block(order)) < 0) {
+        frame_failures++;
+        restore_flags(flags);
+        return NULL;
+    }
+    for (i = 0; i < count; i++) frame_state[pfn + i] = FRAME_USED;
+    free_range(pfn + count, (1 << order) - count);
+    frame_allocs++;
+    restore_flags(flags);
+    return FRAME_ADDR(pfn);
+}
+
+/*
+    frame_free
+    Description: Returns frames from frame_alloc to the allocator
+    Input: frame - address returned by frame_alloc
+           count - number of frames passed to frame_alloc
+    Output: none
+    Effects: a free of frames that are not in use is logged and ignored
+*/
+void frame_free(void* frame, uint32_t count) {
+    uint32_t pfn = PFN(frame), i;
+    long flags;
+
+    cli_and_save(flags);
+    for (i = 0; i < count; i++) {
+        if ((uint32_t)frame & (FOUR_K_BYTE - 1) || pfn + i >= DIRECT_FRAMES || frame_state[pfn + i] != FRAME_USED) break;
+    }
+    if (count == 0 || i < count) {
+        restore_flags(flags);
+        klog(KLOG_ERR, "frame_free: bad free of %u frames at 0x%x", count, (uint32_t)frame);
+        return;
+    }
+    for (i = 0; i < count; i++) frame_state[pfn + i] = 0;
+    free_range(pfn, count);
+    frame_frees++;
+    restore_flags(flags);
+}
+
+/*
+    frame_in_use
+    Input: addr - any address
+    Output: 1 if addr is in a direct zone frame that was handed out, 0 otherwise
+*/
+uint32_t frame_in_use(const void* addr) {
+    return PFN(addr) < DIRECT_FRAMES && frame_state[PFN(addr)] == FRAME_USED;
+}
+
+/*
+    program_frame_alloc
+    Description: Takes a 4MB frame for a program image, from the high zone first
+                 so the direct zone is left for the kernel
+    Input: none
+    Output: physical address of the frame, 0 if there is none
+*/
+uint32_t program_frame_alloc() {
+    uint32_t i;
+    long flags;
+
+    cli_and_save(flags);
+    for (i = 0; i < HIGH_FRAMES; i++) {
+        if (high_bitmap[i >> 5] & (1 << (i & 31))) {
+            high_bitmap[i >> 5] &= ~(1 << (i & 31));
+            high_free--;
+            frame_allocs++;
+            restore_flags(flags);
+            return HIGH_FRAME(i);
+        }
+    }
+    restore_flags(flags);
+    return (uint32_t)frame_alloc(PROGRAM_SIZE / FOUR_K_BYTE);
+}
+
+/*
+    program_frame_free
+    Input: frame - address returned by program_frame_alloc
+    Output: none
+*/
+void program_frame_free(uint32_t frame) {
+    uint32_t i = (frame - DIRECT_MAP_END) / PROGRAM_SIZE;
+    long flags;
+
+    if (frame < DIRECT_MAP_END) {
+        frame_free((void*)frame, PROGRAM_SIZE / FOUR_K_BYTE);
+        return;
+    }
+    cli_and_save(flags);
+    if (!(frame & (PROGRAM_SIZE - 1)) && !(high_bitmap[i >> 5] & (1 << (i & 31)))) {
+        high_bitmap[i >> 5] |= 1 << (i & 31);
+        high_free++;
+        frame_frees++;
+    }
+    restore_flags(flags);
+}
+
+/*
+    mem_total_kb
+    Output: KB of RAM the allocator manages
+*/
+uint32_t mem_total_kb() {
+    return direct_total * (FOUR_K_BYTE / 1024) + high_total * (PROGRAM_SIZE / 1024);
+}
+
+
+/*
+    meminfo_open
+    Input: filename - ignored
+    Output: 0
+*/
+int32_t meminfo_open(const uint8_t* filename) {
+    return 0;
+}
+
+/*
+    meminfo_close
+    Input: fd - ignored
+    Output: 0
+*/
+int32_t meminfo_close(int32_t fd) {
+    return 0;
+}
+
+/*
+    meminfo_read
+    Description: Reads the allocator statistics as text: frames in the zones, free
+                 blocks of each order, allocations, and how fragmented free memory is,
+                 the percentage of free direct zone frames that are not in a 4MB block
+    Input: fd - file descriptor, its position is the offset in the text
+           buf - buffer
+           nbytes - size of buf
+    Output: number of bytes read, 0 at the end of the text
+*/
+int32_t meminfo_read(int32_t fd, void* buf, int32_t nbytes) {
+    static int8_t text[MEM_INFO_SIZE];
+    file_descriptor_entry_t* entry = &get_current_pcb()->file_descriptor_ary[fd];
+    uint32_t len, order, largest = 0, frag = 0;
+    long flags;
+
+    if (buf == NULL || nbytes < 0) return -1;
+    cli_and_save(flags);
+    for (order = 0; order <= FRAME_MAX_ORDER; order++) {
+        if (free_blocks[order]) largest = (FOUR_K_BYTE / 1024) << order;
+    }
+    if (direct_free) frag = 100 - free_blocks[FRAME_MAX_ORDER] * 100 * (1 << FRAME_MAX_ORDER) / direct_free;
+    len = snprintf(text, MEM_INFO_SIZE, "total %u KB\ndirect %u/%u frames free\nhigh %u/%u 4MB frames free\n",
+                   mem_total_kb(), direct_free, direct_total, high_free, high_total);
+    len += snprintf(text + len, MEM_INFO_SIZE - len, "free blocks");
+    for (order = 0; order <= FRAME_MAX_ORDER; order++) {
+        len += snprintf(text + len, MEM_INFO_SIZE - len, " %u", free_blocks[order]);
+    }
+    len += snprintf(text + len, MEM_INFO_SIZE - len, "\nlargest %u KB\nfragmentation %u%%\nallocs %u\nfrees %u\nfailed %u\n",
+                    largest, frag, frame_allocs, frame_frees, frame_failures);
+    if (entry->file_position >= len) {
+        restore_flags(flags);
+        return 0;
+    }
+    if (nbytes > len - entry->file_position) nbytes = len - entry->file_position;
+    memcpy(buf, text + entry->file_position, nbytes);
+    entry->file_position += nbytes;
+    restore_flags(flags);
+    return nbytes;
+}
+
+/*
+    meminfo_write
+    Input: fd, buf, nbytes - ignored
+    Output: -1, the file is read-only
+*/
+int32_t meminfo_write(int32_t fd, const void* buf, int32_t nbytes) {
+    return -1;
+}
+
+/*
+    meminfo_poll
+    Input: fd - ignored
+    Output: POLLIN, never blocks
+*/
+int32_t meminfo_poll(int32_t fd) {
+    return POLLIN;
+}
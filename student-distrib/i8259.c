@@ -3,6 +3,7 @@
  */
 
 #include "i8259.h"
+#include "irqtrace.h"
 #include "lib.h"
 
 /* Interrupt masks to determine which interrupts are enabled and disabled */
@@ -122,6 +123,8 @@ void send_eoi(uint32_t irq_num) {
     }
 
 
+    irqtrace_irq_eoi(irq_num);
+
     if (irq_num >= 8){ // Send EOI to slave too if irq is from slave
         outb(EOI | (irq_num-8), SLAVE_8259_PORT);
         outb(EOI | 0x2, MASTER_8259_PORT);
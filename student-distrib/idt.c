@@ -1,5 +1,7 @@
 #include "idt.h"
 #include "syscall.h"
+#include "mmap.h"
+#include "klog.h"
 
 char* exception_string[] = {
     "Division Error", "Debug", "Non-maskable Interrupt", "Breakpoint", " Overflow", "BOUND Range Exceeded", "Invalid Opcode",
@@ -32,6 +34,7 @@ void init_idt(){
         idt[i].seg_selector = KERNEL_CS;
         idt[i].reserved4 = 0;
     }
+    idt[14].reserved3 = 0;  // page faults use an interrupt gate, so nothing overwrites CR2 before it is read
 
     SET_IDT_ENTRY(idt[0], division_error);
     SET_IDT_ENTRY(idt[1], debug);
@@ -109,25 +112,78 @@ void init_idt(){
     idt[PIT_ADDR].size = 1;
 
     SET_IDT_ENTRY(idt[PIT_ADDR], pit_handler_helper); 
+
+    idt[SERIAL_ADDR].dpl = 0; // kernel level privillege
+    idt[SERIAL_ADDR].reserved0 = 0;
+    idt[SERIAL_ADDR].reserved1 = 1;
+    idt[SERIAL_ADDR].reserved2 = 1;
+    idt[SERIAL_ADDR].reserved3 = 1;
+    idt[SERIAL_ADDR].reserved4 = 0;
+    idt[SERIAL_ADDR].seg_selector = KERNEL_CS;
+    idt[SERIAL_ADDR].present = 1;
+    idt[SERIAL_ADDR].size = 1;
+
+    SET_IDT_ENTRY(idt[SERIAL_ADDR], serial_handler_helper); 
 }
-//static int r_eax, rfl;
 // exception_handler
-// Description: this function is handling all exceptions in check point 1 by printing which exception occured, and 
-// pause the system using while(1)
-// Input: idx - index which tells what exception occured
+// Description: turns an exception in a user process into a signal, DIV_ZERO for a division
+//              error and SEGFAULT for the rest. Its crash record holds the exception, EIP and
+//              fault address. Without a handler, or while the signal is blocked, the process
+//              is killed and 256 returned to its parent through halt.
+//              An exception in the kernel prints which one occured and stops the system
+// Input: frame - the registers, the exception, its error code and where it happened
 // Output: none
-// Effect: prints the name of exception and pause the system
-void exception_handler(int idx){
+// Effect: returns only if a handler will run, the faulting instruction runs again after it
+void exception_handler(hw_context_t* frame){
+    pcb_t* pcb = get_current_pcb();
+    uint32_t addr = 0;
+    uint32_t signum;
 
-    if(idx < 0 || idx > 19){ // check if idx in range
+    if(frame->irq_exc > 19){ // check if idx in range
         return;
     }
+    if (frame->irq_exc == 14) {
+        asm volatile ("movl %%cr2, %0" : "=r" (addr));
+    }
 
+    if ((frame->cs & 3) != 3 || pcb == NULL) {
+        cli();
+        printf("%s in the kernel at eip 0x%x, error 0x%x, address 0x%x\n",
+               exception_string[frame->irq_exc], frame->eip, frame->error, addr);
+        while (1) asm volatile ("hlt");
+    }
 
+    pcb->crash.exception = frame->irq_exc;
+    pcb->crash.eip = frame->eip;
+    pcb->crash.addr = addr;
+    pcb->crash.error = frame->error;
+    klog(KLOG_ERR, "pid %u: %s at eip 0x%x, address 0x%x", pcb->pid,
+         exception_string[frame->irq_exc], frame->eip, addr);
+
+    signum = (frame->irq_exc == 0) ? SIG_DIV_ZERO : SIG_SEGFAULT;
+    if (pcb->sig_handlers[signum] == NULL || (pcb->sig_blocked & SIGNAL_BIT(signum))) {
+        halt_status(EXCEPTION_STATUS);
+    }
+    signal_send(pcb->pid, signum);
 }
 
 
 
+// page_fault_handler
+// Description: fills in pages that are allowed to fault, the pages of mmap'ed files
+//              and of the user stack
+// Input: error - error code the processor pushed
+// Output: 0 if the faulting instruction can run again, -1 otherwise
+// Effect: may map the page at the faulting address
+int32_t page_fault_handler(uint32_t error){
+    uint32_t addr;
+
+    asm volatile ("movl %%cr2, %0" : "=r" (addr));
+    if (stack_fault(addr, error) == 0) return 0;
+    return mmap_fault(addr, error);
+}
+
+
 // systemcall_checker
 // Description: this function is handling system_call interruption. For this checkpoint, we just need to see the systemcall interruption is working
 // so just prints the string that shows it is working.
@@ -7,6 +7,8 @@
 #include "rtc.h"
 #include "keyboard.h"
 #include "pit.h"
+#include "serial.h"
+#include "signal.h"
 
 #ifndef ASM
 
@@ -15,10 +17,12 @@
 #define RTC_ADDR            0x28 // PIC_ADDR + 8
 #define KEYBOARD_ADDR       PIC_ADDR+KEYBOARD_IRQ
 #define PIT_ADDR            PIC_ADDR+PIT_IRQ
+#define SERIAL_ADDR         PIC_ADDR+COM1_IRQ
 
 
 extern void init_idt();
-extern void exception_handler(int idx);
+extern void exception_handler(hw_context_t* frame);
+extern int32_t page_fault_handler(uint32_t error);
 extern void systemcall_checker();
 
 #endif
@@ -29,5 +29,6 @@ extern void systemcall_handler(void);
 extern void rtc_handler_helper(void);
 extern void keyboard_handler_helper(void);
 extern void pit_handler_helper(void);
+extern void serial_handler_helper(void);
 
 #endif
@@ -0,0 +1,217 @@
+#include "irqtrace.h"
+#include "lib.h"
+#include "clock.h"
+#include "syscall.h"
+
+#define IRQTRACE_BUCKET_SHIFT   10      // the first bucket ends at 1024 cycles
+#define IRQTRACE_BUCKET_STEP    2       // each bucket is 4 times as wide as the one before
+
+/* sites in the order they first disabled interrupts */
+static irqtrace_site_t* irqtrace_sites = NULL;
+static irqtrace_site_t** irqtrace_last = &irqtrace_sites;
+static uint32_t irqtrace_nsites = 0;
+
+/* the stretch with interrupts off that is going on */
+static irqtrace_site_t* irqtrace_open_site = NULL;
+static uint32_t irqtrace_open_start;
+
+static irqtrace_stat_t irq_stats[IRQTRACE_IRQS];
+static uint32_t irq_entry_start[IRQTRACE_IRQS];
+static uint32_t irq_entered = 0;        // bit per IRQ whose EOI has not been sent
+
+static int8_t irqtrace_text[IRQTRACE_TEXT_SIZE];
+static uint32_t irqtrace_text_len = 0;
+
+
+/*
+    irqtrace_record
+    Input: stat - where the time goes
+           cycles - how long it took
+    Output: none
+*/
+static void irqtrace_record(irqtrace_stat_t* stat, uint32_t cycles) {
+    uint32_t bucket = 0;
+    uint32_t rest = cycles >> IRQTRACE_BUCKET_SHIFT;
+
+    while (rest != 0 && bucket < IRQTRACE_BUCKETS - 1) {
+        rest >>= IRQTRACE_BUCKET_STEP;
+        ++bucket;
+    }
+    ++stat->hist[bucket];
+    ++stat->count;
+    stat->total += cycles;
+    if (cycles > stat->max) stat->max = cycles;
+}
+
+/*
+    irqtrace_format
+    Input: text - where the line goes
+           size - room left in text
+           name - what was timed
+           stat - its times
+    Output: length of the line
+*/
+static uint32_t irqtrace_format(int8_t* text, uint32_t size, int8_t* name, irqtrace_stat_t* stat) {
+    uint32_t len, bucket;
+
+    len = snprintf(text, size, "%s: %u max %u (%u us) avg %u hist", name, stat->count, stat->max,
+                   div64_32(clock_cycles_to_ns(stat->max), 1000, NULL),
+                   div64_32(stat->total, stat->count, NULL));
+    for (bucket = 0; bucket < IRQTRACE_BUCKETS; bucket++) {
+        len += snprintf(text + len, size - len, " %u", stat->hist[bucket]);
+    }
+    len += snprintf(text + len, size - len, "\n");
+    return len;
+}
+
+
+/*
+    irqtrace_off
+    Input: site - where interrupts were just disabled
+    Output: none
+    Effects: interrupts must be off, they were on before
+*/
+void irqtrace_off(irqtrace_site_t* site) {
+    if (site->id == 0) {
+        site->id = ++irqtrace_nsites;
+        *irqtrace_last = site;
+        irqtrace_last = &site->next;
+    }
+    irqtrace_open_site = site;
+    irqtrace_open_start = rdtsc_low();
+}
+
+/*
+    irqtrace_on
+    Input: none
+    Output: none
+    Effects: charges the stretch with interrupts off to the site that began it,
+             interrupts must still be off
+*/
+void irqtrace_on(void) {
+    uint32_t cycles = rdtsc_low() - irqtrace_open_start;
+
+    if (irqtrace_open_site == NULL) return;
+    irqtrace_record(&irqtrace_open_site->stat, cycles);
+    irqtrace_open_site = NULL;
+}
+
+/*
+    irqtrace_irq_entry
+    Input: irq - the IRQ whose stub was entered
+    Output: none
+*/
+void irqtrace_irq_entry(uint32_t irq) {
+    if (irq >= IRQTRACE_IRQS) return;
+    irq_entry_start[irq] = rdtsc_low();
+    irq_entered |= 1 << irq;
+}
+
+/*
+    irqtrace_irq_eoi
+    Input: irq - the IRQ the EOI was sent for
+    Output: none
+    Effects: the time from the stub entry goes to the IRQ, an EOI sent
+             outside the handler is not counted
+*/
+void irqtrace_irq_eoi(uint32_t irq) {
+    uint32_t cycles = rdtsc_low();
+
+    if (irq >= IRQTRACE_IRQS || !(irq_entered & (1 << irq))) return;
+    irq_entered &= ~(1 << irq);
+    irqtrace_record(&irq_stats[irq], cycles - irq_entry_start[irq]);
+}
+
+
+/*
+    irqtrace_open
+    Input: filename - ignored
+    Output: 0
+*/
+int32_t irqtrace_open(const uint8_t* filename) {
+    return 0;
+}
+
+/*
+    irqtrace_close
+    Input: fd - ignored
+    Output: 0
+*/
+int32_t irqtrace_close(int32_t fd) {
+    return 0;
+}
+
+/*
+    irqtrace_read
+    Description: Reads the tables as text: for each IRQ that came in, the cycles
+                 from its stub to its EOI, then for each site the cycles it kept
+                 interrupts off. The text is made again at offset 0 and kept for
+                 the reads after, so one pass sees one snapshot
+    Input: fd - file descriptor, its position is the offset in the text
+           buf - buffer
+           nbytes - size of buf
+    Output: number of bytes read, 0 at the end of the text
+*/
+int32_t irqtrace_read(int32_t fd, void* buf, int32_t nbytes) {
+    file_descriptor_entry_t* entry = &get_current_pcb()->file_descriptor_ary[fd];
+    irqtrace_site_t* site;
+    int8_t name[64];
+    uint32_t len, irq;
+
+    if (buf == NULL || nbytes < 0) return -1;
+    if (entry->file_position == 0) {
+        len = snprintf(irqtrace_text, IRQTRACE_TEXT_SIZE,
+                       "tsc %u kHz, hist buckets < 1K 4K 16K 64K 256K 1M 4M cycles and more\n",
+                       clock_tsc_hz() / 1000);
+        len += snprintf(irqtrace_text + len, IRQTRACE_TEXT_SIZE - len, "entry to EOI\n");
+        for (irq = 0; irq < IRQTRACE_IRQS; irq++) {
+            if (irq_stats[irq].count == 0) continue;
+            snprintf(name, sizeof(name), "irq %u", irq);
+            len += irqtrace_format(irqtrace_text + len, IRQTRACE_TEXT_SIZE - len, name, &irq_stats[irq]);
+        }
+        len += snprintf(irqtrace_text + len, IRQTRACE_TEXT_SIZE - len, "interrupts off\n");
+        for (site = irqtrace_sites; site != NULL; site = site->next) {
+            if (site->stat.count == 0) continue;
+            snprintf(name, sizeof(name), "%u %s:%u %s", site->id, site->file, site->line, site->func);
+            len += irqtrace_format(irqtrace_text + len, IRQTRACE_TEXT_SIZE - len, name, &site->stat);
+        }
+        irqtrace_text_len = len;
+    }
+
+    if (entry->file_position >= irqtrace_text_len) return 0;
+    if (nbytes > irqtrace_text_len - entry->file_position) nbytes = irqtrace_text_len - entry->file_position;
+    memcpy(buf, irqtrace_text + entry->file_position, nbytes);
+    entry->file_position += nbytes;
+    return nbytes;
+}
+
+/*
+    irqtrace_write
+    Description: Runs a command, "reset" clears the times, the sites stay known
+    Input: fd - ignored
+           buf - the command, a trailing newline is allowed
+           nbytes - length of the command
+    Output: nbytes, -1 if the command is unknown
+*/
+int32_t irqtrace_write(int32_t fd, const void* buf, int32_t nbytes) {
+    irqtrace_site_t* site;
+    long flags;
+
+    if (buf == NULL || nbytes < 5 || strncmp((int8_t*)buf, "reset", 5) != 0) return -1;
+    cli_and_save(flags);
+    for (site = irqtrace_sites; site != NULL; site = site->next) {
+        memset(&site->stat, 0, sizeof(irqtrace_stat_t));
+    }
+    memset(irq_stats, 0, sizeof(irq_stats));
+    restore_flags(flags);
+    return nbytes;
+}
+
+/*
+    irqtrace_poll
+    Input: fd - ignored
+    Output: POLLIN, never blocks
+*/
+int32_t irqtrace_poll(int32_t fd) {
+    return POLLIN;
+}
@@ -0,0 +1,82 @@
+/* irqtrace.h - how long interrupts stay disabled
+ * cli_and_save and cli (lib.h) time every stretch with interrupts off that
+ * they begin, from the cli to the restore_flags or sti that turns
+ * interrupts back on. The time goes to the call site that began the
+ * stretch. Each site is a static record made by the macro, so the table
+ * grows by itself as code runs. The IRQ stubs also time each device
+ * interrupt from its entry to its EOI. Everything can be read from the
+ * "irqtrace" file; writing "reset" clears it.
+ */
+
+#ifndef _IRQTRACE_H
+#define _IRQTRACE_H
+
+#include "types.h"
+
+#define IRQTRACE            1       // 0 takes the tracing out of cli_and_save and restore_flags
+
+#define IRQTRACE_BUCKETS    8       // bucket b counts stretches under 1024 << 2b cycles, the last one the rest
+#define IRQTRACE_IRQS       16
+#define IRQTRACE_TEXT_SIZE  12288   // the text of the "irqtrace" file
+
+#define EFLAGS_IF           0x200
+
+#ifndef ASM
+
+/* the stretches with interrupts off, or the interrupts, timed in one place */
+typedef struct irqtrace_stat_t {
+    uint32_t count;
+    uint32_t max;               // cycles
+    uint64_t total;             // cycles
+    uint32_t hist[IRQTRACE_BUCKETS];
+} irqtrace_stat_t;
+
+/* a place that disables interrupts */
+typedef struct irqtrace_site_t {
+    const int8_t* file;
+    uint32_t line;
+    const int8_t* func;
+    uint32_t id;                // 0 until it first disables interrupts, then its order
+    struct irqtrace_site_t* next;
+    irqtrace_stat_t stat;
+} irqtrace_site_t;
+
+/* Interrupts were just disabled at site, they were on before. Interrupts off */
+void irqtrace_off(irqtrace_site_t* site);
+
+/* Interrupts are about to be enabled. Interrupts off */
+void irqtrace_on(void);
+
+/* An IRQ stub was entered, and the handler sent the EOI of irq */
+void irqtrace_irq_entry(uint32_t irq);
+void irqtrace_irq_eoi(uint32_t irq);
+
+/* "irqtrace" file: reads the tables, writing "reset" clears them */
+int32_t irqtrace_open(const uint8_t* filename);
+int32_t irqtrace_close(int32_t fd);
+int32_t irqtrace_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t irqtrace_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t irqtrace_poll(int32_t fd);
+
+#if IRQTRACE
+
+/* a static site record for the line the macro is used on */
+#define IRQTRACE_OFF(flags)                                                 \
+do {                                                                        \
+    static irqtrace_site_t irqtrace_site_ = { __FILE__, __LINE__, __FUNCTION__ }; \
+    if ((flags) & EFLAGS_IF) irqtrace_off(&irqtrace_site_);                 \
+} while (0)
+
+#define IRQTRACE_ON(flags)                                                  \
+do {                                                                        \
+    if ((flags) & EFLAGS_IF) irqtrace_on();                                 \
+} while (0)
+
+#else
+#define IRQTRACE_OFF(flags)     do { (void)(flags); } while (0)
+#define IRQTRACE_ON(flags)      do { } while (0)
+#endif
+
+#endif /* ASM */
+
+#endif /* _IRQTRACE_H */
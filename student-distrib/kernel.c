@@ -11,8 +11,12 @@
 #include "paging.h"
 #include "rtc.h"
 #include "pit.h"
+#include "clock.h"
 #include "file_system.h"
 #include "syscall.h"
+#include "klog.h"
+#include "serial.h"
+#include "slab.h"
 
 #define RUN_TESTS
 
@@ -66,6 +70,7 @@ void entry(unsigned long magic, unsigned long addr) {
             
             printf("Module %d loaded at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_start);
             printf("Module %d ends at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_end);
+            mem_reserve(mod->mod_start, mod->mod_end);
             printf("First few bytes of module:\n");
             for (i = 0; i < 16; i++) {
                 printf("0x%x ", *((char*)(mod->mod_start+i)));
@@ -96,7 +101,7 @@ void entry(unsigned long magic, unsigned long addr) {
                 (unsigned)mbi->mmap_addr, (unsigned)mbi->mmap_length);
         for (mmap = (memory_map_t *)mbi->mmap_addr;
                 (unsigned long)mmap < mbi->mmap_addr + mbi->mmap_length;
-                mmap = (memory_map_t *)((unsigned long)mmap + mmap->size + sizeof (mmap->size)))
+                mmap = (memory_map_t *)((unsigned long)mmap + mmap->size + sizeof (mmap->size))) {
             printf("    size = 0x%x, base_addr = 0x%#x%#x\n    type = 0x%x,  length    = 0x%#x%#x\n",
                     (unsigned)mmap->size,
                     (unsigned)mmap->base_addr_high,
@@ -104,6 +109,13 @@ void entry(unsigned long magic, unsigned long addr) {
                     (unsigned)mmap->type,
                     (unsigned)mmap->length_high,
                     (unsigned)mmap->length_low);
+            /* type 1 is usable RAM, the frame allocator only uses the first 4GB */
+            if (mmap->type == 1 && mmap->base_addr_high == 0)
+                mem_add_range(mmap->base_addr_low, mmap->length_high ? MEM_LIMIT : mmap->length_low);
+        }
+    } else if (CHECK_FLAG(mbi->flags, 0)) {
+        /* no memory map, mem_upper is the KB of RAM from 1MB up */
+        mem_add_range(FRAME_LOW_START, (unsigned)mbi->mem_upper * 1024);
     }
 
     /* Construct an LDT entry in the GDT */
@@ -150,8 +162,12 @@ void entry(unsigned long magic, unsigned long addr) {
     
     /* Init the Page */
     page_init();
+    frame_init();
+    slab_init();
 
     terminal_open();
+    klog_init();
+    klog(KLOG_INFO, "memory: %u KB usable", mem_total_kb());
     file_sys_init(file_sys_addr);
 
     /* Init the IDT*/
@@ -167,6 +183,12 @@ void entry(unsigned long magic, unsigned long addr) {
     rtc_init();
     keyboard_init();
     pit_init();
+    clock_init();
+    serial_init();
+    if (serial_present) {
+        terminal_set_serial(SERIAL_TERMINAL);
+        klog_set_serial(1);
+    }
     enable_cursor();
 
     
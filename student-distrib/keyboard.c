@@ -1,4 +1,5 @@
 #include "keyboard.h"
+#include "softirq.h"
 
 char keycodes[SCANCODE_MAX][2] = {   
     { 0X0, 0X0 },                   
@@ -31,8 +32,6 @@ char keycodes[SCANCODE_MAX][2] = {
     { '/', '?' },
 };
 
-int typing_flags[3] = {0, 0, 0}; // typing flags for 3 terminals
-
 
 unsigned prev_key = 0;
 char capslock_on = 0;
@@ -46,16 +45,18 @@ char rctrl_on = 0;
 char lalt_on = 0;
 char ralt_on = 0;
 
-char kb_buf1[KB_BUFFER_SIZE];
-char kb_buf2[KB_BUFFER_SIZE];
-char kb_buf3[KB_BUFFER_SIZE];
-char* terminal_buffers[3] = {kb_buf1, kb_buf2, kb_buf3};
-unsigned kb_buf_len[3] = {0,0,0};
-
-char *kb_buffer = kb_buf1;
+char *kb_buffer = NULL;    // keyboard buffer of the displayed terminal
 static int kb_buf_count = 0;
 
-int command_history_cnt[3] = {0, 0 , 0};
+// scancodes the interrupt handler read and the softirq has not decoded yet
+static uint8_t kb_queue[KB_QUEUE_SIZE];
+static volatile uint8_t kb_queue_head = 0;
+static volatile uint8_t kb_queue_tail = 0;
+
+uint32_t kb_queue_dropped = 0;
+uint32_t kb_irq_cycles_max = 0;
+
+static void keyboard_scancode(uint8_t scan_code);
 
 /*
     keyboard init
@@ -66,6 +67,7 @@ int command_history_cnt[3] = {0, 0 , 0};
 void keyboard_init(void) {
     kb_int_occured = 0;
     kb_buf_count = 0;
+    kb_queue_head = kb_queue_tail = 0;
     prev_key = 0;
     capslock_on = 0;
     lshift_on = 0;
@@ -74,10 +76,8 @@ void keyboard_init(void) {
     rctrl_on = 0;
     lalt_on = 0;
     ralt_on = 0;
-    kb_buffer = kb_buf1;
-    memset(kb_buf1,0,KB_BUFFER_SIZE);
-    memset(kb_buf2,0,KB_BUFFER_SIZE);
-    memset(kb_buf3,0,KB_BUFFER_SIZE);
+    kb_buffer = terminals[current_terminal]->kb_buf;
+    memset(kb_buffer,0,KB_BUFFER_SIZE);
     
     outb(SCANCODE_1_CMD, KEYBOARD_CMD_PORT);
     enable_irq(KEYBOARD_IRQ);
@@ -88,19 +88,63 @@ void keyboard_init(void) {
     keyboard interrupts are generated on press and release   
     Input: none
     Output: none
-    Effects: handles keyboard interrupts, 
-            if key can be written, writes to screen and buffer
+    Effects: queues the scancode for the keyboard softirq, drops it if the
+            queue is full
 */
 void keyboard_handler(void) {
+    uint32_t start = rdtsc_low();
+    uint32_t cycles;
+    uint8_t scan_code;
     long flags;
 
     cli_and_save(flags);    //disable interrupt
 
-    uint8_t scan_code = inb(KEYBOARD_DATA_PORT); // get keyboard input
+    scan_code = inb(KEYBOARD_DATA_PORT); // get keyboard input
+    if ((uint8_t)(kb_queue_head - kb_queue_tail) < KB_QUEUE_SIZE) {
+        kb_queue[kb_queue_head++ & (KB_QUEUE_SIZE - 1)] = scan_code;
+    } else {
+        ++kb_queue_dropped;
+    }
+    softirq_raise(SOFTIRQ_KEYBOARD);
+    send_eoi(KEYBOARD_IRQ);
+
+    cycles = rdtsc_low() - start;
+    if (cycles > kb_irq_cycles_max) kb_irq_cycles_max = cycles;
+    restore_flags(flags); //enable interrupt
+}
+
+/*
+    keyboard softirq
+    Input: none
+    Output: none
+    Effects: decodes the queued scancodes with interrupts enabled,
+            if key can be written, writes to screen and buffer
+*/
+void keyboard_softirq(void) {
+    uint8_t scan_code;
+    long flags;
+
+    cli_and_save(flags);
+    while (kb_queue_tail != kb_queue_head) {
+        scan_code = kb_queue[kb_queue_tail++ & (KB_QUEUE_SIZE - 1)];
+        restore_flags(flags);
+        keyboard_scancode(scan_code);
+        cli_and_save(flags);
+    }
+    restore_flags(flags);
+}
+
+/*
+    keyboard scancode
+    Input: scan_code - a byte the keyboard sent
+    Output: none
+    Effects: if key can be written, writes to screen and buffer
+*/
+static void keyboard_scancode(uint8_t scan_code) {
     int pt = process_terminal;
     process_terminal = current_terminal;
     if (scan_code == EXTENDED) { // int is first part of two byte long scancode
-        goto keyboard_eoi;
+        goto keyboard_done;
     }
 
 
@@ -117,66 +161,68 @@ void keyboard_handler(void) {
             rctrl_on = 0;
         }
 
-        goto keyboard_eoi;
+        goto keyboard_done;
     }
 
     // Switch to different terminal
-    if ((ralt_on || lalt_on) && scan_code >= P_F1 && scan_code <= P_F3) {
+    if ((ralt_on || lalt_on) && ((scan_code >= P_F1 && scan_code <= P_F10) || scan_code == P_F11 || scan_code == P_F12)) {
         
-        int terminal = scan_code - P_F1; // 0-2
+        int terminal = (scan_code <= P_F10) ? scan_code - P_F1 : scan_code - P_F11 + 10; // 0-11
 
         // do nothing if trying to switch to current terminal
-        if (terminal == current_terminal) goto keyboard_eoi;
+        if (terminal == current_terminal) goto keyboard_done;
+
+        // first visit creates the terminal, the scheduler then starts its shell
+        if (terminal_create(terminal) == NULL) goto keyboard_done;
         process_terminal = pt;
         
         set_kb_buffer(terminal);
         prev_key = scan_code;
         kb_int_occured = 1;
-        send_eoi(KEYBOARD_IRQ);
-        
-        restore_flags(flags); //enable interrupt 
         
         switch_terminal(terminal); 
         return;
     }
 
+    terminal_t* term = terminals[current_terminal];
+
     if (scan_code == P_UP)   {   // check up and down for history command
-        if(typing_flags[process_terminal]){
-            goto keyboard_eoi;
+        if(term->typing_flag){
+            goto keyboard_done;
         }
         int i = 0;
-        if(command_history_cnt[current_terminal] < command_history_row[current_terminal]){
-            command_history_cnt[current_terminal]++;
+        if(term->history_cnt < term->history_row){
+            term->history_cnt++;
             clear_row();
             while(remove_key());
-            while (command_history[current_terminal][command_history_row[current_terminal] - command_history_cnt[current_terminal]][i] != '\n')  {
-                append_key(command_history[current_terminal][command_history_row[current_terminal] - command_history_cnt[current_terminal]][i]);
-                putc(command_history[current_terminal][command_history_row[current_terminal] - command_history_cnt[current_terminal]][i]);
+            while (term->history[term->history_row - term->history_cnt][i] != '\n')  {
+                append_key(term->history[term->history_row - term->history_cnt][i]);
+                putc(term->history[term->history_row - term->history_cnt][i]);
                 i++;
             }
         }
-        goto keyboard_eoi;
+        goto keyboard_done;
     }
 
     if (scan_code == P_DOWN)   {   // check up and down for history command
-        if(typing_flags[process_terminal]){
-            goto keyboard_eoi;
+        if(term->typing_flag){
+            goto keyboard_done;
         }
         int i = 0;
-        if(command_history_cnt[current_terminal] > 1){
-            command_history_cnt[current_terminal]--;
+        if(term->history_cnt > 1){
+            term->history_cnt--;
             clear_row();
             while(remove_key());
-            while (command_history[current_terminal][command_history_row[current_terminal] - command_history_cnt[current_terminal]][i] != '\n')  {
-                append_key(command_history[current_terminal][command_history_row[current_terminal] - command_history_cnt[current_terminal]][i]);
-                putc(command_history[current_terminal][command_history_row[current_terminal] - command_history_cnt[current_terminal]][i]);
+            while (term->history[term->history_row - term->history_cnt][i] != '\n')  {
+                append_key(term->history[term->history_row - term->history_cnt][i]);
+                putc(term->history[term->history_row - term->history_cnt][i]);
                 i++;
             }
-        }   else if(command_history_cnt[current_terminal] == 1){
+        }   else if(term->history_cnt == 1){
             clear_row();
             while(remove_key());
         }
-        goto keyboard_eoi;
+        goto keyboard_done;
     }
 
     if (scan_code == P_BACKSPACE) { // check back space
@@ -193,32 +239,37 @@ void keyboard_handler(void) {
 
     // tab to autocomplete
     if (scan_code == P_TAB) {
-        if(typing_flags[process_terminal]){
-            goto keyboard_eoi;
+        if(term->typing_flag){
+            goto keyboard_done;
         }
         tab_autocomplete();
     }
 
     if (scan_code == P_SPACE) { // check spacebar
-        if(typing_flags[process_terminal]){
-            goto keyboard_eoi;
+        if(term->typing_flag){
+            goto keyboard_done;
         }
         if (append_key(' '))
             {print_char(' ');}
     }
 
     if (scan_code == P_ENTER) { // check enter
-        if(typing_flags[process_terminal]){
-            goto keyboard_eoi;
+        if(term->typing_flag){
+            goto keyboard_done;
         }
         if (append_key('\n')){
             print_char('\n');
-            command_history_cnt[current_terminal] = 0;
-            memcpy(command_history[current_terminal][command_history_row[current_terminal]], terminal_buffers[current_terminal], strlen(terminal_buffers[current_terminal]));
-            command_history_row[current_terminal]++;
+            term->history_cnt = 0;
+            if (term->history_row >= HISTORY_SIZE) {    // full, forget the oldest command
+                memmove(term->history[0], term->history[1], (HISTORY_SIZE - 1) * TERMINAL_BUFFER_SIZE);
+                term->history_row--;
+            }
+            memset(term->history[term->history_row], 0, TERMINAL_BUFFER_SIZE);
+            memcpy(term->history[term->history_row], kb_buffer, strlen(kb_buffer));
+            term->history_row++;
         }
             
-        goto keyboard_eoi;
+        goto keyboard_done;
     }
 
     if (scan_code == P_LSH) { // check left shift
@@ -247,7 +298,7 @@ void keyboard_handler(void) {
 
     if (scan_code == P_CAP) { // check caps lock
         capslock_on = (capslock_on) ? 0 : 1;
-        goto keyboard_eoi;
+        goto keyboard_done;
     } 
 
 
@@ -256,8 +307,15 @@ void keyboard_handler(void) {
             clear_terminal();            // clear screen
             kb_buf_count = 0;   // clear keyboard buffer
             
-        } 
-        goto keyboard_eoi;
+        } else if (scan_code == P_C) {
+            // interrupt the program running on the terminal on screen
+            print_char('^');
+            print_char('C');
+            print_char('\n');
+            kb_buf_count = 0;
+            signal_send(terminals[current_terminal]->process_pid, SIG_INTERRUPT);
+        }
+        goto keyboard_done;
     }
 
     char let_pressed =  (scan_code >= P_Q && scan_code <= P_P) ||
@@ -265,13 +323,13 @@ void keyboard_handler(void) {
                         (scan_code >= P_Z && scan_code <= P_M);
 
     if (let_pressed) { // valid letter key
-        if(typing_flags[process_terminal]){
-            goto keyboard_eoi;
+        if(term->typing_flag){
+            goto keyboard_done;
         }
         char key = keycodes[scan_code][((lshift_on | rshift_on) || capslock_on) ? 1 : 0];
         if (append_key(key)) {
             print_char(key); // print key pressed
-            goto keyboard_eoi;
+            goto keyboard_done;
         }
         
         
@@ -286,20 +344,18 @@ void keyboard_handler(void) {
                             // (scan_code == P_TAB);
     
     if (special_pressed) { // valid number key
-        if(typing_flags[process_terminal]){
-            goto keyboard_eoi;
+        if(term->typing_flag){
+            goto keyboard_done;
         }
         char key = keycodes[scan_code][(lshift_on | rshift_on) ? 1 : 0];
         if (append_key(key)) {
             print_char(key); // print key 
         }
     }
-keyboard_eoi:
+keyboard_done:
     prev_key = scan_code;
     kb_int_occured = 1;
-    send_eoi(KEYBOARD_IRQ);
     process_terminal = pt;
-    restore_flags(flags); //enable interrupt  
     return;
 
 }
@@ -392,12 +448,12 @@ void set_kb_buf_count(int n) {
     Effects: kb_buffer now using a different buffer
 */
 int set_kb_buffer(int terminal) {
-    if (terminal > 2 || terminal < 0) return -1;
-    kb_buf_len[current_terminal] = kb_buf_count; // save buffer length
+    if (terminal >= MAX_TERMINALS || terminal < 0 || terminals[terminal] == NULL) return -1;
+    terminals[current_terminal]->kb_buf_count = kb_buf_count; // save buffer length
 
     // switch buffer
-    kb_buffer = terminal_buffers[terminal]; 
-    kb_buf_count = kb_buf_len[terminal];
+    kb_buffer = terminals[terminal]->kb_buf; 
+    kb_buf_count = terminals[terminal]->kb_buf_count;
 
     // check because why not
     if (kb_buf_count > KB_BUFFER_SIZE) kb_buf_count = KB_BUFFER_SIZE;
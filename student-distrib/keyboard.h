@@ -15,13 +15,12 @@
 #define KEYBOARD_DATA_PORT  0x60
 #define KEYBOARD_CMD_PORT   0x64
 #define KB_BUFFER_SIZE 128
+#define KB_QUEUE_SIZE       64      // scancodes waiting for the softirq, a power of 2 below 256
 
 #define SCANCODE_1_CMD      0xF1
 #define SCANCODE_MAX        54
 
 
-extern int typing_flags[3]; // typing flags for 3 terminals
-
 enum SCS1_SCANCODES {
     EXTENDED = 0xE0,
 
@@ -29,6 +28,7 @@ enum SCS1_SCANCODES {
     P_P = 0x19,
     P_A = 0x1E,
     P_L = 0x26,
+    P_C = 0x2E,
     P_Z = 0x2C,
     P_M = 0x32,
     P_1 = 0x02,
@@ -62,6 +62,9 @@ enum SCS1_SCANCODES {
     P_F3 = 0x3D,
     P_F4 = 0x3E,
     P_F5 = 0x3F,
+    P_F10 = 0x44,
+    P_F11 = 0x57,
+    P_F12 = 0x58,
     
     P_UP = 0x48,
     P_DOWN = 0x50,
@@ -70,12 +73,19 @@ enum SCS1_SCANCODES {
 // Flag indicating whether a keyboard interrupt has occurred
 extern volatile int kb_int_occured;
 
+// scancodes lost to a full queue, and the longest the interrupt handler kept interrupts off
+extern uint32_t kb_queue_dropped;
+extern uint32_t kb_irq_cycles_max;
+
 /* Initialize keyboard */
 void keyboard_init(void);
 
 /* Handle keyboard*/
 void keyboard_handler(void);
 
+/* Decode the queued scancodes, the keyboard softirq */
+void keyboard_softirq(void);
+
 /* Adds character to keyboard buffer*/
 int append_key(char c);
 
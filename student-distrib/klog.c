@@ -0,0 +1,129 @@
+#include "klog.h"
+#include "lib.h"
+#include "pit.h"
+#include "terminal.h"
+#include "serial.h"
+
+static klog_record_t klog_ring[KLOG_RECORDS];
+
+/* Records [klog_tail, klog_head) are reserved or waiting to be printed */
+static volatile uint32_t klog_head = 0;
+static volatile uint32_t klog_tail = 0;
+
+static volatile int32_t klog_level = KLOG_INFO;
+volatile uint32_t klog_dropped = 0;
+
+static int klog_terminal = -1;
+static int klog_serial = 0;
+
+static char* level_names[KLOG_LEVELS] = {"debug", "info", "warn", "error"};
+
+/*
+    klog_init
+    Input: none
+    Output: none
+    Effects: creates the log terminal, it has no shell and ignores typing.
+             Without it (no frames left) records are kept until the ring fills up
+*/
+void klog_init(void) {
+    terminal_t* t = terminal_create(KLOG_TERMINAL);
+    if (t == NULL) return;
+    t->shell_pid = TERMINAL_NO_SHELL;
+    t->typing_flag = 1;
+    klog_terminal = KLOG_TERMINAL;
+}
+
+/*
+    klog_set_level
+    Input: level - KLOG_DEBUG to KLOG_ERR
+    Output: none
+    Effects: messages below level are discarded by klog
+*/
+void klog_set_level(int32_t level) {
+    if (level < KLOG_DEBUG || level >= KLOG_LEVELS) return;
+    klog_level = level;
+}
+
+/*
+    klog_set_serial
+    Input: on - 1 to send records to COM1 as well, 0 to stop
+    Output: none
+    Effects: none
+*/
+void klog_set_serial(int32_t on) {
+    klog_serial = on;
+}
+
+/*
+    klog
+    Input: level - KLOG_DEBUG to KLOG_ERR
+           format - printf format string, followed by its arguments
+    Output: none
+    Effects: formats the message into the next free record. Does not disable
+             interrupts: the slot is claimed with cmpxchg, so an interrupt
+             handler that logs in the middle of this one just takes the next slot.
+             The message is dropped if the ring is full.
+*/
+void klog(int32_t level, int8_t* format, ...) {
+    int32_t* esp = (void *)&format;
+    uint32_t head;
+    klog_record_t* rec;
+
+    if (level < klog_level) return;
+    if (level >= KLOG_LEVELS) level = KLOG_ERR;
+    esp++;
+
+    // reserve a record
+    do {
+        head = klog_head;
+        if (head - klog_tail >= KLOG_RECORDS) {
+            ++klog_dropped;
+            return;
+        }
+    } while (cmpxchg(&klog_head, head, head + 1) != head);
+
+    rec = &klog_ring[head & (KLOG_RECORDS - 1)];
+    rec->seq = head;
+    rec->ticks = pit_ticks;
+    rec->level = level;
+    vsnprintf(rec->msg, KLOG_MSG_SIZE, format, esp);
+    rec->ready = 1;
+}
+
+/*
+    klog_flush
+    Input: none
+    Output: none
+    Effects: prints up to KLOG_FLUSH_MAX finished records on the log terminal
+             and COM1. Stops at a record that is still being written so the
+             order is kept. Runs as the klog softirq, so no interrupt handler
+             prints and no process switch happens while process_terminal is borrowed
+*/
+void klog_flush(void) {
+    klog_record_t* rec;
+    int8_t line[KLOG_LINE_SIZE];
+    int saved_terminal, n;
+    int has_terminal = (klog_terminal >= 0 && terminals[klog_terminal] != NULL);
+
+    if (!has_terminal && !klog_serial) return;
+
+    saved_terminal = process_terminal;
+    if (has_terminal) process_terminal = klog_terminal;
+    for (n = 0; n < KLOG_FLUSH_MAX && klog_tail != klog_head; ++n) {
+        rec = &klog_ring[klog_tail & (KLOG_RECORDS - 1)];
+        if (!rec->ready) break;
+        snprintf(line, KLOG_LINE_SIZE, "[%u.%u] %s: %s\n", rec->ticks / PIT_HZ,
+                 (rec->ticks % PIT_HZ) * 10 / PIT_HZ, level_names[rec->level], rec->msg);
+        rec->ready = 0;
+        ++klog_tail;
+        if (has_terminal) printf("%s", line);
+        if (klog_serial) serial_puts(line);
+    }
+    if (klog_dropped > 0) {
+        snprintf(line, KLOG_LINE_SIZE, "[klog] %u messages dropped\n", klog_dropped);
+        klog_dropped = 0;
+        if (has_terminal) printf("%s", line);
+        if (klog_serial) serial_puts(line);
+    }
+    process_terminal = saved_terminal;
+}
@@ -0,0 +1,57 @@
+/* klog.h - Kernel log
+ *
+ * klog() formats a message into a ring of records and returns, so it is safe
+ * to call from interrupt handlers. The records are printed later by
+ * klog_flush() on the log terminal, away from the user terminals.
+ */
+
+#ifndef _KLOG_H
+#define _KLOG_H
+
+#include "types.h"
+
+#ifndef ASM
+
+#define KLOG_DEBUG      0
+#define KLOG_INFO       1
+#define KLOG_WARN       2
+#define KLOG_ERR        3
+#define KLOG_LEVELS     4
+
+#define KLOG_RECORDS    64      // must be a power of 2
+#define KLOG_MSG_SIZE   96      // longer messages are truncated
+#define KLOG_FLUSH_MAX  8       // records printed per klog_flush call
+
+#define KLOG_TERMINAL   (MAX_TERMINALS - 1)     // Alt+F12
+#define KLOG_LINE_SIZE  (KLOG_MSG_SIZE + 32)    // record with its timestamp and level
+
+/* One log message */
+typedef struct klog_record_t {
+    uint32_t seq;               // sequence number, shows dropped records
+    uint32_t ticks;             // pit_ticks when logged
+    uint8_t level;
+    volatile uint8_t ready;     // set once the record is completely written
+    int8_t msg[KLOG_MSG_SIZE];
+} klog_record_t;
+
+/* Messages lost because the ring was full */
+extern volatile uint32_t klog_dropped;
+
+/* Creates the log terminal */
+void klog_init(void);
+
+/* Logs a message, format is the same as printf */
+void klog(int32_t level, int8_t* format, ...);
+
+/* Messages below level are discarded */
+void klog_set_level(int32_t level);
+
+/* 1 to also send records to COM1 */
+void klog_set_serial(int32_t on);
+
+/* Prints pending records, the klog softirq raised on every PIT tick */
+void klog_flush(void);
+
+#endif /* ASM */
+
+#endif /* _KLOG_H */
@@ -8,6 +8,8 @@
 #define NUM_ROWS    25
 #define ATTRIB      0x7B
 
+#define PRINTF_BUFFER_SIZE  128     // printf prints in chunks of this many characters
+
 // static int screen_x;
 // static int screen_y;
 static char* video_mem = (char *)VIDEO;
@@ -30,6 +32,7 @@ void clear(void) {
 
 void clear_row()    {
     int32_t i;
+    char* video_mem = get_video_mem();  // displayed screen moves when scrolling
     screen_x = 7;
     for (i = screen_x; i < NUM_COLS; i++) {
         *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + i) << 1)) = ' ';
@@ -38,32 +41,57 @@ void clear_row()    {
     update_cursor();
 }
 
-/* Standard printf().
- * Only supports the following format strings:
- * %%  - print a literal '%' character
- * %x  - print a number in hexadecimal
- * %u  - print a number as an unsigned integer
- * %d  - print a number as a signed integer
- * %c  - print a character
- * %s  - print a string
- * %#x - print a number in 32-bit aligned hexadecimal, i.e.
- *       print 8 hexadecimal digits, zero-padded on the left.
- *       For example, the hex number "E" would be printed as
- *       "0000000E".
- *       Note: This is slightly different than the libc specification
- *       for the "#" modifier (this implementation doesn't add a "0x" at
- *       the beginning), but I think it's more flexible this way.
- *       Also note: %x is the only conversion specifier that can use
- *       the "#" modifier to alter output. */
-int32_t printf(int8_t *format, ...) {
+/* Output of the formatter: a buffer that is either flushed or truncated when full */
+typedef struct fmt_sink_t {
+    int8_t* buf;
+    uint32_t size;                                  // capacity of buf, including the NULL
+    uint32_t len;                                   // characters in buf
+    uint32_t total;                                 // characters produced so far
+    void (*flush)(const int8_t* s, uint32_t n);     // NULL to truncate
+} fmt_sink_t;
+
+/* void sink_putc(fmt_sink_t* sink, int8_t c);
+ * Inputs: fmt_sink_t* sink = where to put the character
+ *                 int8_t c = character
+ * Return Value: none
+ * Function: appends c to the sink, flushing the buffer first if it is full */
+static void sink_putc(fmt_sink_t* sink, int8_t c) {
+    if (sink->len + 1 >= sink->size) {
+        if (sink->flush == NULL) {
+            sink->total++;
+            return;
+        }
+        sink->flush(sink->buf, sink->len);
+        sink->len = 0;
+    }
+    sink->buf[sink->len++] = c;
+    sink->total++;
+}
+
+/* void sink_puts(fmt_sink_t* sink, int8_t* s);
+ * Inputs: fmt_sink_t* sink = where to put the string
+ *                int8_t* s = NULL terminated string
+ * Return Value: none
+ * Function: appends s to the sink */
+static void sink_puts(fmt_sink_t* sink, int8_t* s) {
+    while (*s != '\0') {
+        sink_putc(sink, *s++);
+    }
+}
+
+static void emit_chars(const int8_t* s, uint32_t n);
+
+/* void format_to_sink(fmt_sink_t* sink, int8_t* format, int32_t* esp);
+ * Inputs: fmt_sink_t* sink = where the output goes
+ *           int8_t* format = format string, see printf
+ *             int32_t* esp = first argument after the format string
+ * Return Value: none
+ * Function: does the formatting for printf and snprintf */
+static void format_to_sink(fmt_sink_t* sink, int8_t* format, int32_t* esp) {
 
     /* Pointer to the format string */
     int8_t* buf = format;
 
-    /* Stack pointer for the other parameters */
-    int32_t* esp = (void *)&format;
-    esp++;
-
     while (*buf != '\0') {
         switch (*buf) {
             case '%':
@@ -76,7 +104,7 @@ format_char_switch:
                     switch (*buf) {
                         /* Print a literal '%' character */
                         case '%':
-                            putc('%');
+                            sink_putc(sink, '%');
                             break;
 
                         /* Use alternate formatting */
@@ -94,7 +122,7 @@ format_char_switch:
                                 int8_t conv_buf[64];
                                 if (alternate == 0) {
                                     itoa(*((uint32_t *)esp), conv_buf, 16);
-                                    puts(conv_buf);
+                                    sink_puts(sink, conv_buf);
                                 } else {
                                     int32_t starting_index;
                                     int32_t i;
@@ -104,7 +132,7 @@ format_char_switch:
                                         conv_buf[i] = '0';
                                         i++;
                                     }
-                                    puts(&conv_buf[starting_index]);
+                                    sink_puts(sink, &conv_buf[starting_index]);
                                 }
                                 esp++;
                             }
@@ -115,7 +143,7 @@ format_char_switch:
                             {
                                 int8_t conv_buf[36];
                                 itoa(*((uint32_t *)esp), conv_buf, 10);
-                                puts(conv_buf);
+                                sink_puts(sink, conv_buf);
                                 esp++;
                             }
                             break;
@@ -131,20 +159,20 @@ format_char_switch:
                                 } else {
                                     itoa(value, conv_buf, 10);
                                 }
-                                puts(conv_buf);
+                                sink_puts(sink, conv_buf);
                                 esp++;
                             }
                             break;
 
                         /* Print a single character */
                         case 'c':
-                            putc((uint8_t) *((int32_t *)esp));
+                            sink_putc(sink, (uint8_t) *((int32_t *)esp));
                             esp++;
                             break;
 
                         /* Print a NULL-terminated string */
                         case 's':
-                            puts(*((int8_t **)esp));
+                            sink_puts(sink, *((int8_t **)esp));
                             esp++;
                             break;
 
@@ -156,12 +184,85 @@ format_char_switch:
                 break;
 
             default:
-                putc(*buf);
+                sink_putc(sink, *buf);
                 break;
         }
         buf++;
     }
-    return (buf - format);
+}
+
+/* Standard printf().
+ * Only supports the following format strings:
+ * %%  - print a literal '%' character
+ * %x  - print a number in hexadecimal
+ * %u  - print a number as an unsigned integer
+ * %d  - print a number as a signed integer
+ * %c  - print a character
+ * %s  - print a string
+ * %#x - print a number in 32-bit aligned hexadecimal, i.e.
+ *       print 8 hexadecimal digits, zero-padded on the left.
+ *       For example, the hex number "E" would be printed as
+ *       "0000000E".
+ *       Note: This is slightly different than the libc specification
+ *       for the "#" modifier (this implementation doesn't add a "0x" at
+ *       the beginning), but I think it's more flexible this way.
+ *       Also note: %x is the only conversion specifier that can use
+ *       the "#" modifier to alter output. */
+int32_t printf(int8_t *format, ...) {
+    int8_t buf[PRINTF_BUFFER_SIZE];
+    fmt_sink_t sink = { buf, sizeof(buf), 0, 0, emit_chars };
+
+    /* Stack pointer for the other parameters */
+    int32_t* esp = (void *)&format;
+    esp++;
+
+    format_to_sink(&sink, format, esp);
+    emit_chars(buf, sink.len);
+    return sink.total;
+}
+
+/* int32_t snprintf(int8_t* buf, uint32_t size, int8_t* format, ...);
+ * Inputs: int8_t* buf = where to put the string
+ *         uint32_t size = size of buf, output is truncated to size-1 characters
+ *         int8_t* format = format string, see printf
+ * Return Value: number of characters written to buf, without the NULL
+ * Function: printf into a buffer */
+int32_t snprintf(int8_t* buf, uint32_t size, int8_t* format, ...) {
+    int32_t* esp = (void *)&format;
+    esp++;
+    return vsnprintf(buf, size, format, esp);
+}
+
+/* int32_t vsnprintf(int8_t* buf, uint32_t size, int8_t* format, int32_t* args);
+ * Inputs: int8_t* buf = where to put the string
+ *         uint32_t size = size of buf, output is truncated to size-1 characters
+ *         int8_t* format = format string, see printf
+ *         int32_t* args = first argument after the format string on the caller's stack
+ * Return Value: number of characters written to buf, without the NULL
+ * Function: snprintf for functions that take a format string themselves */
+int32_t vsnprintf(int8_t* buf, uint32_t size, int8_t* format, int32_t* args) {
+    fmt_sink_t sink = { buf, size, 0, 0, NULL };
+
+    if (size == 0) return 0;
+    format_to_sink(&sink, format, args);
+    buf[sink.len] = '\0';
+    return sink.len;
+}
+
+/* void emit_chars(const int8_t* s, uint32_t n);
+ * Inputs: const int8_t* s = characters to print
+ *              uint32_t n = number of characters
+ * Return Value: none
+ * Function: prints a formatted chunk to the terminal with interrupts
+ *           disabled once for the whole chunk instead of once per character */
+static void emit_chars(const int8_t* s, uint32_t n) {
+    uint32_t i;
+    long flags;
+    cli_and_save(flags);
+    for (i = 0; i < n; i++) {
+        print_char(s[i]);
+    }
+    restore_flags(flags);
 }
 
 /* int32_t puts(int8_t* s);
@@ -487,12 +588,55 @@ int8_t* strncpy(int8_t* dest, const int8_t* src, uint32_t n) {
     return dest;
 }
 
+/* uint32_t crc32(uint32_t crc, const void* buf, uint32_t n);
+ * Inputs: uint32_t crc = CRC of the data before buf, 0 to start
+ *         const void* buf = data
+ *         uint32_t n = number of bytes
+ * Return Value: the CRC-32 (IEEE, the one zlib uses) of the data so far
+ * Function: table driven, the table is built on the first call */
+uint32_t crc32(uint32_t crc, const void* buf, uint32_t n) {
+    static uint32_t table[256];
+    const uint8_t* p = (const uint8_t*)buf;
+    uint32_t i, j, c;
+
+    if (table[1] == 0) {
+        for (i = 0; i < 256; i++) {
+            for (c = i, j = 0; j < 8; j++) {
+                c = (c & 1) ? (c >> 1) ^ 0xEDB88320 : c >> 1;
+            }
+            table[i] = c;
+        }
+    }
+    crc = ~crc;
+    while (n-- > 0) {
+        crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/* int32_t bad_userspace_addr(const void* addr, int32_t len);
+ * Inputs: const void* addr = start of a buffer passed in by a user program
+ *               int32_t len = size of the buffer in bytes
+ * Return Value: 1 if any part of the buffer is outside the program's page, heap and stack, 0 otherwise
+ * Function: checks that a system call argument lies inside user memory */
+int32_t bad_userspace_addr(const void* addr, int32_t len) {
+    uint32_t start = (uint32_t)addr;
+    pcb_t* pcb = get_current_pcb();
+    if (len < 0) return 1;
+    if (pcb != NULL && start >= HEAP_ADDR_START && start < pcb->brk) return (uint32_t)len > pcb->brk - start;
+    if (pcb != NULL && start >= STACK_ADDR_END - pcb->stack_limit && start < STACK_ADDR_END) return (uint32_t)len > STACK_ADDR_END - start;
+    if (start < VIRTUAL_ADDR_START || start >= VIRTUAL_ADDR_START + PROGRAM_SIZE) return 1;
+    if ((uint32_t)len > VIRTUAL_ADDR_START + PROGRAM_SIZE - start) return 1;
+    return 0;
+}
+
 /* void test_interrupts(void)
  * Inputs: void
  * Return Value: void
  * Function: increments video memory. To be used to test rtc */
 void test_interrupts(void) {
     int32_t i;
+    char* video_mem = get_video_mem();
     for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
         video_mem[i << 1]++;
     }
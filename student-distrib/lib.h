@@ -7,8 +7,11 @@
 #ifndef ASM
 
 #include "types.h"
+#include "irqtrace.h"
 #include "terminal.h"
 int32_t printf(int8_t *format, ...);
+int32_t snprintf(int8_t* buf, uint32_t size, int8_t* format, ...);
+int32_t vsnprintf(int8_t* buf, uint32_t size, int8_t* format, int32_t* args);
 void putc(uint8_t c);
 int32_t puts(int8_t *s);
 int8_t *itoa(uint32_t value, int8_t* buf, int32_t radix);
@@ -25,6 +28,7 @@ void* memmove(void* dest, const void* src, uint32_t n);
 int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n);
 int8_t* strcpy(int8_t* dest, const int8_t*src);
 int8_t* strncpy(int8_t* dest, const int8_t*src, uint32_t n);
+uint32_t crc32(uint32_t crc, const void* buf, uint32_t n);
 
 /* Userspace address-check functions */
 int32_t bad_userspace_addr(const void* addr, int32_t len);
@@ -79,6 +83,49 @@ static inline uint32_t inl(port) {
     return val;
 }
 
+/* Reads the time-stamp counter, the number of CPU cycles since reset */
+static inline uint32_t rdtsc_low(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc"
+            : "=a"(lo), "=d"(hi)
+    );
+    return lo;
+}
+
+/* Reads the whole 64-bit time-stamp counter */
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc"
+            : "=a"(lo), "=d"(hi)
+    );
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Divides a 64-bit number by a 32-bit one with a single divl, there is no
+ * libgcc for 64-bit division. The quotient must fit in 32 bits, that is
+ * n >> 32 must be less than d */
+static inline uint32_t div64_32(uint64_t n, uint32_t d, uint32_t* rem) {
+    uint32_t q, r;
+    asm ("divl %4"
+            : "=a"(q), "=d"(r)
+            : "a"((uint32_t)n), "d"((uint32_t)(n >> 32)), "rm"(d)
+    );
+    if (rem != NULL) *rem = r;
+    return q;
+}
+
+/* Atomically replaces *ptr with new if it still holds old.
+ * Returns the value *ptr held, equal to old if the swap happened */
+static inline uint32_t cmpxchg(volatile uint32_t* ptr, uint32_t old, uint32_t new) {
+    uint32_t prev;
+    asm volatile ("lock cmpxchgl %2, %1"
+            : "=a"(prev), "+m"(*ptr)
+            : "r"(new), "0"(old)
+            : "memory", "cc"
+    );
+    return prev;
+}
+
 /* Writes a byte to a port */
 #define outb(data, port)                \
 do {                                    \
@@ -109,19 +156,27 @@ do {                                    \
     );                                  \
 } while (0)
 
-/* Clear interrupt flag - disables interrupts on this processor */
+/* Clear interrupt flag - disables interrupts on this processor
+ * If they were on, irqtrace times them from here */
 #define cli()                           \
 do {                                    \
-    asm volatile ("cli"                 \
-            :                           \
+    uint32_t cli_flags_;                \
+    asm volatile ("                   \n\
+            pushfl                    \n\
+            popl %0                   \n\
+            cli                       \n\
+            "                           \
+            : "=r"(cli_flags_)          \
             :                           \
             : "memory", "cc"            \
     );                                  \
+    IRQTRACE_OFF(cli_flags_);           \
 } while (0)
 
 /* Save flags and then clear interrupt flag
  * Saves the EFLAGS register into the variable "flags", and then
- * disables interrupts on this processor */
+ * disables interrupts on this processor. If they were on, irqtrace
+ * times them from here */
 #define cli_and_save(flags)             \
 do {                                    \
     asm volatile ("                   \n\
@@ -133,11 +188,13 @@ do {                                    \
             :                           \
             : "memory", "cc"            \
     );                                  \
+    IRQTRACE_OFF(flags);                \
 } while (0)
 
 /* Set interrupt flag - enable interrupts on this processor */
 #define sti()                           \
 do {                                    \
+    IRQTRACE_ON(EFLAGS_IF);             \
     asm volatile ("sti"                 \
             :                           \
             :                           \
@@ -150,6 +207,7 @@ do {                                    \
  * after a cli_and_save_flags(flags) */
 #define restore_flags(flags)            \
 do {                                    \
+    IRQTRACE_ON(flags);                 \
     asm volatile ("                   \n\
             pushl %0                  \n\
             popfl                     \n\
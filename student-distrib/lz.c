@@ -0,0 +1,77 @@
+#include "lz.h"
+#include "lib.h"
+
+#define LZ_MIN_MATCH    4       // a match length of 0 in a token means 4 bytes
+#define LZ_RUN_MASK     0xF     // nibble value that is followed by more length bytes
+
+
+/*
+    read_length
+    Description: Adds the extra length bytes that follow a nibble of 15
+    Input: ip - position in the input, moved past the bytes read
+           end - end of the input
+           len - the nibble
+    Output: the length, -1 if the input ends first
+*/
+static int32_t read_length(const uint8_t** ip, const uint8_t* end, uint32_t len) {
+    uint8_t b;
+
+    if (len != LZ_RUN_MASK) return len;
+    do {
+        if (*ip >= end) return -1;
+        b = *(*ip)++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+/*
+    lz_decompress
+    Description: Decodes one LZ4 block
+    Input: src - compressed data
+           src_len - its length
+           dst - buffer for the output
+           dst_len - size of dst
+    Output: number of bytes written, -1 if src is corrupt or the output does not fit
+    Effects: none besides writing dst, every read and write is bounds checked
+*/
+int32_t lz_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len) {
+    const uint8_t* ip = src;
+    const uint8_t* ip_end = src + src_len;
+    uint8_t* op = dst;
+    uint8_t* op_end = dst + dst_len;
+    const uint8_t* match;
+    int32_t len;
+    uint32_t offset;
+    uint8_t token;
+
+    while (ip < ip_end) {
+        token = *ip++;
+
+        // literals
+        len = read_length(&ip, ip_end, token >> 4);
+        if (len < 0 || len > ip_end - ip || len > op_end - op) return -1;
+        memcpy(op, ip, len);
+        ip += len;
+        op += len;
+        if (ip == ip_end) break;    // the last sequence has no match
+
+        // match
+        if (ip_end - ip < 2) return -1;
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst) return -1;
+        len = read_length(&ip, ip_end, token & LZ_RUN_MASK);
+        if (len < 0 || len + LZ_MIN_MATCH > op_end - op) return -1;
+        len += LZ_MIN_MATCH;
+        match = op - offset;
+        if (offset >= len) {
+            memcpy(op, match, len);
+            op += len;
+        } else {
+            // the copy overlaps its own output, e.g. a run of one byte
+            while (len-- > 0) *op++ = *match++;
+        }
+    }
+    return op - dst;
+}
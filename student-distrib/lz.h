@@ -0,0 +1,16 @@
+/* lz.h - LZ4 block decompressor
+ * Decodes the LZ4 block format (no frame header): sequences of literals
+ * followed by a copy of earlier output. Used for the data blocks of
+ * compressed file system images.
+ */
+
+#ifndef _LZ_H
+#define _LZ_H
+
+#include "types.h"
+
+/* Decodes src_len bytes of src into dst, returns the bytes written or -1 if
+ * the input is corrupt or does not fit in dst_len bytes */
+int32_t lz_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len);
+
+#endif /* _LZ_H */
@@ -0,0 +1,481 @@
+#include "mmap.h"
+#include "lib.h"
+#include "klog.h"
+
+#define MMAP_PDE    (MMAP_ADDR_START >> 22)     // page directory entry of the first table
+#define HEAP_PDE    (HEAP_ADDR_START >> 22)
+#define STACK_PDE   (STACK_ADDR_START >> 22)
+#define PAGE_UP(a)  (((a) + FOUR_KB - 1) & ~(FOUR_KB - 1))
+
+
+/*
+*   find_region
+*
+*   Input : pcb - the process
+*           addr - virtual address
+*   Output: the mapping that holds addr, NULL if there is none
+*/
+static mmap_region_t* find_region(pcb_t* pcb, uint32_t addr) {
+    int i;
+    for (i = 0; i < MMAP_MAX_REGIONS; i++) {
+        mmap_region_t* r = &pcb->mmaps[i];
+        if (r->addr != 0 && addr >= r->addr && addr < r->addr + r->pages * FOUR_KB) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+/*
+*   find_space
+*
+*   Input : pcb - the process
+*           pages - size of the new mapping
+*   Output: the lowest address with pages free pages, 0 if there is none
+*/
+static uint32_t find_space(pcb_t* pcb, uint32_t pages) {
+    uint32_t addr = MMAP_ADDR_START;
+    int i, moved = 1;
+
+    // move past every mapping that overlaps, until none does
+    while (moved) {
+        moved = 0;
+        for (i = 0; i < MMAP_MAX_REGIONS; i++) {
+            mmap_region_t* r = &pcb->mmaps[i];
+            if (r->addr != 0 && r->addr < addr + pages * FOUR_KB && addr < r->addr + r->pages * FOUR_KB) {
+                addr = r->addr + r->pages * FOUR_KB;
+                moved = 1;
+            }
+        }
+    }
+    if (pages > (MMAP_ADDR_END - addr) / FOUR_KB) return 0;
+    return addr;
+}
+
+/*
+*   page_entry
+*
+*   Input : pcb - the process
+*           addr - virtual address in the mmap area
+*   Output: the page table entry of addr, NULL if its table was not made yet
+*/
+static page_table_entry_t* page_entry(pcb_t* pcb, uint32_t addr) {
+    page_table_entry_t* table = pcb->mmap_tables[(addr - MMAP_ADDR_START) >> 22];
+    if (table == NULL) return NULL;
+    return &table[(addr >> 12) & (MAX_ENTRY - 1)];
+}
+
+/*
+*   heap_unmap
+*
+*   Input : pcb - the process
+*           start, end - page aligned heap addresses, [start, end)
+*   Output: None
+*   Effect: frees the frames of the mapped pages in the range
+*/
+static void heap_unmap(pcb_t* pcb, uint32_t start, uint32_t end) {
+    page_table_entry_t* table;
+    page_table_entry_t* pte;
+
+    for (; start < end; start += FOUR_KB) {
+        table = pcb->heap_tables[(start - HEAP_ADDR_START) >> 22];
+        if (table == NULL) continue;
+        pte = &table[(start >> 12) & (MAX_ENTRY - 1)];
+        if (!pte->present) continue;
+        frame_free((void*)(pte->base_addr << 12), 1);
+        *(uint32_t*)pte = 0;
+    }
+}
+
+/*
+*   load_tables
+*
+*   Input : pde - first page directory entry
+*           tables - page tables, NULL for none
+*           count - number of tables
+*   Output: None
+*/
+static void load_tables(page_directory_entry_t* pde, page_table_entry_t** tables, uint32_t count) {
+    uint32_t i;
+    for (i = 0; i < count; i++, pde++) {
+        if (tables[i] == NULL) {
+            pde->directory_4KB_entry_desc.present = 0;
+            continue;
+        }
+        pde->directory_4KB_entry_desc.present = 1;
+        pde->directory_4KB_entry_desc.read_write = 1;
+        pde->directory_4KB_entry_desc.user_supervisor = 1;
+        pde->directory_4KB_entry_desc.page_size = 0;
+        pde->directory_4KB_entry_desc.base_addr = (uint32_t)tables[i] >> 12;
+    }
+}
+
+
+/*
+*   mmap
+*
+*   Input : fd - an open regular file
+*           length - number of bytes to map from the start of the file, 0 for the whole file
+*           addr - set to where the file is mapped
+*   Output: number of bytes mapped
+*           -1 - if fd is not a file, the file is empty, or there is no room for the mapping
+*   Effect: reserves the addresses, the pages are read-only and map the data blocks
+*           of the file, so later writes to the file show through
+*/
+int32_t mmap(int32_t fd, uint32_t length, uint8_t** addr) {
+    pcb_t* pcb = get_current_pcb();
+    file_descriptor_entry_t* entry;
+    mmap_region_t* slot = NULL;
+    uint32_t file_length, pages, start, i;
+    long flags;
+
+    if (pcb == NULL || fd < 0 || fd >= max_file_descriptor || bad_userspace_addr(addr, sizeof(*addr))) {
+        return -1;
+    }
+    entry = &pcb->file_descriptor_ary[fd];
+    if (!(entry->flags & FD_IN_USE) || entry->file_operations_table_ptr->read != file_read) {
+        return -1;
+    }
+    // blocks are mapped as they are, so they have to start on page boundaries
+    if ((uint32_t)data_block_start & (FOUR_KB - 1)) {
+        return -1;
+    }
+    file_length = fs_file_length(entry->inode);
+    if (length == 0 || length > file_length) {
+        length = file_length;
+    }
+    if (length == 0) {
+        return -1;
+    }
+    pages = (length + FOUR_KB - 1) / FOUR_KB;
+
+    cli_and_save(flags);
+    for (i = 0; i < MMAP_MAX_REGIONS && slot == NULL; i++) {
+        if (pcb->mmaps[i].addr == 0) slot = &pcb->mmaps[i];
+    }
+    start = find_space(pcb, pages);
+    if (slot == NULL || start == 0) {
+        restore_flags(flags);
+        return -1;
+    }
+    // page tables for the addresses the mapping covers
+    for (i = (start - MMAP_ADDR_START) >> 22; i <= (start + pages * FOUR_KB - 1 - MMAP_ADDR_START) >> 22; i++) {
+        if (pcb->mmap_tables[i] == NULL) {
+            pcb->mmap_tables[i] = frame_alloc(1);
+            if (pcb->mmap_tables[i] == NULL) {
+                restore_flags(flags);
+                return -1;
+            }
+            memset(pcb->mmap_tables[i], 0, FOUR_KB);
+        }
+    }
+    slot->addr = start;
+    slot->pages = pages;
+    slot->inode = entry->inode;
+    mmap_load(pcb);
+    restore_flags(flags);
+
+    flush_tlb();
+    *addr = (uint8_t*)start;
+    return length;
+}
+
+/*
+*   munmap
+*
+*   Input : addr - address mmap returned
+*   Output: 0 - if it worked fine
+*           -1 - if no mapping starts at addr
+*   Effect: unmaps the pages, later accesses fault
+*/
+int32_t munmap(void* addr) {
+    pcb_t* pcb = get_current_pcb();
+    mmap_region_t* r;
+    page_table_entry_t* pte;
+    uint32_t i;
+    long flags;
+
+    if (pcb == NULL) return -1;
+    cli_and_save(flags);
+    r = find_region(pcb, (uint32_t)addr);
+    if (r == NULL || r->addr != (uint32_t)addr) {
+        restore_flags(flags);
+        return -1;
+    }
+    for (i = 0; i < r->pages; i++) {
+        pte = page_entry(pcb, r->addr + i * FOUR_KB);
+        if (pte != NULL) *(uint32_t*)pte = 0;
+    }
+    r->addr = 0;
+    restore_flags(flags);
+
+    flush_tlb();
+    return 0;
+}
+
+/*
+*   sbrk
+*
+*   Input : increment - bytes to grow the heap by, negative to shrink it
+*   Output: the old end of the heap
+*           -1 - if the heap would leave the heap area, or no frame is free
+*   Effect: maps zeroed pages for the addresses that become part of the heap,
+*           frees the pages that stop being part of it. Growing takes and zeroes
+*           each frame with interrupts on and moves the break up a page at a time
+*/
+int32_t sbrk(int32_t increment) {
+    pcb_t* pcb = get_current_pcb();
+    page_table_entry_t** table;
+    page_table_entry_t* pte;
+    uint32_t old, new, cur, page;
+    void* frame;
+    void* spare;
+    long flags;
+
+    if (pcb == NULL) return -1;
+    cli_and_save(flags);
+    old = pcb->brk;
+    if (increment > (int32_t)(HEAP_ADDR_END - old) || increment < -(int32_t)(old - HEAP_ADDR_START)) {
+        restore_flags(flags);
+        return -1;
+    }
+    new = old + increment;
+    if (new <= PAGE_UP(old)) {      // no page to map, only ones to free
+        heap_unmap(pcb, PAGE_UP(new), PAGE_UP(old));
+        pcb->brk = new;
+        restore_flags(flags);
+        flush_tlb();
+        return old;
+    }
+    restore_flags(flags);
+
+    cur = old;
+    for (page = PAGE_UP(old); page < new; page += FOUR_KB) {
+        table = &pcb->heap_tables[(page - HEAP_ADDR_START) >> 22];
+        spare = (*table == NULL) ? frame_alloc(1) : NULL;
+        if (spare != NULL) memset(spare, 0, FOUR_KB);
+        frame = frame_alloc(1);
+        if (frame != NULL) memset(frame, 0, FOUR_KB);
+
+        cli_and_save(flags);
+        if (pcb->brk != cur) {      // the break moved while interrupts were on, leave it there
+            restore_flags(flags);
+            if (frame != NULL) frame_free(frame, 1);
+            if (spare != NULL) frame_free(spare, 1);
+            return -1;
+        }
+        if (*table == NULL && spare != NULL) {
+            *table = spare;
+            spare = NULL;
+            mmap_load(pcb);
+        }
+        if (*table == NULL || frame == NULL) {
+            heap_unmap(pcb, PAGE_UP(old), page);
+            pcb->brk = old;
+            restore_flags(flags);
+            if (frame != NULL) frame_free(frame, 1);
+            if (spare != NULL) frame_free(spare, 1);
+            flush_tlb();
+            return -1;
+        }
+        pte = &(*table)[(page >> 12) & (MAX_ENTRY - 1)];
+        pte->present = 1;
+        pte->read_write = 1;
+        pte->user_supervisor = 1;
+        pte->base_addr = (uint32_t)frame >> 12;
+        cur = (new - page > FOUR_KB) ? page + FOUR_KB : new;
+        pcb->brk = cur;
+        restore_flags(flags);
+        if (spare != NULL) frame_free(spare, 1);    // the table was made while this one was zeroed
+    }
+
+    flush_tlb();
+    return old;
+}
+
+/*
+*   mmap_reset
+*
+*   Input : pcb - a process being created
+*   Output: None
+*   Effect: the process starts with no mappings, an empty heap and no page tables
+*/
+void mmap_reset(pcb_t* pcb) {
+    memset(pcb->mmaps, 0, sizeof(pcb->mmaps));
+    memset(pcb->mmap_tables, 0, sizeof(pcb->mmap_tables));
+    memset(pcb->heap_tables, 0, sizeof(pcb->heap_tables));
+    pcb->brk = HEAP_ADDR_START;
+    pcb->stack_table = NULL;
+    pcb->stack_limit = STACK_LIMIT;
+}
+
+/*
+*   mmap_release
+*
+*   Input : pcb - a process that is halting
+*   Output: None
+*   Effect: frees the heap and the page tables of the process and forgets its mappings
+*/
+void mmap_release(pcb_t* pcb) {
+    int i;
+    for (i = 0; i < MMAP_TABLES; i++) {
+        if (pcb->mmap_tables[i] != NULL) {
+            frame_free(pcb->mmap_tables[i], 1);
+        }
+    }
+    heap_unmap(pcb, HEAP_ADDR_START, PAGE_UP(pcb->brk));
+    for (i = 0; i < HEAP_TABLES; i++) {
+        if (pcb->heap_tables[i] != NULL) {
+            frame_free(pcb->heap_tables[i], 1);
+        }
+    }
+    if (pcb->stack_table != NULL) {
+        for (i = 0; i < MAX_ENTRY; i++) {
+            if (pcb->stack_table[i].present) frame_free((void*)(pcb->stack_table[i].base_addr << 12), 1);
+        }
+        frame_free(pcb->stack_table, 1);
+    }
+    mmap_reset(pcb);
+}
+
+/*
+*   mmap_load
+*
+*   Input : pcb - the process that runs next
+*   Output: None
+*   Effect: sets the page directory entries of the mmap, heap and stack areas to the page tables of the process
+*/
+void mmap_load(pcb_t* pcb) {
+    load_tables(&page_directory[MMAP_PDE], pcb->mmap_tables, MMAP_TABLES);
+    load_tables(&page_directory[HEAP_PDE], pcb->heap_tables, HEAP_TABLES);
+    load_tables(&page_directory[STACK_PDE], &pcb->stack_table, 1);
+}
+
+/*
+*   mmap_fault
+*
+*   Input : addr - the address that faulted
+*           error - error code of the page fault
+*   Output: 0 - if the page was mapped
+*           -1 - if addr is not in a mapping, the access was a write, or the file
+*                shrank past the page
+*   Effect: maps the data block that holds the page, read-only
+*/
+int32_t mmap_fault(uint32_t addr, uint32_t error) {
+    pcb_t* pcb = get_current_pcb();
+    mmap_region_t* r;
+    page_table_entry_t* pte;
+    uint8_t* block;
+    long flags;
+
+    if (pcb == NULL || addr < MMAP_ADDR_START || addr >= MMAP_ADDR_END || (error & PF_WRITE)) {
+        return -1;
+    }
+    cli_and_save(flags);
+    r = find_region(pcb, addr);
+    pte = page_entry(pcb, addr);
+    block = (r == NULL) ? NULL : fs_data_block(r->inode, (addr - r->addr) / FOUR_KB);
+    if (pte == NULL || block == NULL) {
+        restore_flags(flags);
+        return -1;
+    }
+    pte->present = 1;
+    pte->read_write = 0;
+    pte->user_supervisor = 1;
+    pte->base_addr = (uint32_t)block >> 12;
+    restore_flags(flags);
+
+    asm volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+    return 0;
+}
+
+/*
+*   mmap_shrink
+*
+*   Input : inode - a file that is being shortened
+*           pages - pages of the file that stay, the data blocks after them are freed
+*   Output: None
+*   Effect: every process that mapped the file loses the pages past the new end,
+*           so no mapping keeps reading a block another file may get. Touching them
+*           again faults like any page past the end of the file
+*/
+void mmap_shrink(uint32_t inode, uint32_t pages) {
+    pcb_t* current = get_current_pcb();
+    pcb_t* pcb;
+    mmap_region_t* r;
+    page_table_entry_t* pte;
+    uint32_t pid, i, addr;
+    long flags;
+
+    cli_and_save(flags);
+    for (pid = 0; pid < MAX_PID; pid++) {
+        if (!pid_arr[pid]) continue;
+        pcb = (pcb_t*)(EIGHT_MB - EIGHT_KB * (pid + 1));
+        for (r = pcb->mmaps; r < pcb->mmaps + MMAP_MAX_REGIONS; r++) {
+            if (r->addr == 0 || r->inode != inode || r->pages <= pages) continue;
+            for (i = pages; i < r->pages; i++) {
+                addr = r->addr + i * FOUR_KB;
+                pte = page_entry(pcb, addr);
+                if (pte == NULL || !pte->present) continue;
+                *(uint32_t*)pte = 0;
+                // other processes get a fresh TLB when they are switched back in
+                if (pcb == current) asm volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+            }
+        }
+    }
+    restore_flags(flags);
+}
+
+/*
+*   stack_fault
+*
+*   Input : addr - the address that faulted
+*           error - error code of the page fault
+*   Output: 0 - if a stack page was mapped
+*           -1 - if addr is not in the stack, or below the stack limit. A fault in
+*                the guard page right below the limit is logged as a stack overflow
+*   Effect: maps a zeroed page at addr, the stack grows one page at a time
+*/
+int32_t stack_fault(uint32_t addr, uint32_t error) {
+    pcb_t* pcb = get_current_pcb();
+    page_table_entry_t* pte;
+    void* frame;
+    long flags;
+
+    if (pcb == NULL || addr < STACK_ADDR_START || addr >= STACK_ADDR_END || (error & PF_PRESENT)) {
+        return -1;
+    }
+    if (addr < STACK_ADDR_END - pcb->stack_limit) {
+        if (addr >= STACK_ADDR_END - pcb->stack_limit - FOUR_KB) {
+            klog(KLOG_ERR, "pid %u: stack overflow at 0x%x", pcb->pid, addr);
+        }
+        return -1;
+    }
+    cli_and_save(flags);
+    if (pcb->stack_table == NULL) {
+        pcb->stack_table = frame_alloc(1);
+        if (pcb->stack_table == NULL) {
+            restore_flags(flags);
+            return -1;
+        }
+        memset(pcb->stack_table, 0, FOUR_KB);
+        mmap_load(pcb);
+        flush_tlb();
+    }
+    frame = frame_alloc(1);
+    if (frame == NULL) {
+        restore_flags(flags);
+        klog(KLOG_ERR, "pid %u: no frame for the stack at 0x%x", pcb->pid, addr);
+        return -1;
+    }
+    memset(frame, 0, FOUR_KB);
+    pte = &pcb->stack_table[(addr >> 12) & (MAX_ENTRY - 1)];
+    pte->present = 1;
+    pte->read_write = 1;
+    pte->user_supervisor = 1;
+    pte->base_addr = (uint32_t)frame >> 12;
+    restore_flags(flags);
+
+    asm volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+    return 0;
+}
@@ -0,0 +1,44 @@
+/* mmap.h - read-only mappings of files into user space, the heap and the stack
+ * Mappings live between MMAP_ADDR_START and MMAP_ADDR_END, through 4KB
+ * page tables of the process. Pages are filled in by the page fault handler
+ * the first time they are touched. The heap starts at HEAP_ADDR_START and
+ * its pages are mapped by sbrk as the break moves up. The stack pages below
+ * STACK_ADDR_END are mapped by the page fault handler, down to the stack limit.
+ */
+
+#ifndef _MMAP_H
+#define _MMAP_H
+
+#include "syscall.h"
+
+#define PF_PRESENT  0x1     // page fault error code: the page was present
+#define PF_WRITE    0x2     // the access was a write
+
+/* Maps the first length bytes of an open file, the whole file if length is 0, returns the bytes mapped */
+int32_t mmap(int32_t fd, uint32_t length, uint8_t** addr);
+
+/* Removes the mapping that starts at addr */
+int32_t munmap(void* addr);
+
+/* Moves the end of the heap by increment bytes, returns the old end */
+int32_t sbrk(int32_t increment);
+
+/* Clears the mappings, the heap and the stack of a new process */
+void mmap_reset(pcb_t* pcb);
+
+/* Removes every mapping of a process, frees its heap, its stack and its page tables */
+void mmap_release(pcb_t* pcb);
+
+/* Points the page directory at the page tables of a process, flush the TLB after */
+void mmap_load(pcb_t* pcb);
+
+/* Maps the page of a mapped file at addr, 0 if addr was in a mapping */
+int32_t mmap_fault(uint32_t addr, uint32_t error);
+
+/* Unmaps the pages of a file past its first pages from every process, before its blocks are freed */
+void mmap_shrink(uint32_t inode, uint32_t pages);
+
+/* Maps a zeroed stack page at addr, 0 if addr was in the stack and below the limit */
+int32_t stack_fault(uint32_t addr, uint32_t error);
+
+#endif /* _MMAP_H */
@@ -0,0 +1,392 @@
+#include "page_cache.h"
+#include "lib.h"
+#include "paging.h"
+#include "syscall.h"
+#include "slab.h"
+
+#define HASH(inode, index)  (((inode) * 31 + (index)) & (PAGE_CACHE_HASH - 1))
+
+static kmem_cache_t page_objs;    // where the page_t of every page comes from
+static page_t* pages[PAGE_CACHE_PAGES];
+static uint32_t page_count = 0;     // pages made so far, they are never freed
+static page_t* hash_table[PAGE_CACHE_HASH];
+static page_t* lru_head;    // next page to reuse
+static page_t* lru_tail;    // most recently used
+static page_fill_t page_fill;
+
+uint32_t page_cache_hits = 0;
+uint32_t page_cache_misses = 0;
+uint32_t page_cache_evictions = 0;
+uint32_t page_cache_readaheads = 0;
+
+
+/*
+    lru_remove
+    Description: Takes a page off the LRU list
+    Input: page - an unreferenced page
+    Output: none
+*/
+static void lru_remove(page_t* page) {
+    if (page->lru_prev) page->lru_prev->lru_next = page->lru_next;
+    else lru_head = page->lru_next;
+    if (page->lru_next) page->lru_next->lru_prev = page->lru_prev;
+    else lru_tail = page->lru_prev;
+    page->lru_prev = page->lru_next = NULL;
+}
+
+/*
+    lru_add
+    Description: Puts a page on the LRU list, valid pages as most recently used,
+                 invalid ones first in line for reuse
+    Input: page - a page that just lost its last reference
+    Output: none
+*/
+static void lru_add(page_t* page) {
+    if (page->valid) {
+        page->lru_prev = lru_tail;
+        page->lru_next = NULL;
+        if (lru_tail) lru_tail->lru_next = page;
+        else lru_head = page;
+        lru_tail = page;
+    } else {
+        page->lru_prev = NULL;
+        page->lru_next = lru_head;
+        if (lru_head) lru_head->lru_prev = page;
+        else lru_tail = page;
+        lru_head = page;
+    }
+}
+
+/*
+    hash_remove
+    Description: Makes a page invalid, so lookups no longer find it
+    Input: page - a valid page
+    Output: none
+*/
+static void hash_remove(page_t* page) {
+    page_t** p = &hash_table[HASH(page->inode, page->index)];
+
+    while (*p != page) p = &(*p)->hash_next;
+    *p = page->hash_next;
+    page->hash_next = NULL;
+    page->valid = 0;
+}
+
+/*
+    page_lookup
+    Input: inode, index - the block
+    Output: the valid page holding the block, NULL if it is not cached
+*/
+static page_t* page_lookup(uint32_t inode, uint32_t index) {
+    page_t* page;
+
+    for (page = hash_table[HASH(inode, index)]; page != NULL; page = page->hash_next) {
+        if (page->inode == inode && page->index == index) return page;
+    }
+    return NULL;
+}
+
+/*
+    page_new
+    Description: Makes another page while the cache has fewer than PAGE_CACHE_PAGES
+    Input: none
+    Output: the page, invalid and on no list, NULL if the cache is full or out of memory
+*/
+static page_t* page_new(void) {
+    page_t* page;
+
+    if (page_count >= PAGE_CACHE_PAGES) return NULL;
+    page = (page_t*)kmem_cache_alloc(&page_objs);
+    if (page == NULL) return NULL;
+    memset(page, 0, sizeof(page_t));
+    page->data = frame_alloc(1);
+    if (page->data == NULL) {
+        kmem_cache_free(&page_objs, page);
+        return NULL;
+    }
+    pages[page_count++] = page;
+    return page;
+}
+
+
+/*
+    page_cache_init
+    Description: Forgets every page and sets the backing store
+    Input: fill - reads a block from the backing store
+    Output: none
+    Effects: pages made earlier are kept for reuse
+*/
+void page_cache_init(page_fill_t fill) {
+    uint32_t i;
+    long flags;
+
+    if (page_objs.size == 0) kmem_cache_init(&page_objs, "page_t", sizeof(page_t));
+    cli_and_save(flags);
+    page_fill = fill;
+    lru_head = lru_tail = NULL;
+    memset(hash_table, 0, sizeof(hash_table));
+    for (i = 0; i < page_count; i++) {
+        pages[i]->valid = 0;
+        pages[i]->refcount = 0;
+        pages[i]->filling = 0;
+        pages[i]->hash_next = NULL;
+        lru_add(pages[i]);
+    }
+    restore_flags(flags);
+}
+
+/*
+    page_get
+    Description: Finds the page holding a block, or fills an unused page from the
+                 backing store: an invalid one, a new one while the cache can
+                 grow, or else the least recently used unreferenced one. The fill
+                 runs with interrupts on, a page_get for the same block waits for it
+    Input: inode - the file
+           index - block of the file
+    Output: the page, NULL if every page is referenced, no frame is free or the fill
+            failed, or the block is being filled and interrupts are off
+    Effects: references the page, it stays cached until page_put
+*/
+page_t* page_get(uint32_t inode, uint32_t index) {
+    page_t* page;
+    int32_t ret;
+    long flags;
+
+    cli_and_save(flags);
+    page = page_lookup(inode, index);
+    if (page != NULL) {
+        ++page_cache_hits;
+        if (page->refcount++ == 0) lru_remove(page);
+        // the filler holds a reference, so the page can't be reused while we wait
+        while (page->filling && (flags & EFLAGS_IF)) {
+            restore_flags(flags);
+            asm volatile ("hlt");
+            cli_and_save(flags);
+        }
+        if (page->filling || !page->valid) {    // could not wait, or the fill failed or went stale
+            if (--page->refcount == 0) lru_add(page);
+            page = NULL;
+        }
+        restore_flags(flags);
+        return page;
+    }
+
+    ++page_cache_misses;
+    // invalid pages are at the head of the LRU list
+    page = (lru_head != NULL && !lru_head->valid) ? lru_head : page_new();
+    if (page == NULL) page = lru_head;
+    if (page == NULL) {
+        restore_flags(flags);
+        return NULL;
+    }
+    if (page == lru_head) lru_remove(page);
+    if (page->valid) {
+        ++page_cache_evictions;
+        hash_remove(page);
+    }
+
+    // claim the block, so other lookups wait for the fill instead of filling a second page
+    page->inode = inode;
+    page->index = index;
+    page->refcount = 1;
+    page->valid = 1;
+    page->filling = 1;
+    page->hash_next = hash_table[HASH(inode, index)];
+    hash_table[HASH(inode, index)] = page;
+    restore_flags(flags);
+
+    ret = (page_fill == NULL) ? -1 : page_fill(inode, index, page->data);
+
+    cli_and_save(flags);
+    page->filling = 0;
+    // a write or drop during the fill made the page invalid, its data may be old
+    if (ret != 0 || !page->valid) {
+        if (page->valid) hash_remove(page);
+        if (--page->refcount == 0) lru_add(page);
+        page = NULL;
+    }
+    restore_flags(flags);
+    return page;
+}
+
+/*
+    page_put
+    Description: Drops a reference taken by page_get
+    Input: page - the page
+    Output: none
+    Effects: an unreferenced page becomes the most recently used one
+*/
+void page_put(page_t* page) {
+    long flags;
+
+    if (page == NULL) return;
+    cli_and_save(flags);
+    if (page->refcount > 0 && --page->refcount == 0) lru_add(page);
+    restore_flags(flags);
+}
+
+/*
+    page_cache_readahead
+    Description: Loads blocks into the cache before they are read
+    Input: inode - the file
+           index - first block
+           count - number of blocks
+    Output: none
+    Effects: stops at the end of the file, or when no page is left to fill
+*/
+void page_cache_readahead(uint32_t inode, uint32_t index, uint32_t count) {
+    page_t* page;
+    long flags;
+
+    for (; count > 0; index++, count--) {
+        cli_and_save(flags);
+        page = page_lookup(inode, index);
+        restore_flags(flags);
+        if (page != NULL) continue;     // already cached, leave its place in the LRU list
+
+        page = page_get(inode, index);
+        if (page == NULL) return;
+        ++page_cache_readaheads;
+        page_put(page);
+    }
+}
+
+/*
+    page_cache_write
+    Description: Keeps the cached pages of a file the same as the backing store after a write
+    Input: inode - the file
+           offset - where the write started
+           buf - the data written
+           length - number of bytes written
+    Output: none
+*/
+void page_cache_write(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length) {
+    uint32_t pos, chunk, end = offset + length;
+    page_t* page;
+    long flags;
+
+    // one page at a time, so a long write keeps interrupts off for one page copy at most
+    for (pos = offset; pos < end; pos += chunk) {
+        chunk = PAGE_SIZE - pos % PAGE_SIZE;
+        if (chunk > end - pos) chunk = end - pos;
+        cli_and_save(flags);
+        page = page_lookup(inode, pos / PAGE_SIZE);
+        if (page != NULL && page->filling) {
+            hash_remove(page);      // the fill may copy the old data over this write
+        } else if (page != NULL) {
+            memcpy(page->data + pos % PAGE_SIZE, buf + (pos - offset), chunk);
+        }
+        restore_flags(flags);
+    }
+}
+
+/*
+    page_cache_drop
+    Description: Forgets the pages of a file from a block on
+    Input: inode - the file
+           index - first block to forget
+    Output: none
+    Effects: referenced pages are reused once they are put back
+*/
+void page_cache_drop(uint32_t inode, uint32_t index) {
+    uint32_t i;
+    long flags;
+
+    cli_and_save(flags);
+    for (i = 0; i < page_count; i++) {
+        if (pages[i]->valid && pages[i]->inode == inode && pages[i]->index >= index) {
+            hash_remove(pages[i]);
+            if (pages[i]->refcount == 0) {
+                lru_remove(pages[i]);
+                lru_add(pages[i]);
+            }
+        }
+    }
+    restore_flags(flags);
+}
+
+
+/*
+    page_cache_open
+    Input: filename - ignored
+    Output: 0
+*/
+int32_t page_cache_open(const uint8_t* filename) {
+    return 0;
+}
+
+/*
+    page_cache_close
+    Input: fd - ignored
+    Output: 0
+*/
+int32_t page_cache_close(int32_t fd) {
+    return 0;
+}
+
+/*
+    page_cache_read
+    Description: Reads the cache statistics as text
+    Input: fd - file descriptor, its position is the offset in the text
+           buf - buffer
+           nbytes - size of buf
+    Output: number of bytes read, 0 at the end of the text
+*/
+int32_t page_cache_read(int32_t fd, void* buf, int32_t nbytes) {
+    int8_t text[160];
+    uint32_t i, used = 0, len;
+    file_descriptor_entry_t* entry = &get_current_pcb()->file_descriptor_ary[fd];
+
+    if (buf == NULL || nbytes < 0) return -1;
+    for (i = 0; i < page_count; i++) {
+        used += pages[i]->valid;
+    }
+    len = snprintf(text, sizeof(text), "hits %u\nmisses %u\nevictions %u\nreadahead %u\npages %u/%u\n",
+                   page_cache_hits, page_cache_misses, page_cache_evictions, page_cache_readaheads,
+                   used, PAGE_CACHE_PAGES);
+    if (entry->file_position >= len) return 0;
+    if (nbytes > len - entry->file_position) nbytes = len - entry->file_position;
+    memcpy(buf, text + entry->file_position, nbytes);
+    entry->file_position += nbytes;
+    return nbytes;
+}
+
+/*
+    page_cache_write_ctl
+    Description: Runs a command, "drop" empties the cache, "reset" clears the statistics
+    Input: fd - ignored
+           buf - the command, a trailing newline is allowed
+           nbytes - length of the command
+    Output: nbytes, -1 if the command is unknown
+*/
+int32_t page_cache_write_ctl(int32_t fd, const void* buf, int32_t nbytes) {
+    uint32_t i;
+    long flags;
+
+    if (buf == NULL || nbytes < 4) return -1;
+    if (strncmp((int8_t*)buf, "drop", 4) == 0) {
+        cli_and_save(flags);
+        for (i = 0; i < page_count; i++) {
+            if (pages[i]->valid && pages[i]->refcount == 0) {
+                hash_remove(pages[i]);
+                lru_remove(pages[i]);
+                lru_add(pages[i]);
+            }
+        }
+        restore_flags(flags);
+    } else if (nbytes >= 5 && strncmp((int8_t*)buf, "reset", 5) == 0) {
+        page_cache_hits = page_cache_misses = page_cache_evictions = page_cache_readaheads = 0;
+    } else {
+        return -1;
+    }
+    return nbytes;
+}
+
+/*
+    page_cache_poll
+    Input: fd - ignored
+    Output: POLLIN | POLLOUT, never blocks
+*/
+int32_t page_cache_poll(int32_t fd) {
+    return POLLIN | POLLOUT;
+}
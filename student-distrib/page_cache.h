@@ -0,0 +1,65 @@
+/* page_cache.h - 4KB pages of file data keyed by (inode, block index)
+ * Pages are filled from the backing store on a miss and reused least
+ * recently used first. A page can't be reused while it is referenced.
+ * A miss claims its page with interrupts off, fills it with interrupts on
+ * and publishes it with interrupts off again.
+ */
+
+#ifndef _PAGE_CACHE_H
+#define _PAGE_CACHE_H
+
+#include "types.h"
+
+#define PAGE_CACHE_PAGES    128     // frames the cache may take from the frame pool (512KB)
+#define PAGE_CACHE_HASH     256     // must be a power of 2
+#define PAGE_SIZE           4096    // same as DATA_BLOCK_SIZE
+
+/* a cached block of a file, from a slab cache */
+typedef struct page_t {
+    uint32_t inode;
+    uint32_t index;             // block of the file
+    uint32_t refcount;          // page_get calls not yet matched by page_put
+    uint8_t valid;              // 1 if data holds (inode, index), or will once filled
+    uint8_t filling;            // 1 while page_get fills data with interrupts on
+    uint8_t* data;              // one frame, taken with the page
+    struct page_t* hash_next;   // pages in the same hash bucket
+    struct page_t* lru_prev;    // unreferenced pages, least recently used at lru_head
+    struct page_t* lru_next;
+} page_t;
+
+/* reads block index of inode from the backing store into a page, 0 on success */
+typedef int32_t (*page_fill_t)(uint32_t inode, uint32_t index, uint8_t* data);
+
+/* cache statistics, readable through the "pagecache" file */
+extern uint32_t page_cache_hits;
+extern uint32_t page_cache_misses;
+extern uint32_t page_cache_evictions;
+extern uint32_t page_cache_readaheads;
+
+/* Forgets every page and sets the backing store */
+void page_cache_init(page_fill_t fill);
+
+/* Returns the referenced page holding block index of inode, NULL if no page could be filled */
+page_t* page_get(uint32_t inode, uint32_t index);
+
+/* Drops a reference taken by page_get */
+void page_put(page_t* page);
+
+/* Loads count blocks of inode from block index on, stops at the end of the file */
+void page_cache_readahead(uint32_t inode, uint32_t index, uint32_t count);
+
+/* Copies a write to the file into the pages it touches that are cached */
+void page_cache_write(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length);
+
+/* Forgets the pages of inode from block index on, after the file shrank or its tail changed */
+void page_cache_drop(uint32_t inode, uint32_t index);
+
+/* "pagecache" control file: reads the statistics, writing "drop" empties the
+ * cache and "reset" clears the statistics */
+int32_t page_cache_open(const uint8_t* filename);
+int32_t page_cache_close(int32_t fd);
+int32_t page_cache_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t page_cache_write_ctl(int32_t fd, const void* buf, int32_t nbytes);
+int32_t page_cache_poll(int32_t fd);
+
+#endif /* _PAGE_CACHE_H */
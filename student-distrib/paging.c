@@ -1,4 +1,5 @@
 #include "paging.h"
+#include "lib.h"
 
 #define ASM     0
 
@@ -62,6 +63,11 @@ void page_init() {
     video_page_table[vid_mem_idx].present = 1;
     video_page_table[vid_mem_idx].base_addr = VID_MEM_ADDR >> 12;   // 20 most significant bits
 
+    /* kernel only mapping for the frames below the kernel */
+    for (j = FRAME_LOW_START >> 12; j < KERNEL_ADDR >> 12; j++) {
+        video_page_table[j].present = 1;
+    }
+
 
     /* set up for kernel */
     page_directory[1].directory_4MB_entry_desc.present = 1;
@@ -78,6 +84,13 @@ void page_init() {
     page_directory[1].directory_4MB_entry_desc.rsvd = 0;
     page_directory[1].directory_4MB_entry_desc.offset_bits_31_22 = KERNEL_ADDR >> 22;   // 10 most significant bits
 
+    /* kernel only direct map of the frames above the kernel, up to user space */
+    for (i = (KERNEL_ADDR >> 22) + 1; i < DIRECT_MAP_END >> 22; i++) {
+        page_directory[i].directory_4MB_entry_desc.present = 1;
+        page_directory[i].directory_4MB_entry_desc.page_size = 1;
+        page_directory[i].directory_4MB_entry_desc.offset_bits_31_22 = i;
+    }
+
     loadPageDirectory(page_directory);
     enablePaging();
 }
@@ -95,3 +108,4 @@ void page_terminal_vidmem(int terminal){
     video_page_table[vid_mem_idx].base_addr = vid_mem_idx;   // 20 most significant bits
     video_page_table[vid_mem_idx].present = 1;
 }
+
@@ -12,6 +12,19 @@
 #define KERNEL_ADDR  0x400000    // The kernel is loaded at physical address 0x400000 (4 MB), and also mapped at virtual address 4 MB. (from Appendix C)
 #define VID_MEM_ADDR 0xB8000      //the address of the video memory
 
+/* Physical frames come from the RAM in the boot loader's memory map. RAM below
+ * DIRECT_MAP_END is the direct zone: it is identity mapped for the kernel (1MB-4MB
+ * through video_page_table, 8MB up with 4MB pages) and handed out in buddy blocks
+ * of 4KB frames. RAM above it is the high zone, only used for 4MB program frames. */
+#define FRAME_LOW_START     0x100000    // 1MB, above the BIOS area
+#define DIRECT_MAP_END      0x8000000   // 128MB, where user space starts
+#define DIRECT_FRAMES       (DIRECT_MAP_END / FOUR_K_BYTE)
+#define HIGH_FRAMES         992         // 4MB frames from 128MB to 4GB
+#define FRAME_MAX_ORDER     10          // largest block, 2^10 frames = 4MB
+#define FRAME_ORDERS        (FRAME_MAX_ORDER + 1)
+#define MEM_MAX_RANGES      16          // memory map entries and reserved ranges kept
+#define MEM_LIMIT           0xFFFFFFFF  // RAM past 4GB is not used
+
 
 typedef union page_directory_entry_t{
 
@@ -71,6 +84,26 @@ extern void page_init();
 extern void loadPageDirectory(page_directory_entry_t*);
 extern void enablePaging();
 extern void page_terminal_vidmem(int terminal);
+extern void mem_add_range(uint32_t start, uint32_t length);
+extern void mem_reserve(uint32_t start, uint32_t end);
+extern void frame_init();
+extern void* frame_alloc(uint32_t count);
+extern void frame_free(void* frame, uint32_t count);
+extern uint32_t frame_in_use(const void* addr);
+extern uint32_t program_frame_alloc();
+extern void program_frame_free(uint32_t frame);
+extern uint32_t mem_total_kb();
+
+/* allocator statistics, readable through the "meminfo" file */
+extern uint32_t frame_allocs;
+extern uint32_t frame_frees;
+extern uint32_t frame_failures;
+
+int32_t meminfo_open(const uint8_t* filename);
+int32_t meminfo_close(int32_t fd);
+int32_t meminfo_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t meminfo_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t meminfo_poll(int32_t fd);
 
 #endif
 #endif
@@ -1,5 +1,9 @@
 #include "pit.h"
 #include "terminal.h"
+#include "timer.h"
+#include "softirq.h"
+
+volatile uint32_t pit_ticks = 0;
 
 /*
     pit_init
@@ -10,6 +14,8 @@
 void pit_init() {
     long flags;
     cli_and_save(flags);
+    pit_ticks = 0;
+    timer_wheel_init(&timer_wheel, pit_ticks);
     outb(PIT_CMD_INIT1, PIT_CMD_PORT);
     outb(PIT_CH0_INIT2, PIT_CH0_PORT);
     outb(PIT_CH0_INIT3, PIT_CH0_PORT);
@@ -22,7 +28,8 @@ void pit_init() {
     pit_rtc_handler
     Input: None
     Output: none
-    Effects: handler for pit when it interrupts
+    Effects: handler for pit when it interrupts, the timer wheel and the
+             kernel log run as softirqs after it
 */
 void pit_irq_handler() {
     int current_esp;
@@ -32,9 +39,15 @@ void pit_irq_handler() {
          :"=r" (current_esp), "=r" (current_ebp)
     );
     
-    esp_ebp_term[process_terminal][0] = current_esp;
-    esp_ebp_term[process_terminal][1] = current_ebp;
-
+    ++pit_ticks;
+    softirq_raise(SOFTIRQ_TIMER);
+    softirq_raise(SOFTIRQ_KLOG);
     send_eoi(PIT_IRQ);
+
+    // an interrupted softirq may have process_terminal borrowed, switch on the next tick
+    if (softirq_active()) return;
+
+    terminals[process_terminal]->esp = current_esp;
+    terminals[process_terminal]->ebp = current_ebp;
     scheduler();
 }
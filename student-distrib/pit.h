@@ -18,6 +18,16 @@
 #define PIT_CH0_INIT2   0x38 //9C
 #define PIT_CH0_INIT3   0x53 //2E
 
+#define PIT_BASE_FREQ   1193182                             // input clock of the 8253/8254 in Hz
+#define PIT_DIVISOR     ((PIT_CH0_INIT3 << 8) | PIT_CH0_INIT2)  // reload value written in pit_init
+#define PIT_HZ          (PIT_BASE_FREQ / PIT_DIVISOR)       // ~56 interrupts per second
+
+// convert a time in milliseconds to a number of PIT ticks (rounded up)
+#define PIT_MS_TO_TICKS(ms)     (((ms) * PIT_HZ + 999) / 1000)
+
+// number of PIT interrupts since pit_init
+extern volatile uint32_t pit_ticks;
+
 
 void pit_init();
 
@@ -3,6 +3,7 @@
  * vim:ts=4 noexpandtab
  */
 #include "rtc.h"
+#include "syscall.h"
 
 volatile uint32_t rtc_interrupt = 0;
 
@@ -97,7 +98,7 @@ long rtc_get_time(void) {
     long s = seconds;
     long m = minutes;
     long h = hours;
-    return s + m*60 + h*360; /* time conversion work */
+    return s + m*60 + h*3600; /* time conversion work */
 }
 
 /*
@@ -129,10 +130,15 @@ int32_t rtc_close(int32_t fd) {
     Input: fd - file descriptor
            buf - input data pointer
            nbytes - number of bytes
-    Output: return 0
+    Output: return 0, or -1 if fd is O_NONBLOCK and no interrupt is pending
+            or a signal came in while waiting
 */
 int32_t rtc_read(int32_t fd, void* buf, int32_t nbytes) {
-    while(rtc_interrupt == 0) {asm volatile ("hlt");};
+    if (rtc_interrupt == 0 && fd_is_nonblocking(fd)) return -1;
+    while(rtc_interrupt == 0) {
+        if (signal_pending()) return -1;
+        asm volatile ("hlt");
+    }
     rtc_interrupt = 0;
     return 0;
 }
@@ -174,6 +180,15 @@ int32_t rtc_write(int32_t fd, const void* buf, int32_t nbytes)  {
     return nbytes;
 }
 
+/*
+    Reports whether rtc_read would return without waiting
+    Input: fd - file descriptor
+    Output: POLLIN if an interrupt is pending, POLLOUT since the rate can always be written
+*/
+int32_t rtc_poll(int32_t fd) {
+    return (rtc_interrupt ? POLLIN : 0) | POLLOUT;
+}
+
 /*
     helper function to change frequency to rate
     Input: frequency (int)
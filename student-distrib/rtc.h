@@ -62,6 +62,9 @@ int32_t rtc_read(int32_t fd, void* buf, int32_t nbytes);
 // change freuency based on buffer
 int32_t rtc_write(int32_t fd, const void* buf, int32_t nbytes);
 
+// report whether a tick is waiting to be read
+int32_t rtc_poll(int32_t fd);
+
 // helper function to change frequency to rate for rtc_write
 int32_t freq_rate(int32_t freq);
 
@@ -1,17 +1,12 @@
 #include "scheduler.h"
 #include "terminal.h"
+#include "mmap.h"
 
 
-// Active process for each terminal, not the actual terminal
-int32_t terminal_process_pids[NUM_TERMINALS] = {0,-1,-1};
-
-// Pid for the actual terminals
-int32_t terminal_pid[NUM_TERMINALS] = {0,-1,-1};
-
 /*
 *   switch_process
 *   
-*   Input : terminal - specifies which terminal switching to (0-2)
+*   Input : terminal - specifies which terminal switching to (0 to MAX_TERMINALS-1)
 *   Output: 0 - if it worked fine
 *           -1 - if it is failed
 *   Effect: Pauses current process and switches to process other terminal is running
@@ -23,13 +18,12 @@ int32_t terminal_pid[NUM_TERMINALS] = {0,-1,-1};
     
 */
 int32_t switch_process(uint32_t terminal) {
-    if (terminal > 2) {return -1;}
+    if (terminal >= MAX_TERMINALS || terminals[terminal] == NULL) {return -1;}
     long flags;
     cli_and_save(flags);
     
     // Create a new shell on first time switching to terminal
-    if (terminal_pid[terminal] == -1) {
-        terminal_pid[terminal] = terminal; 
+    if (terminals[terminal]->shell_pid == -1) {
         process_terminal = terminal;
         restore_flags(flags);
         shell_execute((uint8_t*)"shell");
@@ -37,7 +31,7 @@ int32_t switch_process(uint32_t terminal) {
     }
 
     // switch to the current process at other terminal
-    uint32_t current_pid = terminal_process_pids[terminal];
+    uint32_t current_pid = terminals[terminal]->process_pid;
 
     /* restore parent data */
     pcb_t * current_PCB = (pcb_t*)(EIGHT_MB - EIGHT_KB * (current_pid + 1));
@@ -45,7 +39,8 @@ int32_t switch_process(uint32_t terminal) {
 
 
     /* restore process paging */
-    page_directory[VIRTUAL_ADDR_START >> 22].directory_4MB_entry_desc.offset_bits_31_22 = (KERNEL_MEM_ADDR_END + (current_pid) * PROGRAM_SIZE) >> 22;  //(KERNEL_MEM_ADDR_END >> 22)
+    page_directory[VIRTUAL_ADDR_START >> 22].directory_4MB_entry_desc.offset_bits_31_22 = current_PCB->program_frame >> 22;
+    mmap_load((pcb_t*)(EIGHT_MB - EIGHT_KB * (current_pid + 1)));
     flush_tlb();
 
     tss.ss0 = KERNEL_DS;
@@ -59,7 +54,7 @@ int32_t switch_process(uint32_t terminal) {
             movl %1, %%ebp                          ;\
             "                                                                            
             :                                       
-            : "g"(esp_ebp_term[terminal][0]), "g"(esp_ebp_term[terminal][1])  
+            : "g"(terminals[terminal]->esp), "g"(terminals[terminal]->ebp)  
             : "%esp", "%ebp"          
     );    
     
@@ -70,19 +65,18 @@ int32_t switch_process(uint32_t terminal) {
 /*
 *   switch_process_for_sched
 *   
-*   Input : terminal - specifies which terminal switching to (0-2)
+*   Input : terminal - specifies which terminal switching to (0 to MAX_TERMINALS-1)
 *   Output: 0 - if it worked fine
 *           -1 - if it is failed
 *   Effect: Pauses current process and switches to process other terminal is running
 */
 int32_t switch_process_for_sched(uint32_t terminal) {
-    if (terminal > 2) {return -1;}
+    if (terminal >= MAX_TERMINALS || terminals[terminal] == NULL) {return -1;}
     long flags;
     cli_and_save(flags);
     
     // Create a new shell on first time switching to terminal
-    if (terminal_pid[terminal] == -1) {
-        terminal_pid[terminal] = terminal; 
+    if (terminals[terminal]->shell_pid == -1) {
         process_terminal = terminal;
         restore_flags(flags);
         shell_execute((uint8_t*)"shell");
@@ -90,14 +84,15 @@ int32_t switch_process_for_sched(uint32_t terminal) {
     }
 
     // switch to the current process at other terminal
-    uint32_t current_pid = terminal_process_pids[terminal];
+    uint32_t current_pid = terminals[terminal]->process_pid;
 
     /* Get pcb */
     set_current_pcb((pcb_t*)(EIGHT_MB - EIGHT_KB * (current_pid + 1)));
 
 
     /* restore process paging */
-    page_directory[VIRTUAL_ADDR_START >> 22].directory_4MB_entry_desc.offset_bits_31_22 = (KERNEL_MEM_ADDR_END + (current_pid) * PROGRAM_SIZE) >> 22;  //(KERNEL_MEM_ADDR_END >> 22)
+    page_directory[VIRTUAL_ADDR_START >> 22].directory_4MB_entry_desc.offset_bits_31_22 = get_current_pcb()->program_frame >> 22;
+    mmap_load((pcb_t*)(EIGHT_MB - EIGHT_KB * (current_pid + 1)));
     flush_tlb();
     
     process_terminal = terminal;
@@ -117,7 +112,7 @@ void scheduler() {
     if (get_cnt_pid() == 0) return;
 
     // Context switch
-    uint32_t current_pid = switch_process_for_sched((process_terminal + 1) % 3);
+    uint32_t current_pid = switch_process_for_sched(next_terminal(process_terminal));
 
     // remap video memory
     remap_vidmap();
@@ -132,7 +127,7 @@ void scheduler() {
             movl %1, %%ebp                          ;\
             "                                                                            
             :                                       
-            : "g"(esp_ebp_term[process_terminal][0]), "g"(esp_ebp_term[process_terminal][1])  
+            : "g"(terminals[process_terminal]->esp), "g"(terminals[process_terminal]->ebp)  
             : "%esp", "%ebp"          
     );    
 
@@ -160,7 +155,7 @@ void remap_vidmap() {
     if (current_terminal == process_terminal) {
         user_vidmem_page_table[0].base_addr = VID_MEM_ADDR >> 12; // map to video memory
     } else {
-        user_vidmem_page_table[0].base_addr = ((VID_MEM_ADDR + ((process_terminal) + 1) * FOUR_KB) >> 12); // map to video page
+        user_vidmem_page_table[0].base_addr = (uint32_t)terminals[process_terminal]->video_page >> 12; // map to video page
     }
 
     user_vidmem_page_table[0].present = 1;
@@ -180,8 +175,8 @@ void remap_vidmap() {
 *   Effect: None
 */
 int32_t get_terminal_pid(uint32_t terminal) {
-    if (terminal > 2) return -1;
-    return terminal_pid[terminal];
+    if (terminal >= MAX_TERMINALS || terminals[terminal] == NULL) return -1;
+    return terminals[terminal]->shell_pid;
 }
 
 
@@ -193,8 +188,8 @@ int32_t get_terminal_pid(uint32_t terminal) {
 *   Effect: None
 */
 int32_t get_terminal_process_pid(uint32_t terminal) {
-    if (terminal > 2) return -1;
-    return terminal_process_pids[terminal];
+    if (terminal >= MAX_TERMINALS || terminals[terminal] == NULL) return -1;
+    return terminals[terminal]->process_pid;
 }
 
 
@@ -207,6 +202,6 @@ int32_t get_terminal_process_pid(uint32_t terminal) {
 *   Effect: updates the specified terminal_process_pid
 */
 void set_terminal_process_pid(uint32_t terminal, uint32_t pid) {
-    if (terminal > 2 || pid > MAX_PID) return;
-    terminal_process_pids[terminal] = pid;
+    if (terminal >= MAX_TERMINALS || terminals[terminal] == NULL || pid > MAX_PID) return;
+    terminals[terminal]->process_pid = pid;
 }
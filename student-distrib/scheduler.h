@@ -7,8 +7,6 @@
 #include "x86_desc.h"
 #include "paging.h"
 
-#define NUM_TERMINALS   3
-
 // Switch to another terminal process
 int32_t switch_process(uint32_t terminal);
 
@@ -0,0 +1,289 @@
+/* serial.c - 16550 UART driver for COM1
+ *
+ * Output goes through a ring that the transmit interrupt drains 16 bytes at
+ * a time. Input is edited a line at a time like the keyboard, and echoed back.
+ */
+#include "serial.h"
+#include "syscall.h"
+
+int serial_present = 0;
+
+static uint8_t tx_ring[SERIAL_TX_SIZE];
+static volatile uint32_t tx_head = 0;   // next byte to queue
+static volatile uint32_t tx_tail = 0;   // next byte to send
+static volatile int tx_irq_on = 0;      // IER_TX is set
+
+static uint8_t rx_line[SERIAL_RX_SIZE];
+static volatile int rx_count = 0;       // bytes in rx_line
+static volatile int rx_lines = 0;       // newlines in rx_line
+
+/*
+    serial_init
+    Input: none
+    Output: none
+    Effects: checks for a UART with a loopback test, then sets it to 115200 8N1
+             with FIFOs and enables the receive interrupt
+*/
+void serial_init(void) {
+    long flags;
+    cli_and_save(flags);
+
+    tx_head = tx_tail = 0;
+    tx_irq_on = 0;
+    rx_count = rx_lines = 0;
+
+    outb(0, COM1_PORT + UART_IER);
+    outb(LCR_DLAB, COM1_PORT + UART_LCR);
+    outb(SERIAL_DIVISOR & 0xFF, COM1_PORT + UART_DATA);
+    outb(SERIAL_DIVISOR >> 8, COM1_PORT + UART_IER);
+    outb(LCR_8N1, COM1_PORT + UART_LCR);
+    outb(FCR_INIT, COM1_PORT + UART_FCR);
+
+    // a byte sent in loopback mode comes back if there is a UART
+    outb(MCR_LOOPBACK, COM1_PORT + UART_MCR);
+    outb(0xAE, COM1_PORT + UART_DATA);
+    serial_present = (inb(COM1_PORT + UART_DATA) == 0xAE);
+
+    if (serial_present) {
+        outb(MCR_INIT, COM1_PORT + UART_MCR);
+        outb(IER_RX, COM1_PORT + UART_IER);
+        enable_irq(COM1_IRQ);
+    }
+    restore_flags(flags);
+}
+
+/*
+    Fills the transmit FIFO from the ring
+    Input: none
+    Output: none
+    Effects: the transmit interrupt is on while the ring has bytes left,
+             caller must have interrupts disabled
+*/
+static void serial_start_tx(void) {
+    int n;
+
+    if (inb(COM1_PORT + UART_LSR) & LSR_THR_EMPTY) {
+        for (n = 0; n < UART_FIFO_SIZE && tx_tail != tx_head; ++n) {
+            outb(tx_ring[tx_tail & (SERIAL_TX_SIZE - 1)], COM1_PORT + UART_DATA);
+            ++tx_tail;
+        }
+    }
+
+    if (tx_tail != tx_head && !tx_irq_on) {
+        outb(IER_RX | IER_TX, COM1_PORT + UART_IER);
+        tx_irq_on = 1;
+    } else if (tx_tail == tx_head && tx_irq_on) {
+        outb(IER_RX, COM1_PORT + UART_IER);
+        tx_irq_on = 0;
+    }
+}
+
+/*
+    Adds a byte to the transmit ring
+    Input: c - byte to send
+    Output: none
+    Effects: if the ring is full, waits for the UART to take the oldest byte,
+             so nothing is lost. Caller must have interrupts disabled
+*/
+static void serial_tx_put(uint8_t c) {
+    while (tx_head - tx_tail >= SERIAL_TX_SIZE) {
+        while (!(inb(COM1_PORT + UART_LSR) & LSR_THR_EMPTY));
+        outb(tx_ring[tx_tail & (SERIAL_TX_SIZE - 1)], COM1_PORT + UART_DATA);
+        ++tx_tail;
+    }
+    tx_ring[tx_head & (SERIAL_TX_SIZE - 1)] = c;
+    ++tx_head;
+}
+
+/*
+    serial_putc
+    Input: c - character to send
+    Output: none
+    Effects: queues c, '\n' becomes "\r\n" for the terminal on the other end
+*/
+void serial_putc(uint8_t c) {
+    long flags;
+    if (!serial_present) return;
+
+    cli_and_save(flags);
+    if (c == '\n') serial_tx_put('\r');
+    serial_tx_put(c);
+    serial_start_tx();
+    restore_flags(flags);
+}
+
+/*
+    serial_puts
+    Input: s - NULL terminated string
+    Output: none
+    Effects: queues s
+*/
+void serial_puts(int8_t* s) {
+    while (*s != '\0') {
+        serial_putc(*s++);
+    }
+}
+
+/*
+    Edits the input line with a received character
+    Input: c - received character
+    Output: none
+    Effects: appends c, or removes the last character on backspace, and echoes it.
+             A full line only takes a newline. Caller must have interrupts disabled
+*/
+static void serial_rx_char(uint8_t c) {
+    if (c == '\r') c = '\n';
+
+    if (c == '\b' || c == 0x7F) {
+        if (rx_count > 0 && rx_line[rx_count - 1] != '\n') {
+            --rx_count;
+            serial_tx_put('\b');
+            serial_tx_put(' ');
+            serial_tx_put('\b');
+        }
+        return;
+    }
+    if (c != '\n' && c != '\t' && (c < ' ' || c > '~')) return;
+    if (rx_count >= SERIAL_RX_SIZE - 1 && c != '\n') return;
+    if (rx_count >= SERIAL_RX_SIZE) return;
+
+    rx_line[rx_count++] = c;
+    if (c == '\n') {
+        ++rx_lines;
+        serial_tx_put('\r');
+    }
+    serial_tx_put(c);
+}
+
+/*
+    serial_irq_handler
+    Input: none
+    Output: none
+    Effects: handles every pending UART interrupt: takes received bytes out of
+             the FIFO and refills the transmit FIFO
+*/
+void serial_irq_handler(void) {
+    uint8_t iir;
+    long flags;
+    cli_and_save(flags);
+
+    while (!((iir = inb(COM1_PORT + UART_IIR)) & IIR_NONE)) {
+        switch (iir & IIR_MASK) {
+            case IIR_RX:
+            case IIR_RX_TIMEOUT:
+                while (inb(COM1_PORT + UART_LSR) & LSR_DATA_READY) {
+                    serial_rx_char(inb(COM1_PORT + UART_DATA));
+                }
+                break;
+            case IIR_LINE:
+                inb(COM1_PORT + UART_LSR);
+                break;
+            case IIR_TX:
+                break;
+            default:
+                inb(COM1_PORT + UART_MCR + 2);  // modem status
+                break;
+        }
+        serial_start_tx();
+    }
+
+    send_eoi(COM1_IRQ);
+    restore_flags(flags);
+}
+
+/*
+    serial_line_ready
+    Input: none
+    Output: 1 if a complete line has been received, 0 otherwise
+    Effects: none
+*/
+int serial_line_ready(void) {
+    return rx_lines > 0;
+}
+
+/*
+    serial_open
+    Input: filename - ignored
+    Output: 0, or -1 if there is no UART
+    Effects: none
+*/
+int32_t serial_open(const uint8_t* filename) {
+    return serial_present ? 0 : -1;
+}
+
+/*
+    serial_close
+    Input: fd - ignored
+    Output: 0
+    Effects: none
+*/
+int32_t serial_close(int32_t fd) {
+    return 0;
+}
+
+/*
+    serial_read
+    Input: fd - file descriptor, may be O_NONBLOCK
+           buf - buffer
+           nbytes - size of buf
+    Output: number of bytes read, the line including its newline,
+            -1 if buf is NULL or fd is O_NONBLOCK and no line is ready
+    Effects: waits for a line, takes it out of the input buffer
+*/
+int32_t serial_read(int32_t fd, void* buf, int32_t nbytes) {
+    uint8_t* b = (uint8_t*)buf;
+    int32_t n = 0;
+    long flags;
+
+    if (buf == NULL || nbytes <= 0 || !serial_present) return -1;
+
+    while (!serial_line_ready()) {
+        if (fd_is_nonblocking(fd)) return -1;
+        asm volatile ("hlt");
+    }
+
+    cli_and_save(flags);
+    while (n < nbytes && n < rx_count) {
+        b[n] = rx_line[n];
+        if (b[n++] == '\n') {
+            --rx_lines;
+            break;
+        }
+    }
+    memmove(rx_line, rx_line + n, rx_count - n);
+    rx_count -= n;
+    restore_flags(flags);
+    return n;
+}
+
+/*
+    serial_write
+    Input: fd - ignored
+           buf - bytes to send
+           nbytes - number of bytes
+    Output: nbytes, or -1 if buf is NULL
+    Effects: queues the bytes, only waits if the transmit ring is full
+*/
+int32_t serial_write(int32_t fd, const void* buf, int32_t nbytes) {
+    const uint8_t* b = (const uint8_t*)buf;
+    int32_t i;
+
+    if (buf == NULL || nbytes < 0 || !serial_present) return -1;
+    for (i = 0; i < nbytes; ++i) {
+        serial_putc(b[i]);
+    }
+    return nbytes;
+}
+
+/*
+    serial_poll
+    Input: fd - ignored
+    Output: POLLIN if a line has been received, POLLOUT if the transmit ring has room
+    Effects: none
+*/
+int32_t serial_poll(int32_t fd) {
+    int32_t ret = 0;
+    if (serial_line_ready()) ret |= POLLIN;
+    if (tx_head - tx_tail < SERIAL_TX_SIZE) ret |= POLLOUT;
+    return ret;
+}
@@ -0,0 +1,75 @@
+/* serial.h - 16550 UART driver for COM1
+ * The UART is linked to IRQ 4 in the PIC
+ */
+
+#ifndef _SERIAL_H
+#define _SERIAL_H
+
+#include "types.h"
+#include "i8259.h"
+#include "lib.h"
+
+#ifndef ASM
+
+#define COM1_PORT       0x3F8
+#define COM1_IRQ        0x04
+
+/* UART registers, offsets from COM1_PORT */
+#define UART_DATA       0   // receive/transmit holding register, divisor low with DLAB
+#define UART_IER        1   // interrupt enable, divisor high with DLAB
+#define UART_IIR        2   // interrupt identification on read
+#define UART_FCR        2   // FIFO control on write
+#define UART_LCR        3
+#define UART_MCR        4
+#define UART_LSR        5
+
+#define IER_RX          0x01    // data received
+#define IER_TX          0x02    // transmit holding register empty
+#define IIR_NONE        0x01    // no interrupt pending
+#define IIR_MASK        0x0E
+#define IIR_TX          0x02
+#define IIR_RX          0x04
+#define IIR_LINE        0x06
+#define IIR_RX_TIMEOUT  0x0C
+#define LCR_8N1         0x03
+#define LCR_DLAB        0x80
+#define FCR_INIT        0xC7    // enable and clear FIFOs, interrupt at 14 received bytes
+#define MCR_INIT        0x0B    // DTR, RTS and OUT2, OUT2 gates the IRQ line
+#define MCR_LOOPBACK    0x1E
+#define LSR_DATA_READY  0x01
+#define LSR_THR_EMPTY   0x20
+
+#define UART_FIFO_SIZE  16
+#define SERIAL_DIVISOR  1       // 115200 baud
+
+#define SERIAL_TX_SIZE  4096    // must be a power of 2
+#define SERIAL_RX_SIZE  128     // one input line
+
+/* 1 if a UART answered at COM1 */
+extern int serial_present;
+
+/* Finds and sets up the UART, enables IRQ 4 */
+void serial_init(void);
+
+/* Handles IRQ 4, moves bytes between the FIFOs and the rings */
+void serial_irq_handler(void);
+
+/* Queues a character for sending, '\n' is sent as "\r\n" */
+void serial_putc(uint8_t c);
+
+/* Queues a string for sending */
+void serial_puts(int8_t* s);
+
+/* 1 if a complete line has been received */
+int serial_line_ready(void);
+
+/* file operations of the serial device */
+int32_t serial_open(const uint8_t* filename);
+int32_t serial_close(int32_t fd);
+int32_t serial_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t serial_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t serial_poll(int32_t fd);
+
+#endif /* ASM */
+
+#endif /* _SERIAL_H */
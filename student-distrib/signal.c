@@ -0,0 +1,221 @@
+#include "signal.h"
+#include "syscall.h"
+#include "lib.h"
+#include "pit.h"
+#include "klog.h"
+
+#define SIGNAL_IGNORED      (SIGNAL_BIT(SIG_ALARM) | SIGNAL_BIT(SIG_USER1))    // default action is to do nothing
+#define EFLAGS_USER         0x0CD5  // CF, PF, AF, ZF, SF, DF and OF, the flags a handler may change
+
+#define PID_PCB(pid)        ((pcb_t*)(EIGHT_MB - EIGHT_KB * ((pid) + 1)))
+
+/* what signal_check pushes on the user stack, the handler starts with esp at ret */
+typedef struct signal_frame_t {
+    uint32_t ret;           // the handler returns into code
+    uint32_t signum;        // argument of the handler
+    hw_context_t context;   // where the process was, sigreturn puts it back
+    uint8_t code[8];        // calls sigreturn
+} signal_frame_t;
+
+/* movl $10, %eax; int $0x80; nop */
+static const uint8_t sigreturn_code[8] = { 0xB8, 0x0A, 0x00, 0x00, 0x00, 0xCD, 0x80, 0x90 };
+
+
+/*
+    deliverable
+    Input: pcb - a process
+    Output: the pending signals that are not blocked and not ignored
+*/
+static uint32_t deliverable(pcb_t* pcb) {
+    uint32_t signals = pcb->sig_pending & ~pcb->sig_blocked;
+    uint32_t signum;
+
+    for (signum = 0; signum < NUM_SIGNALS; signum++) {
+        if (pcb->sig_handlers[signum] == NULL && (SIGNAL_IGNORED & SIGNAL_BIT(signum))) {
+            signals &= ~SIGNAL_BIT(signum);
+        }
+    }
+    return signals;
+}
+
+
+/*
+    alarm_expired
+    Description: Alarm timer function, sends ALARM
+    Input: pid - the process that set the alarm
+    Output: none
+*/
+static void alarm_expired(uint32_t pid) {
+    signal_send(pid, SIG_ALARM);
+}
+
+
+/*
+    signal_reset
+    Description: Clears the signal state of a new process
+    Input: pcb - the process
+    Output: none
+*/
+void signal_reset(pcb_t* pcb) {
+    pcb->sig_pending = 0;
+    pcb->sig_blocked = 0;
+    pcb->sig_saved_blocked = 0;
+    memset(pcb->sig_handlers, 0, sizeof(pcb->sig_handlers));
+    timer_init(&pcb->alarm_timer, alarm_expired, pcb->pid);
+}
+
+/*
+    signal_send
+    Description: Marks a signal pending, it is delivered when the process next returns to user mode
+    Input: pid - the process
+           signum - the signal
+    Output: 0, -1 if there is no such process or signal
+*/
+int32_t signal_send(uint32_t pid, uint32_t signum) {
+    long flags;
+
+    if (pid >= MAX_PID || !pid_arr[pid] || signum >= NUM_SIGNALS) return -1;
+    cli_and_save(flags);
+    PID_PCB(pid)->sig_pending |= SIGNAL_BIT(signum);
+    restore_flags(flags);
+    return 0;
+}
+
+/*
+    signal_pending
+    Input: none
+    Output: 1 if the current process has a signal that a handler or the
+            default action has to act on, 0 otherwise
+*/
+int32_t signal_pending(void) {
+    pcb_t* pcb = get_current_pcb();
+
+    return pcb != NULL && deliverable(pcb) != 0;
+}
+
+/*
+    signal_check
+    Description: Acts on the lowest pending signal before an interrupt, exception
+                 or system call returns to user mode. With a handler, the user
+                 stack gets a signal_frame_t and the process continues in the
+                 handler with every signal blocked. Without one the process is
+                 killed or the signal is dropped
+    Input: ctx - the registers the return restores
+    Output: none
+    Effects: does not return if the process is killed
+*/
+void signal_check(hw_context_t* ctx) {
+    pcb_t* pcb;
+    signal_frame_t* frame;
+    uint32_t signals, signum;
+    long flags;
+
+    if ((ctx->cs & 3) != 3 || (pcb = get_current_pcb()) == NULL) return;
+
+    cli_and_save(flags);
+    signals = pcb->sig_pending & ~pcb->sig_blocked;
+    for (signum = 0; signum < NUM_SIGNALS; signum++) {
+        if (!(signals & SIGNAL_BIT(signum))) continue;
+        pcb->sig_pending &= ~SIGNAL_BIT(signum);
+        if (pcb->sig_handlers[signum] != NULL) break;
+        if (SIGNAL_IGNORED & SIGNAL_BIT(signum)) continue;
+        restore_flags(flags);
+        klog(KLOG_INFO, "pid %u: killed by signal %u", pcb->pid, signum);
+        halt_status(EXCEPTION_STATUS);
+    }
+    restore_flags(flags);
+    if (signum == NUM_SIGNALS) return;
+
+    frame = (signal_frame_t*)(ctx->esp - sizeof(signal_frame_t));
+    if (bad_userspace_addr(frame, sizeof(signal_frame_t))) {
+        klog(KLOG_ERR, "pid %u: no room on the stack for signal %u", pcb->pid, signum);
+        halt_status(EXCEPTION_STATUS);
+    }
+    memcpy(frame->code, sigreturn_code, sizeof(frame->code));
+    memcpy(&frame->context, ctx, sizeof(hw_context_t));
+    frame->signum = signum;
+    frame->ret = (uint32_t)frame->code;
+
+    pcb->sig_saved_blocked = pcb->sig_blocked;
+    pcb->sig_blocked = SIGNAL_ALL;
+    ctx->esp = (uint32_t)frame;
+    ctx->eip = (uint32_t)pcb->sig_handlers[signum];
+}
+
+/*
+*   set_handler
+*
+*   Input : signum - specifies which signal's hander to change
+*           handler_address - pointer to user-level function to handle signal,
+*                             NULL for the default action
+*   Output: 0 - if it worked fine
+*           -1 - if it is failed
+*   Effect: Updates a signal's handler function
+*/
+int32_t set_handler(int32_t signum, void* handler_address) {
+    pcb_t* pcb = get_current_pcb();
+
+    if (pcb == NULL || signum < 0 || signum >= NUM_SIGNALS) return -1;
+    if (handler_address != NULL && bad_userspace_addr(handler_address, 1)) return -1;
+    pcb->sig_handlers[signum] = handler_address;
+    return 0;
+}
+
+/*
+*   sigreturn
+*
+*   Input : none
+*   Output: eax of the context put back, so the system call leaves it unchanged
+*           -1 - if it is failed
+*   Effect: copies the hardware context a handler returned over back onto the
+*           kernel stack, so the system call returns to where the signal came in
+*/
+int32_t sigreturn(void) {
+    pcb_t* pcb = get_current_pcb();
+    hw_context_t* ctx = (hw_context_t*)(tss.esp0 - sizeof(hw_context_t));
+    hw_context_t* saved;
+    hw_context_t live;
+
+    if (pcb == NULL) return -1;
+    // the handler returned into the frame code, which left esp at signum
+    saved = (hw_context_t*)(ctx->esp + FOUR_B);
+    if (bad_userspace_addr(saved, sizeof(hw_context_t))) return -1;
+
+    // the handler may change the registers, not the segments or the privileged flags
+    memcpy(&live, ctx, sizeof(hw_context_t));
+    memcpy(ctx, saved, sizeof(hw_context_t));
+    ctx->ds = live.ds;
+    ctx->es = live.es;
+    ctx->fs = live.fs;
+    ctx->cs = live.cs;
+    ctx->ss = live.ss;
+    ctx->eflags = (live.eflags & ~EFLAGS_USER) | (saved->eflags & EFLAGS_USER);
+    ctx->irq_exc = live.irq_exc;
+    ctx->error = live.error;
+
+    pcb->sig_blocked = pcb->sig_saved_blocked;
+    return ctx->eax;
+}
+
+/*
+*   alarm
+*
+*   Input : ms - milliseconds until ALARM is sent, 0 to cancel the alarm
+*   Output: milliseconds that were left of the previous alarm, 0 if none was set
+*           -1 - if it is failed
+*   Effect: replaces the alarm of the current process, a timer counting PIT ticks
+*/
+int32_t alarm(uint32_t ms) {
+    pcb_t* pcb = get_current_pcb();
+    uint32_t left = 0;
+    long flags;
+
+    if (pcb == NULL || ms > 0x7FFFFFFF / PIT_HZ) return -1;
+    cli_and_save(flags);
+    if (timer_cancel(&pcb->alarm_timer) && (int32_t)(pcb->alarm_timer.expires - pit_ticks) > 0) {
+        left = (pcb->alarm_timer.expires - pit_ticks) * 1000 / PIT_HZ;
+    }
+    if (ms > 0) timer_add(&pcb->alarm_timer, PIT_MS_TO_TICKS(ms));
+    restore_flags(flags);
+    return left;
+}
@@ -0,0 +1,69 @@
+/* signal.h - signals sent to user processes
+ * A signal is only marked pending when it is sent. It is delivered the next
+ * time the process returns to user mode: if it has a handler, a frame with
+ * the interrupted context is pushed on the user stack and the handler runs,
+ * returning through sigreturn. Without a handler DIV_ZERO, SEGFAULT and
+ * INTERRUPT kill the process, ALARM and USER1 are ignored.
+ */
+
+#ifndef _SIGNAL_H
+#define _SIGNAL_H
+
+#include "types.h"
+
+/* same numbers as enum signums in the user headers */
+#define SIG_DIV_ZERO    0
+#define SIG_SEGFAULT    1
+#define SIG_INTERRUPT   2
+#define SIG_ALARM       3
+#define SIG_USER1       4
+#define NUM_SIGNALS     5
+
+#define SIGNAL_BIT(signum)  (1 << (signum))
+#define SIGNAL_ALL          (SIGNAL_BIT(NUM_SIGNALS) - 1)
+
+#ifndef ASM
+
+struct pcb_t;
+
+/* registers saved on the kernel stack by every interrupt, exception and
+ * system call, in the order interrupt_wrapper_asm.S pushes them. esp and ss
+ * are only there when the processor came from user mode */
+typedef struct hw_context_t {
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+    uint32_t esi;
+    uint32_t edi;
+    uint32_t ebp;
+    uint32_t eax;
+    uint32_t ds;
+    uint32_t es;
+    uint32_t fs;
+    uint32_t irq_exc;   // vector
+    uint32_t error;     // error code, 0 if the processor pushed none
+    uint32_t eip;
+    uint32_t cs;
+    uint32_t eflags;
+    uint32_t esp;
+    uint32_t ss;
+} hw_context_t;
+
+/* Marks a signal pending for a process */
+int32_t signal_send(uint32_t pid, uint32_t signum);
+
+/* 1 if the current process has a signal to act on, blocking calls give up and return -1 */
+int32_t signal_pending(void);
+
+/* Delivers a pending signal before returning to user mode, may not return */
+void signal_check(hw_context_t* ctx);
+
+/* Starts a new process with no handlers, nothing pending or blocked and no alarm */
+void signal_reset(struct pcb_t* pcb);
+
+/* Sends ALARM to the current process in ms milliseconds, returns the ms left of the last alarm */
+int32_t alarm(uint32_t ms);
+
+#endif /* ASM */
+
+#endif /* _SIGNAL_H */
@@ -0,0 +1,304 @@
+#include "slab.h"
+#include "lib.h"
+#include "paging.h"
+#include "klog.h"
+#include "syscall.h"
+
+#define SLAB_OF(obj)    ((slab_t*)((uint32_t)(obj) & ~(SLAB_SIZE - 1)))
+// slabs are frames from frame_alloc, anything else cannot be one
+#define IS_SLAB(s)      (frame_in_use(s) && (s)->magic == SLAB_MAGIC)
+#define SLAB_HEADER     ((sizeof(slab_t) + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1))
+#define SLAB_FIRST(s)   ((uint8_t*)(s) + SLAB_HEADER)
+#define SLAB_INFO_SIZE  1024
+
+static kmem_cache_t* caches;    // every cache that was set up
+static kmem_cache_t kmalloc_caches[KMALLOC_CLASSES];
+static const int8_t* kmalloc_names[KMALLOC_CLASSES] = {
+    "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1024", "kmalloc-2048"
+};
+
+
+/*
+    partial_remove
+    Description: Takes a slab off the partial list of its cache
+    Input: slab - a slab on the list
+    Output: none
+*/
+static void partial_remove(slab_t* slab) {
+    if (slab->prev) slab->prev->next = slab->next;
+    else slab->cache->partial = slab->next;
+    if (slab->next) slab->next->prev = slab->prev;
+    slab->prev = slab->next = NULL;
+}
+
+/*
+    partial_add
+    Description: Puts a slab at the front of the partial list, so the next allocation uses it
+    Input: slab - a slab with a free object
+    Output: none
+*/
+static void partial_add(slab_t* slab) {
+    slab->prev = NULL;
+    slab->next = slab->cache->partial;
+    if (slab->next) slab->next->prev = slab;
+    slab->cache->partial = slab;
+}
+
+/*
+    slab_create
+    Description: Takes a frame and splits it into free objects
+    Input: cache - the cache that grows
+    Output: the new slab, NULL if no frame is free
+*/
+static slab_t* slab_create(kmem_cache_t* cache) {
+    slab_t* slab = (slab_t*)frame_alloc(1);
+    uint8_t* obj;
+    uint32_t i;
+
+    if (slab == NULL) return NULL;
+    slab->magic = SLAB_MAGIC;
+    slab->cache = cache;
+    slab->in_use = 0;
+    slab->free = NULL;
+    // link the objects from the last one back, so they are handed out in address order
+    for (i = cache->per_slab; i > 0; i--) {
+        obj = SLAB_FIRST(slab) + (i - 1) * cache->size;
+        *(void**)obj = slab->free;
+        slab->free = obj;
+    }
+    ++cache->slabs;
+    return slab;
+}
+
+
+/*
+    slab_init
+    Description: Sets up the kmalloc caches
+    Input: none
+    Output: none
+*/
+void slab_init(void) {
+    uint32_t i;
+
+    for (i = 0; i < KMALLOC_CLASSES; i++) {
+        kmem_cache_init(&kmalloc_caches[i], kmalloc_names[i], 1 << (KMALLOC_MIN_SHIFT + i));
+    }
+}
+
+/*
+    kmem_cache_init
+    Description: Prepares a cache and adds it to the statistics
+    Input: cache - the cache, usually a static variable of its user
+           name - shown in the statistics
+           size - bytes in an object
+    Output: 0, -1 if size is 0 or above KMALLOC_MAX
+    Effects: takes no frames until the first allocation
+*/
+int32_t kmem_cache_init(kmem_cache_t* cache, const int8_t* name, uint32_t size) {
+    kmem_cache_t* other;
+    kmem_cache_t* next;
+    long flags;
+
+    if (cache == NULL || size == 0 || size > KMALLOC_MAX) return -1;
+    // an object must hold the free list pointer
+    if (size < sizeof(void*)) size = sizeof(void*);
+
+    next = cache->next;
+    memset(cache, 0, sizeof(kmem_cache_t));
+    cache->next = next;
+    cache->name = name;
+    cache->size = (size + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+    cache->per_slab = (SLAB_SIZE - SLAB_HEADER) / cache->size;
+
+    // a cache that is set up again is already on the list
+    cli_and_save(flags);
+    for (other = caches; other != NULL && other != cache; other = other->next);
+    if (other == NULL) {
+        cache->next = caches;
+        caches = cache;
+    }
+    restore_flags(flags);
+    return 0;
+}
+
+/*
+    kmem_cache_alloc
+    Description: Returns a free object, from the most recently used slab with one
+    Input: cache - the cache
+    Output: the object, NULL if the cache needs a slab and no frame is free
+    Effects: the contents of the object are undefined
+*/
+void* kmem_cache_alloc(kmem_cache_t* cache) {
+    slab_t* slab;
+    void* obj;
+    long flags;
+
+    cli_and_save(flags);
+    slab = cache->partial;
+    if (slab == NULL) {
+        slab = slab_create(cache);
+        if (slab == NULL) {
+            ++cache->failures;
+            restore_flags(flags);
+            return NULL;
+        }
+        partial_add(slab);
+    } else if (slab->in_use == 0) {
+        --cache->empty;
+    }
+
+    obj = slab->free;
+    slab->free = *(void**)obj;
+    if (++slab->in_use == cache->per_slab) {
+        partial_remove(slab);   // full slabs are found again through their objects
+    }
+    ++cache->active;
+    ++cache->allocs;
+    restore_flags(flags);
+    return obj;
+}
+
+/*
+    kmem_cache_free
+    Description: Returns an object to its slab
+    Input: cache - the cache the object came from
+           obj - the object
+    Output: none
+    Effects: a slab that becomes empty goes back to the frame pool, unless the
+             cache keeps fewer than SLAB_KEEP_EMPTY empty slabs
+*/
+void kmem_cache_free(kmem_cache_t* cache, void* obj) {
+    slab_t* slab = SLAB_OF(obj);
+    long flags;
+
+    if (obj == NULL) return;
+    if (!IS_SLAB(slab) || slab->cache != cache ||
+        ((uint8_t*)obj - SLAB_FIRST(slab)) % cache->size != 0) {
+        klog(KLOG_ERR, "slab: bad free of 0x%x to %s", (uint32_t)obj, cache->name);
+        return;
+    }
+
+    cli_and_save(flags);
+    *(void**)obj = slab->free;
+    slab->free = obj;
+    if (slab->in_use-- == cache->per_slab) {
+        partial_add(slab);
+    }
+    if (slab->in_use == 0) {
+        if (cache->empty >= SLAB_KEEP_EMPTY) {
+            partial_remove(slab);
+            slab->magic = 0;
+            --cache->slabs;
+            frame_free(slab, 1);
+        } else {
+            ++cache->empty;
+        }
+    }
+    --cache->active;
+    ++cache->frees;
+    restore_flags(flags);
+}
+
+/*
+    kmalloc
+    Description: Allocates from the smallest kmalloc cache that fits
+    Input: size - bytes needed
+    Output: the memory, NULL if size is 0, above KMALLOC_MAX, or no frame is free
+*/
+void* kmalloc(uint32_t size) {
+    uint32_t i;
+
+    if (size == 0 || size > KMALLOC_MAX) return NULL;
+    for (i = 0; (1U << (KMALLOC_MIN_SHIFT + i)) < size; i++);
+    return kmem_cache_alloc(&kmalloc_caches[i]);
+}
+
+/*
+    kfree
+    Description: Frees memory from kmalloc or any cache, the slab knows its cache
+    Input: ptr - the memory, NULL is ignored
+    Output: none
+*/
+void kfree(void* ptr) {
+    slab_t* slab = SLAB_OF(ptr);
+
+    if (ptr == NULL) return;
+    if (!IS_SLAB(slab)) {
+        klog(KLOG_ERR, "slab: kfree of 0x%x, not from a slab", (uint32_t)ptr);
+        return;
+    }
+    kmem_cache_free(slab->cache, ptr);
+}
+
+
+/*
+    slab_info_open
+    Input: filename - ignored
+    Output: 0
+*/
+int32_t slab_info_open(const uint8_t* filename) {
+    return 0;
+}
+
+/*
+    slab_info_close
+    Input: fd - ignored
+    Output: 0
+*/
+int32_t slab_info_close(int32_t fd) {
+    return 0;
+}
+
+/*
+    slab_info_read
+    Description: Reads a line per cache: name, object size, objects in use and
+                 room for, slabs, allocations, frees and failed allocations
+    Input: fd - file descriptor, its position is the offset in the text
+           buf - buffer
+           nbytes - size of buf
+    Output: number of bytes read, 0 at the end of the text
+*/
+int32_t slab_info_read(int32_t fd, void* buf, int32_t nbytes) {
+    static int8_t text[SLAB_INFO_SIZE];     // too big for the kernel stack
+    file_descriptor_entry_t* entry = &get_current_pcb()->file_descriptor_ary[fd];
+    kmem_cache_t* cache;
+    uint32_t len;
+    long flags;
+
+    if (buf == NULL || nbytes < 0) return -1;
+    cli_and_save(flags);
+    len = snprintf(text, SLAB_INFO_SIZE, "name size active/total slabs allocs frees failed\n");
+    for (cache = caches; cache != NULL && len < SLAB_INFO_SIZE; cache = cache->next) {
+        len += snprintf(text + len, SLAB_INFO_SIZE - len, "%s %u %u/%u %u %u %u %u\n",
+                        cache->name, cache->size, cache->active, cache->slabs * cache->per_slab,
+                        cache->slabs, cache->allocs, cache->frees, cache->failures);
+    }
+    if (entry->file_position >= len) {
+        restore_flags(flags);
+        return 0;
+    }
+    if (nbytes > len - entry->file_position) nbytes = len - entry->file_position;
+    memcpy(buf, text + entry->file_position, nbytes);
+    entry->file_position += nbytes;
+    restore_flags(flags);
+    return nbytes;
+}
+
+/*
+    slab_info_write
+    Input: fd, buf, nbytes - ignored
+    Output: -1, the file is read-only
+*/
+int32_t slab_info_write(int32_t fd, const void* buf, int32_t nbytes) {
+    return -1;
+}
+
+/*
+    slab_info_poll
+    Input: fd - ignored
+    Output: POLLIN, never blocks
+*/
+int32_t slab_info_poll(int32_t fd) {
+    return POLLIN;
+}
@@ -0,0 +1,73 @@
+/* slab.h - caches of same-sized kernel objects
+ * A cache carves 4KB frames from frame_alloc into slabs of equal objects.
+ * Each slab starts with a slab_t, so freeing an object finds its slab and
+ * cache by rounding the address down to the frame. kmalloc serves other
+ * sizes from caches of powers of 2 up to KMALLOC_MAX.
+ */
+
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include "types.h"
+
+#define SLAB_SIZE           4096        // one frame
+#define SLAB_MAGIC          0x51AB51AB  // start of every slab, catches frees of foreign pointers
+#define SLAB_ALIGN          8           // objects are rounded up to this
+#define SLAB_KEEP_EMPTY     1           // empty slabs a cache keeps instead of freeing
+#define KMALLOC_MIN_SHIFT   4           // smallest kmalloc class, 16 bytes
+#define KMALLOC_CLASSES     8           // 16 bytes to KMALLOC_MAX
+#define KMALLOC_MAX         2048
+
+struct kmem_cache_t;
+
+/* header of a slab, the objects follow it in the same frame */
+typedef struct slab_t {
+    uint32_t magic;
+    struct kmem_cache_t* cache;
+    struct slab_t* prev;        // slabs of the cache that have a free object
+    struct slab_t* next;
+    void* free;                 // first free object, each one points at the next
+    uint32_t in_use;            // allocated objects
+} slab_t;
+
+/* a cache of objects of one size */
+typedef struct kmem_cache_t {
+    const int8_t* name;
+    uint32_t size;              // object size, a multiple of SLAB_ALIGN
+    uint32_t per_slab;          // objects that fit in a slab
+    slab_t* partial;            // slabs with a free object, empty ones included
+    uint32_t empty;             // empty slabs on the partial list
+    uint32_t slabs;             // slabs the cache holds
+    uint32_t active;            // objects allocated
+    uint32_t allocs;            // kmem_cache_alloc calls that returned an object
+    uint32_t frees;
+    uint32_t failures;          // kmem_cache_alloc calls that found no frame
+    struct kmem_cache_t* next;  // every cache, for the statistics
+} kmem_cache_t;
+
+/* Sets up the kmalloc caches */
+void slab_init(void);
+
+/* Prepares a cache of objects of size bytes, up to KMALLOC_MAX, returns 0 on success */
+int32_t kmem_cache_init(kmem_cache_t* cache, const int8_t* name, uint32_t size);
+
+/* Returns an object of the cache, NULL if no frame is free */
+void* kmem_cache_alloc(kmem_cache_t* cache);
+
+/* Returns an object to the cache it came from */
+void kmem_cache_free(kmem_cache_t* cache, void* obj);
+
+/* Returns size bytes from the smallest kmalloc class that fits, NULL if size is 0 or above KMALLOC_MAX */
+void* kmalloc(uint32_t size);
+
+/* Frees memory from kmalloc or kmem_cache_alloc, NULL is ignored */
+void kfree(void* ptr);
+
+/* "slabinfo" file: reads one line of statistics per cache */
+int32_t slab_info_open(const uint8_t* filename);
+int32_t slab_info_close(int32_t fd);
+int32_t slab_info_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t slab_info_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t slab_info_poll(int32_t fd);
+
+#endif /* _SLAB_H */
@@ -0,0 +1,83 @@
+#include "softirq.h"
+#include "lib.h"
+#include "timer.h"
+#include "keyboard.h"
+#include "klog.h"
+
+#define SOFTIRQ_BIT(nr)     (1 << (nr))
+
+static const softirq_func_t softirq_funcs[NUM_SOFTIRQS] = {
+    timer_tick,         // SOFTIRQ_TIMER
+    keyboard_softirq,   // SOFTIRQ_KEYBOARD
+    klog_flush,         // SOFTIRQ_KLOG
+};
+
+static volatile uint32_t softirq_pending = 0;
+static volatile uint8_t softirq_running = 0;
+
+uint32_t softirq_runs[NUM_SOFTIRQS];
+uint32_t softirq_cycles_max[NUM_SOFTIRQS];
+
+
+/*
+    softirq_raise
+    Input: nr - the softirq
+    Output: none
+    Effects: it runs once for any number of raises before it gets to run
+*/
+void softirq_raise(uint32_t nr) {
+    long flags;
+
+    if (nr >= NUM_SOFTIRQS) return;
+    cli_and_save(flags);
+    softirq_pending |= SOFTIRQ_BIT(nr);
+    restore_flags(flags);
+}
+
+/*
+    do_softirq
+    Description: Runs every raised softirq with interrupts enabled, again while
+                 interrupts raise more, up to SOFTIRQ_MAX_RESTART passes
+    Input: none
+    Output: none
+    Effects: returns at once when softirqs are already running further down
+             the stack. Interrupts must have been on where the interrupt came in
+*/
+void do_softirq(void) {
+    uint32_t pending, nr, start, cycles;
+    uint32_t restart = SOFTIRQ_MAX_RESTART;
+    long flags;
+
+    cli_and_save(flags);
+    if (softirq_running) {
+        restore_flags(flags);
+        return;
+    }
+    softirq_running = 1;
+
+    while ((pending = softirq_pending) != 0 && restart-- > 0) {
+        softirq_pending = 0;
+        sti();
+        for (nr = 0; nr < NUM_SOFTIRQS; nr++) {
+            if (!(pending & SOFTIRQ_BIT(nr))) continue;
+            start = rdtsc_low();
+            softirq_funcs[nr]();
+            cycles = rdtsc_low() - start;
+            ++softirq_runs[nr];
+            if (cycles > softirq_cycles_max[nr]) softirq_cycles_max[nr] = cycles;
+        }
+        cli();
+    }
+
+    softirq_running = 0;
+    restore_flags(flags);
+}
+
+/*
+    softirq_active
+    Input: none
+    Output: 1 if softirqs are running, 0 otherwise
+*/
+int32_t softirq_active(void) {
+    return softirq_running;
+}
@@ -0,0 +1,42 @@
+/* softirq.h - interrupt work done after the EOI with interrupts on
+ * An IRQ handler only talks to its device, queues what it read and raises a
+ * softirq before sending the EOI. Raised softirqs run on the way out of the
+ * interrupt with interrupts enabled, so the other IRQs are not held up by
+ * the slow part of the work. Softirqs never run inside each other: an
+ * interrupt that comes in while they run only raises its own, and the
+ * running loop picks it up. The scheduler does not switch processes while
+ * softirqs run, so they may borrow process_terminal.
+ */
+
+#ifndef _SOFTIRQ_H
+#define _SOFTIRQ_H
+
+#include "types.h"
+
+#define SOFTIRQ_TIMER       0   // runs the PIT timer wheel
+#define SOFTIRQ_KEYBOARD    1   // decodes the queued scancodes
+#define SOFTIRQ_KLOG        2   // prints the kernel log
+#define NUM_SOFTIRQS        3
+
+#define SOFTIRQ_MAX_RESTART 8   // passes before what is still raised waits for the next interrupt
+
+#ifndef ASM
+
+typedef void (*softirq_func_t)(void);
+
+/* how long each softirq took, interrupts are on the whole time */
+extern uint32_t softirq_runs[NUM_SOFTIRQS];
+extern uint32_t softirq_cycles_max[NUM_SOFTIRQS];
+
+/* Marks a softirq to run when the current interrupt returns */
+void softirq_raise(uint32_t nr);
+
+/* Runs the raised softirqs, called by the IRQ stubs after the handler */
+void do_softirq(void);
+
+/* 1 while softirqs are running, interrupted or not */
+int32_t softirq_active(void);
+
+#endif /* ASM */
+
+#endif /* _SOFTIRQ_H */
@@ -3,6 +3,13 @@
 #include "paging.h"
 #include "terminal.h"
 #include "keyboard.h"
+#include "pit.h"
+#include "serial.h"
+#include "page_cache.h"
+#include "mmap.h"
+#include "slab.h"
+#include "signal.h"
+#include "irqtrace.h"
 
 pcb_t * current_PCB = 0;    // current_PCB = 8MB - 8KB * index
 uint32_t current_pid = 0; 
@@ -11,10 +18,42 @@ uint32_t cnt_program = 0;
 
 uint32_t pid_arr[MAX_PID] = {0, 0, 0, 0, 0, 0};
 
-static file_operations_table rtc_op = { rtc_open, rtc_close, rtc_read, rtc_write };
-static file_operations_table dir_op = { directory_open, directory_close, directory_read, directory_write };
-static file_operations_table file_op = {  file_open, file_close, file_read, file_write };
-static file_operations_table terminal_op = { terminal_open, terminal_close, terminal_read, terminal_write };
+static file_operations_table rtc_op = { rtc_open, rtc_close, rtc_read, rtc_write, rtc_poll };
+static file_operations_table dir_op = { directory_open, directory_close, directory_read, directory_write, directory_poll };
+static file_operations_table file_op = {  file_open, file_close, file_read, file_write, file_poll };
+static file_operations_table terminal_op = { terminal_open, terminal_close, terminal_read, terminal_write, terminal_poll };
+static file_operations_table serial_op = { serial_open, serial_close, serial_read, serial_write, serial_poll };
+static file_operations_table page_cache_op = { page_cache_open, page_cache_close, page_cache_read, page_cache_write_ctl, page_cache_poll };
+static file_operations_table slab_info_op = { slab_info_open, slab_info_close, slab_info_read, slab_info_write, slab_info_poll };
+static file_operations_table meminfo_op = { meminfo_open, meminfo_close, meminfo_read, meminfo_write, meminfo_poll };
+static file_operations_table irqtrace_op = { irqtrace_open, irqtrace_close, irqtrace_read, irqtrace_write, irqtrace_poll };
+
+/* devices that open finds by name without a file in the file system */
+static device_entry_t devices[] = {
+    { "serial", &serial_op },
+    { "pagecache", &page_cache_op },
+    { "slabinfo", &slab_info_op },
+    { "meminfo", &meminfo_op },
+    { "irqtrace", &irqtrace_op },
+};
+#define NUM_DEVICES (sizeof(devices) / sizeof(devices[0]))
+
+/*
+ * find_device
+ *
+ * Input : filename - name passed to open
+ * Output: the file operations of the device with that name, NULL if there is none
+ * Effect: none
+ */
+static file_operations_table* find_device(const uint8_t* filename) {
+    uint32_t i;
+    for (i = 0; i < NUM_DEVICES; i++) {
+        if (strncmp((int8_t*)filename, devices[i].name, FILE_NAME_LENGTH + 1) == 0) {
+            return devices[i].ops;
+        }
+    }
+    return NULL;
+}
 
 /*
  * open
@@ -27,11 +66,20 @@ static file_operations_table terminal_op = { terminal_open, terminal_close, term
 int32_t open (const uint8_t* filename)  {
     
     dir_entry_t dentry;    // empty dentry
+    file_operations_table* device;
     int i;
     // If the names file does not exist, the call returns -1
-    if (filename == NULL || *filename == '\0' || read_dentry_by_name(filename, &dentry) == -1)  {
+    if (filename == NULL || *filename == '\0') {
         return -1;
     }
+    device = find_device(filename);
+    if (device == NULL && read_dentry_by_path(filename, current_PCB->cwd, &dentry) == -1)  {
+        return -1;
+    }
+    if (device != NULL) {
+        dentry.inode = 0;
+        if (device->open(filename) == -1) return -1;
+    }
 
     // if not in used, break
     for (i = 0; i < max_file_descriptor; i++) {
@@ -44,11 +92,14 @@ int32_t open (const uint8_t* filename)  {
         // assign anunused file descriptor
         if (current_PCB->file_descriptor_ary[i].flags == 0)   { // find the free descriptor (1: in use, 0: free)
             current_PCB->file_descriptor_ary[i].inode = dentry.inode;
-            current_PCB->file_descriptor_ary[i].flags = 1;
+            current_PCB->file_descriptor_ary[i].flags = FD_IN_USE;
             current_PCB->file_descriptor_ary[i].file_position = 0;
+            memset(&current_PCB->file_descriptor_ary[i].ra, 0, sizeof(readahead_t));
             // file descriptors need to be set up according to the filetype
 
-            if (dentry.file_type == 0) {   
+            if (device != NULL) {
+                current_PCB->file_descriptor_ary[i].file_operations_table_ptr = device;
+            } else if (dentry.file_type == 0) {   
                 current_PCB->file_descriptor_ary[i].file_operations_table_ptr = &rtc_op;
                 current_PCB->file_descriptor_ary[i].file_operations_table_ptr->open(0); // initialize rtc interrupt rate to 2 Hz when the RTC device is opened.
             } else if (dentry.file_type == 1) { // if file type is directory
@@ -119,13 +170,14 @@ int32_t read (int32_t fd, void* buf, int32_t nbytes)  {
  *         buf - buffer
  *         nbytes - nbytes to write
  * Output: if success return 0, otherwise return -1
- * Effect: points to the driver's write function
- *
+ * Effect: points to the driver's write function. buf must lie in the program's
+ *         memory, so no driver copies kernel memory out or faults on it
  *
  */
 int32_t write (int32_t fd, const void* buf, int32_t nbytes)  {
     // valid file descriptor
-    if(fd < 0 || fd >= max_file_descriptor || current_PCB->file_descriptor_ary[fd].flags == 0 || buf == NULL || nbytes < 0){
+    if(fd < 0 || fd >= max_file_descriptor || current_PCB->file_descriptor_ary[fd].flags == 0 || buf == NULL ||
+       bad_userspace_addr(buf, nbytes)){
         return -1;
     }
     // points to the driver's writer function
@@ -173,6 +225,18 @@ int32_t set_current_pcb(pcb_t* new_pcb) {
 */
 
 int32_t halt (uint8_t status) {
+    return halt_status(status);
+}
+
+/*
+* halt_status
+*
+* Input : status - what the parent's execute returns, EXCEPTION_STATUS for a
+*                  process killed by an exception
+* Output: does not return to the caller
+* Effect: terminates the current process
+*/
+int32_t halt_status (uint32_t status) {
     int i;
     
     uint32_t esp_ = current_PCB->saved_esp;
@@ -183,9 +247,13 @@ int32_t halt (uint8_t status) {
     for (i = 2; i < max_file_descriptor; ++i) {
         close(i);
     }
+    mmap_release(current_PCB);
+    timer_cancel(&current_PCB->alarm_timer);
+    program_frame_free(current_PCB->program_frame);
     
     /* Set currently-active process to non-active */
     current_PCB->active = 0;
+    terminal_set_vidmap(process_terminal, 0);
     /* Check if main shell */
     if (current_PCB->parent_id == -1) { 
         --cnt_pid;
@@ -198,10 +266,11 @@ int32_t halt (uint8_t status) {
 
     /* restore parent data */
     current_PCB = (pcb_t*)(EIGHT_MB - EIGHT_KB * (current_PCB->parent_id + 1));
-    uint16_t status_ = (uint16_t)status;
+    uint32_t status_ = status;
 
     /* restore parent paging */
-    page_directory[VIRTUAL_ADDR_START >> 22].directory_4MB_entry_desc.offset_bits_31_22 = (KERNEL_MEM_ADDR_END + (current_PCB->pid) * PROGRAM_SIZE) >> 22;  //(KERNEL_MEM_ADDR_END >> 22)
+    page_directory[VIRTUAL_ADDR_START >> 22].directory_4MB_entry_desc.offset_bits_31_22 = current_PCB->program_frame >> 22;
+    mmap_load(current_PCB);
     flush_tlb();
 
     tss.ss0 = KERNEL_DS;
@@ -213,34 +282,36 @@ int32_t halt (uint8_t status) {
     // Update the current terminal's process pid
     set_terminal_process_pid(process_terminal, current_PCB->pid);
     
-    typing_flags[process_terminal] = 0;
+    terminals[process_terminal]->typing_flag = 0;
 
-    /* Halt return (asm) */
+    /* Halt return (asm): back on the parent's execute frame, return from execute
+       in the asm itself so no compiled code runs on that frame */
     asm volatile ("                                  \
             movl %0, %%esp                          ;\
             movl %1, %%ebp                          ;\
-            movl %2, %%eax                          ;\
-            "                                                                            
-            :                                       
-            : "g"(esp_), "g"(ebp_), "g"(status_)     
-            : "%eax", "%esp", "%ebp"          
-    );     
-    
-    return (uint32_t)status;
+            leave                                   ;\
+            ret                                     ;\
+            "
+            :
+            : "r"(esp_), "r"(ebp_), "a"(status_)
+    );
+
+    return status;      // not reached
 }
 
 /*
  * execute
  *
  * Input : cmd - command
- * Output: return -1 if the command cannot be executed,
+ * Output: return -1 if the command cannot be executed or no pid is left for it,
  *         return 256 if the progam dies by an exception,
  *         otherwise, if the program executes a halt system call, return a value in the range 0 to 255.
  * Effect: 
  * 
  */
 int32_t execute(const uint8_t* command) {
-    if(cnt_pid >= MAX_PID || cnt_program >= 3){  //upto 3 programs can run
+    // programs get the pids the shells of the terminals being started don't need
+    if(cnt_pid + terminal_shells_starting() >= MAX_PID){
         return -1;
     }
     int current_esp;
@@ -251,7 +322,7 @@ int32_t execute(const uint8_t* command) {
     );
     int i;
     uint32_t cmd_length = strlen((int8_t*)command);
-    uint8_t command_file_name[FILE_NAME_LENGTH] = "";
+    uint8_t command_file_name[PATH_MAX_LENGTH + 1] = "";
     uint8_t* command_temp = (uint8_t*)command; 
     int8_t cmd_copy[cmd_length];
     strcpy(cmd_copy, (int8_t*)command);
@@ -262,6 +333,7 @@ int32_t execute(const uint8_t* command) {
     uint8_t exe_buf[30]; // buffer to check whether the file is executable or not
     uint32_t exe_v_addr = 0;    // take the virtual address from 24-27 in the file
     uint32_t exe_v_addr_page_dir_addr;
+    uint32_t program_frame;     // physical 4MB page the program runs in
     // uint32_t exe_p_addr;    // physical address
     while(*command_temp == ' '){
         ++command_temp;
@@ -270,16 +342,18 @@ int32_t execute(const uint8_t* command) {
 
     /* Parse Command */
     int cmd_end = 0;
-    for(i = 0; i < FILE_NAME_LENGTH; ++i)   {
-        if(command_temp[i] == ' '){     // the end of file name (space separated)
+    int is_path = 0;
+    for(i = 0; i < PATH_MAX_LENGTH; ++i)   {
+        if(command_temp[i] == ' ' || command_temp[i] == '\0'){     // the end of file name (space separated)
             
             break;
         }
         else    {
             command_file_name[i] = command_temp[i]; // parse the command
+            is_path |= (command_temp[i] == '/');
         }
     }
-    cmd_end = i + 1;
+    cmd_end = (command_temp[i] == '\0') ? i : i + 1;
     
     command_temp = command_temp + cmd_end;
     cmd_length -= cmd_end;
@@ -290,7 +364,12 @@ int32_t execute(const uint8_t* command) {
     }
 
     /* File Checks */
-    if (read_dentry_by_name(command_file_name, &dentry_temp) == -1)   {
+    // a path from the working directory, a plain name may also be a program in the root
+    if (read_dentry_by_path(command_file_name, current_PCB->cwd, &dentry_temp) == -1 &&
+        (is_path || read_dentry_by_name(command_file_name, &dentry_temp) == -1)) {
+        return -1;
+    }
+    if (dentry_temp.file_type != FILE_TYPE_FILE) {
         return -1;
     }
 
@@ -314,11 +393,17 @@ int32_t execute(const uint8_t* command) {
         }
     }
 
+    program_frame = program_frame_alloc();
+    if (program_frame == 0) {
+        pid_arr[current_pid] = 0;
+        return -1;
+    }
+
     // set up paging for process
     
     exe_v_addr_page_dir_addr = VIRTUAL_ADDR_START >> 22;    // shift 10 bits from 128MB in virtual address to get index
 
-    page_directory[exe_v_addr_page_dir_addr].directory_4MB_entry_desc.offset_bits_31_22 = (KERNEL_MEM_ADDR_END + current_pid * PROGRAM_SIZE) >> 22; // offset of the physical address
+    page_directory[exe_v_addr_page_dir_addr].directory_4MB_entry_desc.offset_bits_31_22 = program_frame >> 22; // offset of the physical address
     page_directory[exe_v_addr_page_dir_addr].directory_4MB_entry_desc.present = 1;
     page_directory[exe_v_addr_page_dir_addr].directory_4MB_entry_desc.read_write = 1;
     page_directory[exe_v_addr_page_dir_addr].directory_4MB_entry_desc.user_supervisor = 1;
@@ -340,6 +425,7 @@ int32_t execute(const uint8_t* command) {
     pcb_t* new_pcb = (pcb_t*)(KERNEL_MEM_ADDR_END - (current_pid + 1) * EIGHT_KB);  // since the bottom of the kernel used by kernel, we have to use one above
     new_pcb->pid = current_pid;
     new_pcb->active = 1;
+    new_pcb->program_frame = program_frame;
 
     /* Parse arguments */
     i = 0;
@@ -360,6 +446,11 @@ int32_t execute(const uint8_t* command) {
         new_pcb->parent_id = current_PCB->pid;
         ++cnt_program;
     }
+    new_pcb->cwd = (current_pid == 0) ? ROOT_DIR_INODE : current_PCB->cwd;   // children start in the parent's directory
+    mmap_reset(new_pcb);
+    signal_reset(new_pcb);
+    mmap_load(new_pcb);
+    flush_tlb();
     
 
     //reset all fd
@@ -372,7 +463,7 @@ int32_t execute(const uint8_t* command) {
         new_pcb->file_descriptor_ary[i].file_operations_table_ptr = &terminal_op;
         new_pcb->file_descriptor_ary[i].file_position = 0;
         new_pcb->file_descriptor_ary[i].inode = 0;
-        new_pcb->file_descriptor_ary[i].flags = 1;
+        new_pcb->file_descriptor_ary[i].flags = FD_IN_USE;
     }
 
     current_PCB = new_pcb;
@@ -385,7 +476,7 @@ int32_t execute(const uint8_t* command) {
     /* Setup old stack & eip */
     tss.ss0 = KERNEL_DS; 
     tss.esp0 = KERNEL_MEM_ADDR_END - (current_pid) * EIGHT_KB - FOUR_B; // esp0 tell the processor where the knernel stack for that pid is. -4 because of index starts from 0 (4 bytes).
-    uint32_t user_esp = VIRTUAL_ADDR_START + PROGRAM_SIZE - FOUR_B;
+    uint32_t user_esp = STACK_ADDR_END - FOUR_B;
     ++cnt_pid;
 
     new_pcb->saved_esp = current_esp;
@@ -397,14 +488,14 @@ int32_t execute(const uint8_t* command) {
     set_terminal_process_pid(process_terminal, current_pid);
 
     // check whether the command needs typing during working
-    if(strlen((char*)command_file_name) == 5 && (!strncmp((char*)command_file_name, "shell", 5))){    
-        typing_flags[process_terminal] = 0;
-    }   else if(strlen((char*)command_file_name) == 5 && (!strncmp((char*)command_file_name, "hello", 5))){
-        typing_flags[process_terminal] = 0;
-    }   else if(strlen((char*)command_file_name) == 7 && (!strncmp((char*)command_file_name, "counter", 7))){
-        typing_flags[process_terminal] = 0;
+    if(strlen((char*)dentry_temp.file_name) == 5 && (!strncmp((char*)dentry_temp.file_name, "shell", 5))){    
+        terminals[process_terminal]->typing_flag = 0;
+    }   else if(strlen((char*)dentry_temp.file_name) == 5 && (!strncmp((char*)dentry_temp.file_name, "hello", 5))){
+        terminals[process_terminal]->typing_flag = 0;
+    }   else if(strlen((char*)dentry_temp.file_name) == 7 && (!strncmp((char*)dentry_temp.file_name, "counter", 7))){
+        terminals[process_terminal]->typing_flag = 0;
     }  else{
-        typing_flags[process_terminal] = 1;
+        terminals[process_terminal]->typing_flag = 1;
     }
 
     /* Go to usermode (IRET) */
@@ -463,6 +554,7 @@ int32_t shell_execute(const uint8_t* command) {
     uint8_t exe_buf[30]; // buffer to check whether the file is executable or not
     uint32_t exe_v_addr = 0;    // take the virtual address from 24-27 in the file
     uint32_t exe_v_addr_page_dir_addr;
+    uint32_t program_frame;     // physical 4MB page the program runs in
     // uint32_t exe_p_addr;    // physical address
     while(*command_temp == ' '){
         ++command_temp;
@@ -515,13 +607,20 @@ int32_t shell_execute(const uint8_t* command) {
         }
     }
 
+    program_frame = program_frame_alloc();
+    if (program_frame == 0) {
+        pid_arr[current_pid] = 0;
+        restore_flags(flags);
+        return -1;
+    }
+
     restore_flags(flags);
 
     // set up paging for process
     
     exe_v_addr_page_dir_addr = VIRTUAL_ADDR_START >> 22;    // shift 10 bits from 128MB in virtual address to get index
 
-    page_directory[exe_v_addr_page_dir_addr].directory_4MB_entry_desc.offset_bits_31_22 = (KERNEL_MEM_ADDR_END + current_pid * PROGRAM_SIZE) >> 22; // offset of the physical address
+    page_directory[exe_v_addr_page_dir_addr].directory_4MB_entry_desc.offset_bits_31_22 = program_frame >> 22; // offset of the physical address
     page_directory[exe_v_addr_page_dir_addr].directory_4MB_entry_desc.present = 1;
     page_directory[exe_v_addr_page_dir_addr].directory_4MB_entry_desc.read_write = 1;
     page_directory[exe_v_addr_page_dir_addr].directory_4MB_entry_desc.user_supervisor = 1;
@@ -544,6 +643,7 @@ int32_t shell_execute(const uint8_t* command) {
     pcb_t* new_pcb = (pcb_t*)(KERNEL_MEM_ADDR_END - (current_pid + 1) * EIGHT_KB);  // since the bottom of the kernel used by kernel, we have to use one above
     new_pcb->pid = current_pid;
     new_pcb->active = 1;
+    new_pcb->program_frame = program_frame;
 
     /* Parse arguments */
     i = 0;
@@ -559,6 +659,12 @@ int32_t shell_execute(const uint8_t* command) {
     
  
     new_pcb->parent_id = -1;
+    new_pcb->cwd = ROOT_DIR_INODE;
+    mmap_reset(new_pcb);
+    signal_reset(new_pcb);
+    mmap_load(new_pcb);
+    flush_tlb();
+    terminals[process_terminal]->shell_pid = current_pid;
 
     
 
@@ -572,7 +678,7 @@ int32_t shell_execute(const uint8_t* command) {
         new_pcb->file_descriptor_ary[i].file_operations_table_ptr = &terminal_op;
         new_pcb->file_descriptor_ary[i].file_position = 0;
         new_pcb->file_descriptor_ary[i].inode = 0;
-        new_pcb->file_descriptor_ary[i].flags = 1;
+        new_pcb->file_descriptor_ary[i].flags = FD_IN_USE;
     }
 
     current_PCB = new_pcb;
@@ -585,7 +691,7 @@ int32_t shell_execute(const uint8_t* command) {
     /* Setup old stack & eip */
     tss.ss0 = KERNEL_DS; 
     tss.esp0 = KERNEL_MEM_ADDR_END - (current_pid) * EIGHT_KB - FOUR_B; // esp0 tell the processor where the knernel stack for that pid is. -4 because of index starts from 0 (4 bytes).
-    uint32_t user_esp = VIRTUAL_ADDR_START + PROGRAM_SIZE - FOUR_B;
+    uint32_t user_esp = STACK_ADDR_END - FOUR_B;
     ++cnt_pid;
 
     new_pcb->saved_esp = current_esp;
@@ -644,7 +750,7 @@ int32_t getargs(uint8_t* buf, int32_t nbytes){
 *           -1 - if it is failed
 */
 int32_t vidmap(uint8_t ** screen_start){
-    if((uint32_t)screen_start == NULL || (uint32_t)screen_start < VIRTUAL_ADDR_START || (uint32_t)screen_start > VIRTUAL_ADDR_START + PROGRAM_SIZE){
+    if((uint32_t)screen_start == NULL || bad_userspace_addr(screen_start, sizeof(*screen_start))){
         return -1;
     }
     
@@ -680,8 +786,11 @@ int32_t vidmap(uint8_t ** screen_start){
     if (current_terminal == process_terminal) {
         user_vidmem_page_table[0].base_addr = VID_MEM_ADDR >> 12;
     } else {
-        user_vidmem_page_table[0].base_addr = ((VID_MEM_ADDR + (process_terminal + 1) * FOUR_KB) >> 12);
+        user_vidmem_page_table[0].base_addr = (uint32_t)terminals[process_terminal]->video_page >> 12;
     }
+
+    // hardware scrolling would move the screen away from the mapped page
+    terminal_set_vidmap(process_terminal, 1);
     
     restore_flags(flags);
 
@@ -693,28 +802,283 @@ int32_t vidmap(uint8_t ** screen_start){
 
 
 /*
-*   set_handler
-*   
-*   Input : signum - specifies which signal's hander to change
-*           handler_address - pointer to user-level function to handle signal
+*   poll
+*
+*   Input : fds - array of descriptors to wait on, revents is filled in
+*           nfds - number of entries in fds
+*           timeout - milliseconds to wait, 0 to return at once, -1 to wait forever
+*   Output: number of entries with revents != 0, 0 on timeout
+*           -1 - if it is failed or a signal came in while waiting
+*   Effect: halts until one of the drivers reports a requested event or the
+*           timeout (counted in PIT ticks) runs out
+*/
+int32_t poll(pollfd_t* fds, int32_t nfds, int32_t timeout) {
+    if (nfds <= 0 || nfds > max_file_descriptor || bad_userspace_addr(fds, nfds * sizeof(pollfd_t))) {
+        return -1;
+    }
+
+    uint32_t start = pit_ticks;
+    uint32_t ticks = (timeout > 0) ? PIT_MS_TO_TICKS(timeout) : 0;
+    int32_t i, fd, ready;
+    file_descriptor_entry_t* entry;
+
+    while (1) {
+        ready = 0;
+        for (i = 0; i < nfds; ++i) {
+            fd = fds[i].fd;
+            fds[i].revents = 0;
+            if (fd < 0 || fd >= max_file_descriptor || current_PCB->file_descriptor_ary[fd].flags == 0) {
+                fds[i].revents = POLLNVAL;  // reported even if not requested
+                ++ready;
+                continue;
+            }
+            entry = &current_PCB->file_descriptor_ary[fd];
+            fds[i].revents = entry->file_operations_table_ptr->poll(fd) & fds[i].events;
+            if (fds[i].revents) ++ready;
+        }
+
+        if (ready || timeout == 0) return ready;
+        if (timeout > 0 && pit_ticks - start >= ticks) return 0;
+        if (signal_pending()) return -1;
+
+        // sleep until the next interrupt changes some driver's state
+        asm volatile ("hlt");
+    }
+}
+
+/*
+*   fcntl
+*
+*   Input : fd - file descriptor
+*           cmd - F_GETFL or F_SETFL
+*           arg - new flags for F_SETFL (only O_NONBLOCK and O_APPEND can be changed)
+*   Output: the flags for F_GETFL, 0 for F_SETFL
+*           -1 - if it is failed
+*/
+int32_t fcntl(int32_t fd, int32_t cmd, int32_t arg) {
+    if (fd < 0 || fd >= max_file_descriptor || current_PCB->file_descriptor_ary[fd].flags == 0) {
+        return -1;
+    }
+
+    file_descriptor_entry_t* entry = &current_PCB->file_descriptor_ary[fd];
+    switch (cmd) {
+        case F_GETFL:
+            return entry->flags & FD_SETTABLE_FLAGS;
+        case F_SETFL:
+            entry->flags = (entry->flags & ~FD_SETTABLE_FLAGS) | (arg & FD_SETTABLE_FLAGS);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+/*
+*   create
+*
+*   Input : filename - path of the file
+*   Output: a file descriptor open on the file
+*           -1 - if it is failed
+*   Effect: creates an empty regular file, or empties the file if it exists
+*/
+int32_t create(const uint8_t* filename) {
+    dir_entry_t dentry;
+
+    if (filename == NULL || *filename == '\0') {
+        return -1;
+    }
+    if (read_dentry_by_path(filename, current_PCB->cwd, &dentry) == 0) {
+        if (dentry.file_type != FILE_TYPE_FILE || fs_truncate(dentry.inode, 0) == -1) {
+            return -1;
+        }
+    } else if (fs_create_path(filename, current_PCB->cwd, FILE_TYPE_FILE) == -1) {
+        return -1;
+    }
+    return open(filename);
+}
+
+/*
+*   chdir
+*
+*   Input : path - directory to change to, from the working directory unless it starts with '/'
 *   Output: 0 - if it worked fine
 *           -1 - if it is failed
-*   Effect: Updates a signal's handler function (were it actually implemented)
+*   Effect: changes the working directory of the process, its children start there
 */
-int32_t set_handler(int32_t signum, void* handler_address) {
-    return -1;
+int32_t chdir(const uint8_t* path) {
+    dir_entry_t dentry;
+
+    if (path == NULL || read_dentry_by_path(path, current_PCB->cwd, &dentry) == -1 ||
+        dentry.file_type != FILE_TYPE_DIR) {
+        return -1;
+    }
+    current_PCB->cwd = dentry.inode;
+    return 0;
 }
 
 /*
-*   sigreturn
-*   
-*   Input : none
+*   mkdir
+*
+*   Input : path - directory to create, from the working directory unless it starts with '/'
 *   Output: 0 - if it worked fine
 *           -1 - if it is failed
-*   Effect: copies hardware context back on processor
+*   Effect: creates an empty directory
 */
-int32_t sigreturn(void) {
-    return -1;
+int32_t mkdir(const uint8_t* path) {
+    if (path == NULL || fs_create_path(path, current_PCB->cwd, FILE_TYPE_DIR) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+*   truncate
+*
+*   Input : fd - file descriptor of a regular file
+*           length - new length of the file
+*   Output: 0 - if it worked fine
+*           -1 - if it is failed
+*   Effect: cuts the file to length, or extends it with zeros
+*/
+int32_t truncate(int32_t fd, uint32_t length) {
+    if (fd < 2 || fd >= max_file_descriptor || current_PCB->file_descriptor_ary[fd].flags == 0) {
+        return -1;
+    }
+    if (current_PCB->file_descriptor_ary[fd].file_operations_table_ptr != &file_op) {
+        return -1;
+    }
+    return fs_truncate(current_PCB->file_descriptor_ary[fd].inode, length);
+}
+
+/*
+*   lseek
+*
+*   Input : fd - file descriptor of a regular file
+*           offset - signed offset
+*           whence - SEEK_SET, SEEK_CUR or SEEK_END, what offset is added to
+*   Output: the new file position
+*           -1 - if fd is not a regular file, whence is unknown or the position would be negative
+*   Effect: moves the file position, writing past the end leaves a zeroed gap
+*/
+int32_t lseek(int32_t fd, int32_t offset, int32_t whence) {
+    file_descriptor_entry_t* entry;
+    int32_t base;
+
+    if (fd < 2 || fd >= max_file_descriptor || current_PCB->file_descriptor_ary[fd].flags == 0) {
+        return -1;
+    }
+    entry = &current_PCB->file_descriptor_ary[fd];
+    if (entry->file_operations_table_ptr != &file_op) {
+        return -1;
+    }
+    switch (whence) {
+        case SEEK_SET: base = 0; break;
+        case SEEK_CUR: base = entry->file_position; break;
+        case SEEK_END: base = fs_file_length(entry->inode); break;
+        default: return -1;
+    }
+    if (offset < -base) {
+        return -1;
+    }
+    entry->file_position = base + offset;
+    return entry->file_position;
+}
+
+/*
+*   pread
+*
+*   Input : fd - file descriptor of a regular file
+*           buf - buffer
+*           nbytes - number of bytes to read
+*           offset - where in the file to read
+*   Output: number of bytes read, 0 at or past the end of the file
+*           -1 - if fd is not a regular file or buf is not in user memory
+*   Effect: reads without using or moving the file position
+*/
+int32_t pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset) {
+    if (fd < 2 || fd >= max_file_descriptor || current_PCB->file_descriptor_ary[fd].flags == 0) {
+        return -1;
+    }
+    if (current_PCB->file_descriptor_ary[fd].file_operations_table_ptr != &file_op ||
+        bad_userspace_addr(buf, nbytes)) {
+        return -1;
+    }
+    return read_data(current_PCB->file_descriptor_ary[fd].inode, offset, buf, nbytes);
+}
+
+/*
+*   fstat
+*
+*   Input : fd - any open file descriptor
+*           st - filled in with the inode, type, length and number of blocks
+*   Output: 0 - if it worked fine
+*           -1 - if fd is not open or st is not in user memory
+*   Effect: none
+*/
+int32_t fstat(int32_t fd, stat_t* st) {
+    file_descriptor_entry_t* entry;
+
+    if (fd < 0 || fd >= max_file_descriptor || current_PCB->file_descriptor_ary[fd].flags == 0 ||
+        bad_userspace_addr(st, sizeof(stat_t))) {
+        return -1;
+    }
+    entry = &current_PCB->file_descriptor_ary[fd];
+    memset(st, 0, sizeof(stat_t));
+    st->inode = entry->inode;
+    if (entry->file_operations_table_ptr == &file_op) {
+        st->type = FILE_TYPE_FILE;
+    } else if (entry->file_operations_table_ptr == &dir_op) {
+        st->type = FILE_TYPE_DIR;
+    } else if (entry->file_operations_table_ptr == &rtc_op) {
+        st->type = FILE_TYPE_RTC;
+        return 0;
+    } else {
+        st->inode = 0;
+        st->type = STAT_TYPE_DEVICE;
+        return 0;
+    }
+    if (entry->inode == ROOT_DIR_INODE) {    // the boot block
+        st->length = get_num_dir_entry() * sizeof(dir_entry_t);
+        return 0;
+    }
+    st->length = fs_file_length(entry->inode);
+    st->blocks = (st->length + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE;
+    return 0;
+}
+
+/*
+*   getdents
+*
+*   Input : fd - file descriptor of a directory
+*           buf - buffer for the records
+*           nbytes - size of buf
+*   Output: number of bytes filled, 0 after the last entry
+*           -1 - if fd is not a directory, buf is not in user memory or the next entry does not fit
+*   Effect: packs as many dirent_t records as fit and moves past them
+*/
+int32_t getdents(int32_t fd, void* buf, int32_t nbytes) {
+    file_descriptor_entry_t* entry;
+
+    if (fd < 2 || fd >= max_file_descriptor || current_PCB->file_descriptor_ary[fd].flags == 0 ||
+        bad_userspace_addr(buf, nbytes)) {
+        return -1;
+    }
+    entry = &current_PCB->file_descriptor_ary[fd];
+    if (entry->file_operations_table_ptr != &dir_op) {
+        return -1;
+    }
+    return fs_getdents(entry->inode, &entry->file_position, buf, nbytes);
+}
+
+/*
+*   fd_is_nonblocking
+*
+*   Input : fd - file descriptor of the running process
+*   Output: 1 if O_NONBLOCK is set on fd, 0 otherwise
+*/
+int32_t fd_is_nonblocking(int32_t fd) {
+    pcb_t* pcb = get_current_pcb();
+    if (pcb == NULL || fd < 0 || fd >= max_file_descriptor) return 0;
+    return (pcb->file_descriptor_ary[fd].flags & O_NONBLOCK) ? 1 : 0;
 }
 
 /*
@@ -4,6 +4,11 @@
 #include "rtc.h"
 #include "file_system.h"
 #include "x86_desc.h"
+#include "paging.h"
+#include "page_cache.h"
+#include "signal.h"
+#include "clock.h"
+#include "timer.h"
 
 #define EIGHT_MB 0x800000   // 8MB
 #define EIGHT_KB 0x2000     // 8KB
@@ -17,7 +22,7 @@
 #define TERMINAL_MAX_SIZE   128 // max size of terminal
 
 #define KERNEL_MEM_ADDR_END     0x800000 // kernel end address
-#define MAX_PID                 6     // max num of processes allowed
+#define MAX_PID                 16    // max num of processes allowed, a shell per terminal plus programs (8MB + 16 * 4MB of RAM)
 #define PROGRAM_SIZE            0x400000    // each program size 4MB
 #define PROGRAM_IMAGE_ADDR      0x48000     // the offset of the program image
 
@@ -31,22 +36,108 @@
 #define USER_VIDMEM_IDX         USER_VIDMEM_ADDR/FOUR_MB // 136MB/4MB
 
 
+/* file descriptor flags */
+#define FD_IN_USE           0x1     // descriptor is open
+#define O_NONBLOCK          0x2     // read returns -1 instead of waiting when nothing is ready
+#define O_APPEND            0x4     // every write goes to the end of the file
+#define FD_SETTABLE_FLAGS   (O_NONBLOCK | O_APPEND)    // flags a program may change through fcntl
+
+/* fcntl commands */
+#define F_GETFL             3
+#define F_SETFL             4
+
+/* poll events, returned by the poll callback of each driver */
+#define POLLIN              0x01    // read will not block
+#define POLLOUT             0x04    // write will not block
+#define POLLNVAL            0x20    // fd is not open
+
+/* lseek */
+#define SEEK_SET            0       // offset from the start of the file
+#define SEEK_CUR            1       // offset from the file position
+#define SEEK_END            2       // offset from the end of the file
+
+#define STAT_TYPE_DEVICE    3       // fstat type of terminals and devices, files use FILE_TYPE_*
+
 /* jump table  (file operaions table) */ 
 typedef struct file_operations_table {
     int32_t (*open)(const uint8_t* filename);
     int32_t (*close)(int32_t fd);
     int32_t (*read)(int32_t fd, void* buf, int32_t nbytes);
     int32_t (*write)(int32_t fd, const void* buf, int32_t nbytes);
+    int32_t (*poll)(int32_t fd);    // returns the POLL* events that are ready now
 } file_operations_table;
 
+/* a device that is opened by name, not through the file system */
+typedef struct device_entry_t {
+    int8_t* name;
+    file_operations_table* ops;
+} device_entry_t;
+
+/* read state of an open file, all 0 when it is opened */
+typedef struct readahead_t{
+    uint32_t next;      // position the next read starts at if reads are sequential
+    uint32_t window;    // blocks to read ahead, 0 while reads are not sequential
+    uint32_t mark;      // block that starts the next read-ahead once a read reaches it
+    page_t* page;       // page cache page at the position, serves the next small read
+} readahead_t;
+
 /* file descriptor */
 typedef struct file_descriptor_entry_t{
     file_operations_table* file_operations_table_ptr; 
     uint32_t inode;
     uint32_t file_position;
-    uint32_t flags; // whether it is open or not
+    uint32_t flags; // FD_IN_USE when open, plus O_NONBLOCK
+    readahead_t ra; // regular files only
 } file_descriptor_entry_t;
 
+/* what fstat reports about an open file */
+typedef struct stat_t {
+    uint32_t inode;
+    uint32_t type;      // FILE_TYPE_* or STAT_TYPE_DEVICE
+    uint32_t length;    // bytes, for directories the size of their entries
+    uint32_t blocks;    // data blocks the file uses
+} stat_t;
+
+/* one entry of the array passed to poll */
+typedef struct pollfd_t {
+    int32_t fd;
+    int16_t events;     // events the caller is waiting for
+    int16_t revents;    // events that are ready, filled in by poll
+} pollfd_t;
+
+/* mmap */
+#define MMAP_ADDR_START     (VIRTUAL_ADDR_START + PROGRAM_SIZE)    // 132MB, right above the program image
+#define MMAP_TABLES         4       // 4KB page tables per process, each maps 4MB
+#define MMAP_ADDR_END       (MMAP_ADDR_START + MMAP_TABLES * FOUR_MB)
+#define MMAP_MAX_REGIONS    8
+
+/* heap, grown and shrunk by sbrk */
+#define HEAP_ADDR_START     MMAP_ADDR_END   // 148MB, above the mmap area
+#define HEAP_TABLES         2               // 4KB page tables per process, each maps 4MB
+#define HEAP_ADDR_END       (HEAP_ADDR_START + HEAP_TABLES * FOUR_MB)  // 156MB, user video memory is above
+
+/* user stack, grows down from STACK_ADDR_END as the program touches it */
+#define STACK_ADDR_START    (USER_VIDMEM_ADDR + FOUR_MB)    // 160MB, above user video memory
+#define STACK_ADDR_END      (STACK_ADDR_START + FOUR_MB)    // 164MB, one page table
+#define STACK_LIMIT         0x100000    // 1MB, the page below it is the guard page
+
+/* a file mapped into the address space of a process */
+typedef struct mmap_region_t {
+    uint32_t addr;      // first virtual address, 0 if the slot is free
+    uint32_t pages;
+    uint32_t inode;
+} mmap_region_t;
+
+/* what a process was doing when an exception killed it */
+typedef struct crash_t {
+    uint32_t exception;     // vector, 0 to 19
+    uint32_t eip;           // the faulting instruction
+    uint32_t addr;          // address a page fault tried to reach, 0 for other exceptions
+    uint32_t error;         // error code the processor pushed, 0 if there is none
+} crash_t;
+
+#define EXCEPTION_STATUS    256     // what execute returns for a program killed by an exception
+
 /* pcb */
 typedef struct pcb_t{
     uint32_t pid; // process id
@@ -59,11 +150,28 @@ typedef struct pcb_t{
     uint8_t active;
     uint32_t cmd_arg_len;
     uint8_t cmd_arg[TERMINAL_MAX_SIZE];
+    uint32_t cwd;   // inode of the working directory
+    mmap_region_t mmaps[MMAP_MAX_REGIONS];
+    page_table_entry_t* mmap_tables[MMAP_TABLES];    // from frame_alloc, NULL until a mapping needs one
+    uint32_t program_frame;     // physical address of the 4MB program page, from program_frame_alloc
+    uint32_t brk;               // end of the heap, pages up to it are mapped
+    page_table_entry_t* heap_tables[HEAP_TABLES];    // from frame_alloc, NULL until the heap reaches them
+    uint32_t stack_limit;       // bytes the stack may grow to
+    page_table_entry_t* stack_table;    // from frame_alloc, NULL until the stack is first touched
+    crash_t crash;              // the exception that killed the process
+    uint32_t sig_pending;       // SIGNAL_BIT of each signal sent but not delivered yet
+    uint32_t sig_blocked;       // signals that stay pending, all of them while a handler runs
+    uint32_t sig_saved_blocked; // sig_blocked before the running handler, sigreturn puts it back
+    void* sig_handlers[NUM_SIGNALS];    // user handlers, NULL for the default action
+    timer_t alarm_timer;        // sends ALARM, armed by the alarm system call
 } pcb_t;
 
+extern uint32_t pid_arr[MAX_PID];   // 1 for each pid in use
+
 extern void syscall_handler();
 
 int32_t halt (uint8_t status);
+int32_t halt_status (uint32_t status);
 int32_t execute (const uint8_t* command);
 
 int32_t open (const uint8_t* filename);
@@ -75,6 +183,22 @@ int32_t getargs(uint8_t* buf, int32_t nbytes);
 int32_t vidmap(uint8_t ** screen_start);
 int32_t set_handler(int32_t signum, void* handler_address);
 int32_t sigreturn(void);
+int32_t poll(pollfd_t* fds, int32_t nfds, int32_t timeout);
+int32_t fcntl(int32_t fd, int32_t cmd, int32_t arg);
+int32_t create(const uint8_t* filename);
+int32_t truncate(int32_t fd, uint32_t length);
+int32_t chdir(const uint8_t* path);
+int32_t mkdir(const uint8_t* path);
+int32_t mmap(int32_t fd, uint32_t length, uint8_t** addr);
+int32_t munmap(void* addr);
+int32_t sbrk(int32_t increment);
+int32_t lseek(int32_t fd, int32_t offset, int32_t whence);
+int32_t pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+int32_t fstat(int32_t fd, stat_t* st);
+int32_t getdents(int32_t fd, void* buf, int32_t nbytes);
+int32_t alarm(uint32_t ms);
+int32_t clock_gettime(timespec_t* ts);
+int32_t nanosleep(const timespec_t* req);
 
 int32_t shell_execute(const uint8_t* command);
 
@@ -83,5 +207,6 @@ extern pcb_t* get_current_pcb();
 extern int32_t set_current_pcb(pcb_t* new_pcb);
 void flush_tlb();
 int32_t get_cnt_pid();
+int32_t fd_is_nonblocking(int32_t fd);
 
 #endif /* _SYSCALL_H */
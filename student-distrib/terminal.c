@@ -1,28 +1,32 @@
 #include "terminal.h"
+#include "serial.h"
 
 // static int screen_x;
 // static int screen_y;
 
-int terminal_cursor_positions[NUM_TERMINALS][2] = { {0,0},{0,0},{0,0} };
+terminal_t* terminals[MAX_TERMINALS];
 
-static char* video_mem = (char *)VIDEO;
+static char* video_mem = (char *)VIDEO;   // top left of the displayed screen, moves with vga_origin
 
-int x_pos1[NUM_ROWS];
-int x_pos2[NUM_ROWS];
-int x_pos3[NUM_ROWS];
-int* terminal_x_positions[NUM_TERMINALS] = {x_pos1, x_pos2, x_pos3};
-int *x_positions = x_pos1;
+// first character cell shown by the CRTC, a multiple of NUM_COLS
+static int vga_origin = 0;
+
+int hw_scroll_enabled = 1;
+
+static void vga_set_origin(int origin);
+
+int *x_positions = NULL;    // x_positions of the displayed terminal
 
 volatile int kb_int_occured = 0;
 
 int current_terminal = 0;
 int process_terminal = 0;
-uint32_t esp_ebp_term[NUM_TERMINALS][2] = {{-1,-1}, {-1, -1}, {-1,-1}}; // array to store esp and ebp before switch the process
 
 int cursor_on = 0;
 
-int command_history_row[3] = {0,0,0};   // initialie the command history row to 0
-unsigned char command_history[3][50][128];
+// frames needed to hold a terminal_t
+#define TERMINAL_FRAMES ((sizeof(terminal_t) + FOUR_KB - 1) / FOUR_KB)
+
 /*
     Initializes and opens the terminal
     Input: none
@@ -35,35 +39,116 @@ void terminal_init() {
     screen_y = 0;
     kb_int_occured = 0;
     cursor_on = 0;
-    x_positions = x_pos1;
     current_terminal = 0;
     process_terminal = 0;
-    int i,j;
-    for (i = 0; i < NUM_TERMINALS; ++i) {
-        for (j = 0; j < 2; ++j) {
-            terminal_cursor_positions[i][j] = 0;
-        }
+    int i;
+
+    for (i = 0; i < MAX_TERMINALS; ++i) {
+        terminal_destroy(i);
     }
-    memset(x_pos1, 0, NUM_ROWS);
-    memset(x_pos2, 0, NUM_ROWS);
-    memset(x_pos3, 0, NUM_ROWS);
     
-    page_terminal_vidmem(1);
-    page_terminal_vidmem(2);
-    page_terminal_vidmem(3);
-
-    for (i = 0; i < 50; i++)    { // 50: number of stored history
-        for (j = 0; j < TERMINAL_BUFFER_SIZE; j++)  {
-            command_history[0][i][j] = NULL;
-            command_history[1][i][j] = NULL;
-            command_history[2][i][j] = NULL;
-        }
+    for (i = 1; i < VGA_SCROLL_PAGES; ++i) {
+        page_terminal_vidmem(i);
     }
+    vga_set_origin(0);
+
+    // the first terminal's shell is started by the kernel, not the scheduler
+    terminal_create(0);
+    terminals[0]->shell_pid = 0;
+    terminals[0]->process_pid = 0;
+    x_positions = terminals[0]->x_positions;
 
     flush_tlb();
 
 }
 
+/*
+    Creates a terminal, its shell is started by the scheduler
+    Input: terminal - number of the terminal, 0 to MAX_TERMINALS-1
+    Output: the new terminal, or NULL if out of frames or processes
+    Effects: allocates the terminal and a frame for its screen
+*/
+terminal_t* terminal_create(int terminal) {
+    terminal_t* t;
+    char* page;
+    int i;
+
+    if (terminal < 0 || terminal >= MAX_TERMINALS) return NULL;
+    if (terminals[terminal] != NULL) return terminals[terminal];
+
+    // every terminal needs a process for its shell
+    if (get_cnt_pid() + terminal_shells_starting() >= MAX_PID) return NULL;
+
+    t = (terminal_t*)frame_alloc(TERMINAL_FRAMES);
+    if (t == NULL) return NULL;
+    page = (char*)frame_alloc(1);
+    if (page == NULL) {
+        frame_free(t, TERMINAL_FRAMES);
+        return NULL;
+    }
+
+    memset(t, 0, sizeof(terminal_t));
+    t->id = terminal;
+    t->video_page = page;
+    t->esp = -1;
+    t->ebp = -1;
+    t->shell_pid = -1;
+    t->process_pid = -1;
+
+    // blank screen
+    for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
+        page[i << 1] = ' ';
+        page[(i << 1) + 1] = ATTRIB;
+    }
+
+    terminals[terminal] = t;
+    return t;
+}
+
+/*
+    Counts the terminals whose shell the scheduler has not started yet
+    Input: none
+    Output: number of such terminals, each still needs a pid
+    Effects: none
+*/
+int terminal_shells_starting(void) {
+    int i, starting = 0;
+
+    for (i = 0; i < MAX_TERMINALS; ++i) {
+        if (terminals[i] != NULL && terminals[i]->shell_pid == -1) ++starting;
+    }
+    return starting;
+}
+
+/*
+    Frees a terminal
+    Input: terminal - number of the terminal
+    Output: none
+    Effects: returns the terminal's frames to the frame pool
+*/
+void terminal_destroy(int terminal) {
+    terminal_t* t;
+
+    if (terminal < 0 || terminal >= MAX_TERMINALS || terminals[terminal] == NULL) return;
+    t = terminals[terminal];
+    terminals[terminal] = NULL;
+    frame_free(t->video_page, 1);
+    frame_free(t, TERMINAL_FRAMES);
+}
+
+/*
+    Makes a terminal run on COM1
+    Input: terminal - number of the terminal
+    Output: the terminal, or NULL if it could not be created
+    Effects: creates the terminal if needed, its output is copied to COM1 and
+             its reads take lines from COM1 instead of the keyboard
+*/
+terminal_t* terminal_set_serial(int terminal) {
+    terminal_t* t = terminal_create(terminal);
+    if (t != NULL) t->serial = 1;
+    return t;
+}
+
 /*
     Initializes and opens the terminal
     Input: none
@@ -119,29 +204,57 @@ int32_t terminal_write(int fd, const void* buf, int32_t nbytes) {
     return r;
 }
 
+/*
+    Checks if a full line is waiting in the keyboard buffer of this terminal
+    Input: none
+    Output: 1 if a newline has been typed, 0 otherwise
+    Effects: none, caller must have interrupts disabled
+*/
+static int terminal_line_ready(void) {
+    char* kb_buf = get_kb_buffer();
+    int kb_count = get_kb_buf_count();
+    int i;
+
+    if (process_terminal != current_terminal) return 0;
+    if (kb_buf[KB_BUFFER_SIZE-1] == '\n') return 1;   // full buffer only accepts a newline in the last slot
+    for (i = 0; i < kb_count; ++i) {
+        if (kb_buf[i] == '\n') return 1;
+    }
+    return 0;
+}
+
 /*
     Reads from input device and places into buf   
     Returns only when enter key if pressed
     Input: buf - buffer
             nbytes - number of bytes to ready from buf
-    Output: number of bytes sucessfully read, -1 if failed
+    Output: number of bytes sucessfully read, -1 if failed, if fd is O_NONBLOCK
+            and no line has been entered yet or if a signal came in while waiting
     Effects: Updates line_buffer
 */
 int32_t terminal_read(int fd, void* buf, int32_t nbytes) {
 
     // NULL check
     if (buf == 0 || fd != 0) return -1;
+    if (terminals[process_terminal]->serial) return serial_read(fd, buf, nbytes);
     long flags;
     uint32_t bytes_read = 0;
     
     char* b = (char*)buf;
     int kb_count, pos;
+    int nonblock = fd_is_nonblocking(fd);
 
     // First check if the keyboard buffer contains an enter key
     // If so copy that first segment
     cli_and_save(flags);    //disable interrupt
     char* kb_buf = get_kb_buffer();
     kb_count = get_kb_buf_count();
+
+    // Non-blocking readers only take complete lines, never what is still being typed
+    if (nonblock && !terminal_line_ready()) {
+        restore_flags(flags);
+        return -1;
+    }
     
     // If nothing in keyboard don't bother
     if (kb_count > 0 && process_terminal == current_terminal) {
@@ -178,7 +291,10 @@ int32_t terminal_read(int fd, void* buf, int32_t nbytes) {
     while (1) {
 
         // Wait until an int has occured, then check if int was keyboard
-        while (kb_int_occured == 0 || process_terminal != current_terminal) {asm volatile ("hlt");} 
+        while (kb_int_occured == 0 || process_terminal != current_terminal) {
+            if (signal_pending()) return -1;
+            asm volatile ("hlt");
+        }
         
         cli_and_save(flags);    //disable interrupt
         
@@ -212,6 +328,26 @@ int32_t terminal_read(int fd, void* buf, int32_t nbytes) {
 }
 
 
+/*
+    Reports whether a read or write on the terminal would return without waiting
+    Input: fd - 0 for stdin, 1 for stdout
+    Output: POLLIN if a line is ready on stdin, POLLOUT for stdout
+    Effects: none
+*/
+int32_t terminal_poll(int32_t fd) {
+    long flags;
+    int32_t ret = 0;
+
+    if (fd == 1) return POLLOUT;
+    if (fd != 0) return 0;
+    if (terminals[process_terminal]->serial) return serial_poll(fd) & POLLIN;
+
+    cli_and_save(flags);
+    if (terminal_line_ready()) ret = POLLIN;
+    restore_flags(flags);
+    return ret;
+}
+
 /*
     Clears the terminal and buffer
     Input: none
@@ -268,6 +404,9 @@ void print_char(uint8_t c) {
     int *x_pos;
     long flags;
     cli_and_save(flags);
+    if (process_terminal >= 0 && terminals[process_terminal]->serial) {
+        serial_putc(c);
+    }
     // printing to the video page it should be printed to
     if (process_terminal == current_terminal || process_terminal < 0) {
         vidmem = video_mem;
@@ -275,10 +414,10 @@ void print_char(uint8_t c) {
         sy = screen_y;
         x_pos = x_positions;
     } else {
-        vidmem = (char*) (VIDEO + (process_terminal + 1) * FOUR_KB);
-        sx = terminal_cursor_positions[process_terminal][0];
-        sy = terminal_cursor_positions[process_terminal][1];
-        x_pos = terminal_x_positions[process_terminal];
+        vidmem = terminals[process_terminal]->video_page;
+        sx = terminals[process_terminal]->cursor_x;
+        sy = terminals[process_terminal]->cursor_y;
+        x_pos = terminals[process_terminal]->x_positions;
     }
     
     if(c == '\n' || c == '\r') {
@@ -309,9 +448,8 @@ print_over_cols_check:
         screen_x = sx; screen_y = sy;
         update_cursor();
     } else {
-        terminal_cursor_positions[process_terminal][0] = sx;
-        terminal_cursor_positions[process_terminal][1] = sy;
-        terminal_x_positions[process_terminal] = x_pos;
+        terminals[process_terminal]->cursor_x = sx;
+        terminals[process_terminal]->cursor_y = sy;
     }
 
     // If screen needs to scroll to get a new blank line
@@ -326,31 +464,43 @@ print_over_cols_check:
     Moves every line up one, and moves cursor to bottom left 
     Input: none
     Output: none
-    Effects: Scrolls screen vertically down
+    Effects: Scrolls screen vertically down. The displayed terminal only moves
+             the CRTC start address down a row, and copies the screen back to
+             VIDEO when the start address runs off the scroll region
 */
 void scroll(void) {
     uint32_t i;
     uint8_t* d, *s;
 
     static char* vidmem;
-    int sy;
-    int *x_pos = terminal_x_positions[process_terminal];
+    int *x_pos = terminals[process_terminal]->x_positions;
+
+    for (i = 0; i < NUM_ROWS-1; ++i) {
+        x_pos[i] = x_pos[i+1];
+    }
 
     // using video page it should be printed to
-    if (process_terminal == current_terminal) {
+    if (process_terminal == current_terminal && hw_scroll_enabled && !terminals[current_terminal]->vidmap_on) {
+        if (vga_origin + NUM_COLS * (NUM_ROWS + 1) <= VGA_SCROLL_CELLS) {
+            vga_set_origin(vga_origin + NUM_COLS);
+        } else {
+            // window wrapped: move the rows that stay on screen back to the top
+            memcpy((char*)VIDEO, video_mem + NUM_COLS * 2, NUM_COLS * (NUM_ROWS-1) * 2);
+            vga_set_origin(0);
+        }
         vidmem = video_mem;
-        sy = screen_y;
     } else {
-        vidmem = (char*) (VIDEO + (process_terminal + 1) * FOUR_KB);
-        sy = terminal_cursor_positions[process_terminal][1];
-    }
-    
+        if (process_terminal == current_terminal) {
+            vidmem = video_mem;
+        } else {
+            vidmem = terminals[process_terminal]->video_page;
+        }
 
-    for (i = 0; i < NUM_ROWS-1; ++i) {
-        x_pos[i] = x_pos[i+1];
-        d = (uint8_t *)(vidmem + ((NUM_COLS * i * 2)));
-        s = (uint8_t *)(vidmem + ((NUM_COLS * (i+1) * 2)));
-        memmove(d, s, NUM_COLS * 2);
+        for (i = 0; i < NUM_ROWS-1; ++i) {
+            d = (uint8_t *)(vidmem + ((NUM_COLS * i * 2)));
+            s = (uint8_t *)(vidmem + ((NUM_COLS * (i+1) * 2)));
+            memmove(d, s, NUM_COLS * 2);
+        }
     }
     
     uint32_t r = (NUM_COLS * (NUM_ROWS-1));
@@ -365,12 +515,42 @@ void scroll(void) {
         screen_y = NUM_ROWS-1;
         update_cursor();
     } else {
-        terminal_cursor_positions[process_terminal][0] = 0;
-        terminal_cursor_positions[process_terminal][1] = NUM_ROWS-1;
+        terminals[process_terminal]->cursor_x = 0;
+        terminals[process_terminal]->cursor_y = NUM_ROWS-1;
         
     }
 }
 
+/*
+    Returns where the top left character of the displayed screen is
+    Input: none
+    Output: pointer into VGA text memory
+    Effects: none
+*/
+char* get_video_mem(void) {
+    return video_mem;
+}
+
+/*
+    Marks a terminal as running a program that writes to video memory directly
+    Input: terminal - terminal of the program
+           on - 1 when vidmap is called, 0 when the program halts
+    Output: none
+    Effects: moves the displayed screen back to VIDEO so the user mapping shows it
+*/
+void terminal_set_vidmap(int terminal, int on) {
+    long flags;
+    if (terminal < 0 || terminal >= MAX_TERMINALS || terminals[terminal] == NULL) return;
+    cli_and_save(flags);
+    terminals[terminal]->vidmap_on = on;
+    if (on && terminal == current_terminal && vga_origin != 0) {
+        memcpy((char*)VIDEO, video_mem, VIDEO_SIZE);
+        vga_set_origin(0);
+        update_cursor();
+    }
+    restore_flags(flags);
+}
+
 
 
 #define CRCT_PORT1 0x3D4
@@ -382,6 +562,8 @@ void scroll(void) {
 #define CURSOR_REG1 0x0F
 #define CURSOR_REG2 0x0E
 #define CURSOR_DISABLE  0x20
+#define START_ADDR_HIGH 0x0C
+#define START_ADDR_LOW  0x0D
 
 #define CURSOR_SCANLINE_S   10
 #define CURSOR_SCANLINE_E   11
@@ -418,7 +600,7 @@ void disable_cursor(void) {
 void update_cursor(void) {
 
     if (!cursor_on) return;
-    uint32_t pos = (screen_y * NUM_COLS  + screen_x); // pos
+    uint32_t pos = vga_origin + (screen_y * NUM_COLS  + screen_x); // pos, relative to the start of text memory
     outb(CURSOR_REG1, CRCT_PORT1);
     outb((uint8_t)(pos & 0xFF), CRCT_PORT2); // first half of position
 
@@ -426,6 +608,22 @@ void update_cursor(void) {
     outb((uint8_t)( (pos >> 8) & 0xFF), CRCT_PORT2); // second half
 }
 
+/*
+    Moves the displayed screen to another row of VGA text memory
+    Input: origin - character cell shown at the top left
+    Output: none
+    Effects: updates video_mem and the CRTC start address
+*/
+static void vga_set_origin(int origin) {
+    vga_origin = origin;
+    video_mem = (char*)VIDEO + (origin << 1);
+
+    outb(START_ADDR_HIGH, CRCT_PORT1);
+    outb((uint8_t)((origin >> 8) & 0xFF), CRCT_PORT2);
+    outb(START_ADDR_LOW, CRCT_PORT1);
+    outb((uint8_t)(origin & 0xFF), CRCT_PORT2);
+}
+
 /*
     Updates terminal
     Input: terminal - terminal number to switch to
@@ -434,22 +632,24 @@ void update_cursor(void) {
              Changes cursor position
 */
 void switch_terminal(int terminal) {
-    if (terminal < 0 || terminal > 2) return;
+    if (terminal < 0 || terminal >= MAX_TERMINALS || terminals[terminal] == NULL) return;
     if (terminal == current_terminal) return;
     long flags;
     cli_and_save(flags);
+    terminal_t* current = terminals[current_terminal];
+    terminal_t* next = terminals[terminal];
+
     // save
-    terminal_cursor_positions[current_terminal][0] = screen_x;
-    terminal_cursor_positions[current_terminal][1] = screen_y;
+    current->cursor_x = screen_x;
+    current->cursor_y = screen_y;
 
-    screen_x = terminal_cursor_positions[terminal][0];
-    screen_y = terminal_cursor_positions[terminal][1];
+    screen_x = next->cursor_x;
+    screen_y = next->cursor_y;
 
-    x_positions = terminal_x_positions[terminal];
-    char* current_vid_page = (char*) (VIDEO + (current_terminal + 1) * FOUR_KB);
-    char* next_vid_page = (char*) (VIDEO + (terminal + 1) * FOUR_KB);
-    memcpy(current_vid_page, video_mem, VIDEO_SIZE);
-    memcpy(video_mem, next_vid_page, VIDEO_SIZE);
+    x_positions = next->x_positions;
+    memcpy(current->video_page, video_mem, VIDEO_SIZE);
+    vga_set_origin(0);  // new screen always starts at the top of the scroll region
+    memcpy(video_mem, next->video_page, VIDEO_SIZE);
     
     current_terminal = terminal;
 
@@ -457,6 +657,21 @@ void switch_terminal(int terminal) {
     restore_flags(flags);
 }
 
+/*
+    Finds the terminal the scheduler runs after terminal
+    Input: terminal - terminal number
+    Output: the next terminal with a shell, terminal itself if it is the only one
+    Effects: none
+*/
+int next_terminal(int terminal) {
+    int i, t;
+    for (i = 1; i <= MAX_TERMINALS; ++i) {
+        t = (terminal + i) % MAX_TERMINALS;
+        if (terminals[t] != NULL && terminals[t]->shell_pid != TERMINAL_NO_SHELL) return t;
+    }
+    return terminal;
+}
+
 int get_current_terminal() {
     return current_terminal;
 }
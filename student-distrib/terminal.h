@@ -15,18 +15,46 @@
 #define ATTRIB      0x7B
 #define VIDEO_SIZE  NUM_COLS * NUM_ROWS * 2
 
+#define MAX_TERMINALS   12  // one per function key, Alt+F1 - Alt+F12
+#define TERMINAL_NO_SHELL   -2  // shell_pid of a terminal that only displays output
+#define SERIAL_TERMINAL 3   // Alt+F4, also runs on COM1 when there is a UART
+#define HISTORY_SIZE    50  // number of stored commands per terminal
+
+// The displayed terminal scrolls by moving the CRTC start address over
+// VGA text memory; the saved screens of the terminals are frames of their own.
+#define VGA_SCROLL_PAGES    8
+#define VGA_SCROLL_CELLS    (VGA_SCROLL_PAGES * 4096 / 2)
+
+/* a terminal, created the first time it is switched to */
+typedef struct terminal_t {
+    int id;
+    char* video_page;                   // saved screen while another terminal is displayed
+    int cursor_x;                       // saved screen_x
+    int cursor_y;                       // saved screen_y
+    int x_positions[NUM_ROWS];          // end of each line, for backspace
+    uint32_t esp;                       // kernel stack of its process when descheduled
+    uint32_t ebp;
+    int32_t shell_pid;                  // -1 until the scheduler starts its shell
+    int32_t process_pid;                // process currently running on it
+    char kb_buf[TERMINAL_BUFFER_SIZE];  // keyboard buffer while not displayed
+    int kb_buf_count;
+    int typing_flag;                    // 1 while the running program doesn't take keyboard input
+    int vidmap_on;                      // running program writes to video memory directly
+    int serial;                         // output is copied to COM1 and input comes from it
+    int history_row;                    // number of stored commands
+    int history_cnt;                    // how far up/down has moved back in history
+    unsigned char history[HISTORY_SIZE][TERMINAL_BUFFER_SIZE];
+} terminal_t;
+
+// Terminals by number, NULL until created
+extern terminal_t* terminals[MAX_TERMINALS];
+
 // Current terminal being displayed
 extern int current_terminal;
 
 // Current terminal that is being processed right now
 extern int process_terminal;
 
-// store command history for each terminal (3 terminals)
-extern unsigned char command_history[3][50][128];  //3: terminals, 50: number of stored history, 128: TERMINAL_BUFFER_SIZE
-
-// keep track of history row for each terminal (3 terminals)
-extern int command_history_row[3];
-
 /*
     Note: text mode is 80x25
 */
@@ -34,6 +62,18 @@ extern int command_history_row[3];
 /* Initializes terminal*/
 void terminal_init();
 
+/* Allocates a terminal and its video page*/
+terminal_t* terminal_create(int terminal);
+
+/* Frees a terminal that has no processes*/
+void terminal_destroy(int terminal);
+
+/* Number of terminals waiting for the scheduler to start their shell*/
+int terminal_shells_starting(void);
+
+/* Creates terminal and makes COM1 its input and a copy of its output*/
+terminal_t* terminal_set_serial(int terminal);
+
 /* Opens terminal*/
 int32_t terminal_open();
 
@@ -46,6 +86,9 @@ int32_t terminal_write(int fd, const void* buf, int32_t nbytes);
 /* Reads characters previously printed*/
 int32_t terminal_read(int fd, void* buf, int32_t nbytes);
 
+/* Reports whether a read or write on the terminal would return without waiting*/
+int32_t terminal_poll(int32_t fd);
+
 /* Clears terminal and resets the buffer*/
 void clear_terminal(void);
 
@@ -58,6 +101,15 @@ void print_char(uint8_t c);
 /* Moves every line up one, and moves cursor to bottom left */
 void scroll(void);
 
+/* Returns where the top left character of the displayed screen is in memory*/
+char* get_video_mem(void);
+
+/* Keeps the displayed screen at VIDEO while a vidmap program runs on terminal*/
+void terminal_set_vidmap(int terminal, int on);
+
+// 1 to scroll the displayed terminal with the CRTC start address, 0 to always copy
+extern int hw_scroll_enabled;
+
 void enable_cursor(void);
 void disable_cursor(void);
 
@@ -67,11 +119,12 @@ void update_cursor(void);
 /* switch terminal display and cursor*/
 void switch_terminal(int terminal);
 
+/* returns the next created terminal after terminal, wrapping around*/
+int next_terminal(int terminal);
+
 int get_current_terminal();
 int get_process_terminal();
 
 
-extern uint32_t esp_ebp_term[3][2]; // (esp: 0, ebp: 1) for 3 terminals
-
 #endif
 #endif
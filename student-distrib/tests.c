@@ -3,6 +3,18 @@
 #include "lib.h"
 #include "terminal.h"
 #include "file_system.h"
+#include "syscall.h"
+#include "paging.h"
+#include "klog.h"
+#include "page_cache.h"
+#include "serial.h"
+#include "lz.h"
+#include "slab.h"
+#include "mmap.h"
+#include "pit.h"
+#include "clock.h"
+#include "timer.h"
+#include "softirq.h"
 
 #define PASS 1
 #define FAIL 0
@@ -574,6 +586,1206 @@ int read_directories_test(){
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
+/* rtc_poll_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: sets the RTC to 2 Hz
+ * Coverage: rtc_poll reports a tick only until it is read
+ * Files: rtc.c
+ */
+int rtc_poll_test() {
+	TEST_HEADER;
+	int result = PASS;
+
+	rtc_open(0);
+	rtc_read(0, NULL, 0);				// consume the pending tick
+	if (rtc_poll(0) & POLLIN) {			// next tick is 500ms away
+		result = FAIL;
+	}
+	while (!(rtc_poll(0) & POLLIN)) {	// wait for the next tick
+		asm volatile ("hlt");
+	}
+	rtc_read(0, NULL, 0);
+	if (rtc_poll(0) & POLLIN) {
+		result = FAIL;
+	}
+	rtc_close(0);
+
+	return result;
+}
+
+
+/* terminal_create_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None, the terminal is freed again
+ * Coverage: terminals and their screens come from the frame pool and go back to it
+ * Files: terminal.c, paging.c
+ */
+int terminal_create_test() {
+	TEST_HEADER;
+	int result = PASS;
+	terminal_t* t;
+	char* page;
+
+	if (terminals[KLOG_TERMINAL - 1] != NULL) {	// only test with an unused terminal, the last one is the log
+		return FAIL;
+	}
+	t = terminal_create(KLOG_TERMINAL - 1);
+	if (t == NULL || t->shell_pid != -1 || t->video_page == NULL) {
+		return FAIL;
+	}
+	page = t->video_page;
+	if (!frame_in_use(page) || page[0] != ' ') {
+		result = FAIL;
+	}
+	terminal_destroy(KLOG_TERMINAL - 1);
+	if (terminals[KLOG_TERMINAL - 1] != NULL) {
+		result = FAIL;
+	}
+
+	// the freed frames are handed out again
+	t = terminal_create(KLOG_TERMINAL - 1);
+	if (t == NULL || t->video_page != page) {
+		result = FAIL;
+	}
+	terminal_destroy(KLOG_TERMINAL - 1);
+
+	return result;
+}
+
+/* snprintf_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: formatting into a buffer, truncation
+ * Files: lib.c
+ */
+int snprintf_test() {
+	TEST_HEADER;
+	int8_t buf[16];
+	int result = PASS;
+
+	if (snprintf(buf, sizeof(buf), "%d %x %s", -12, 0xab, "ok") != 9 || strncmp(buf, "-12 ab ok", 10) != 0) {
+		result = FAIL;
+	}
+	// output is cut to fit, and still NULL terminated
+	if (snprintf(buf, sizeof(buf), "%s%s", "0123456789", "0123456789") != 15 || buf[15] != '\0') {
+		result = FAIL;
+	}
+	if (snprintf(buf, 1, "abc") != 0 || buf[0] != '\0') {
+		result = FAIL;
+	}
+	klog(KLOG_INFO, "snprintf_test %s", result == PASS ? "passed" : "failed");
+	return result;
+}
+
+/* serial_write_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: sends a line on COM1
+ * Coverage: the serial device accepts writes and has room to send afterwards
+ * Files: serial.c
+ */
+int serial_write_test() {
+	TEST_HEADER;
+	int8_t* msg = "serial_write_test\n";
+	int32_t len = strlen(msg);
+
+	if (!serial_present) {
+		return serial_open(NULL) == -1 ? PASS : FAIL;
+	}
+	if (serial_write(0, msg, len) != len || serial_write(0, NULL, 1) != -1) {
+		return FAIL;
+	}
+	if (!(serial_poll(0) & POLLOUT)) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* scroll_benchmark
+ * 
+ * Inputs: None
+ * Outputs: return 0;
+ * Side Effects: prints SCROLL_BENCH_LINES lines twice and the cycle counts
+ * Coverage: hardware scrolling against copying the screen on every line
+ * Files: terminal.c
+ */
+#define SCROLL_BENCH_LINES	10000
+
+int scroll_benchmark() {
+	int i, mode;
+	uint32_t start, cycles[2];
+
+	for (mode = 0; mode < 2; ++mode) {
+		hw_scroll_enabled = mode;
+		start = rdtsc_low();
+		for (i = 0; i < SCROLL_BENCH_LINES; ++i) {
+			printf("line %d\n", i);
+		}
+		cycles[mode] = rdtsc_low() - start;
+	}
+	hw_scroll_enabled = 1;
+
+	printf("copy scroll:     %u cycles, %u per line\n", cycles[0], cycles[0] / SCROLL_BENCH_LINES);
+	printf("hardware scroll: %u cycles, %u per line\n", cycles[1], cycles[1] / SCROLL_BENCH_LINES);
+	return 0;
+}
+
+
+/* fs_write_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: leaves an empty file "write_test.txt"
+ * Coverage: create, write, append past the end of a block, truncate
+ * Files: file_system.c
+ */
+int fs_write_test() {
+	TEST_HEADER;
+	uint8_t buf[DATA_BLOCK_SIZE + 16];
+	dir_entry_t dentry;
+	int32_t inode, i;
+	uint32_t free_blocks = fs_free_blocks();
+	int result = PASS;
+
+	inode = fs_create((uint8_t*)"write_test.txt");
+	if (inode == -1 || read_dentry_by_name((uint8_t*)"write_test.txt", &dentry) == -1 || dentry.inode != inode) {
+		return FAIL;
+	}
+	if (fs_create((uint8_t*)"write_test.txt") != -1) {	// name is taken
+		result = FAIL;
+	}
+
+	for (i = 0; i < sizeof(buf); i++) {
+		buf[i] = i;
+	}
+	if (write_data(inode, 0, buf, 100) != 100 || write_data(inode, 100, buf + 100, sizeof(buf) - 100) != sizeof(buf) - 100) {
+		result = FAIL;
+	}
+	if (fs_file_length(inode) != sizeof(buf) || fs_free_blocks() != free_blocks - 2) {
+		result = FAIL;
+	}
+	memset(buf, 0, sizeof(buf));
+	if (read_data(inode, 0, buf, sizeof(buf)) != sizeof(buf)) {
+		result = FAIL;
+	}
+	for (i = 0; i < sizeof(buf); i++) {
+		if (buf[i] != (uint8_t)i) result = FAIL;
+	}
+
+	if (fs_truncate(inode, 10) != 0 || fs_file_length(inode) != 10 || fs_free_blocks() != free_blocks - 1) {
+		result = FAIL;
+	}
+	if (fs_truncate(inode, 0) != 0 || fs_free_blocks() != free_blocks) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* extent_inode_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: leaves an empty file "extent_test.txt"
+ * Coverage: new files use extents and grow their last extent, image files keep block lists
+ * Files: file_system.c
+ */
+int extent_inode_test() {
+	TEST_HEADER;
+	static uint8_t buf[3 * DATA_BLOCK_SIZE];
+	dir_entry_t dentry;
+	extent_inode_t* ext;
+	int32_t inode;
+	int result = PASS;
+
+	if (read_dentry_by_name((uint8_t*)"frame0.txt", &dentry) == -1 || IS_EXTENT_INODE(index_node_start + dentry.inode)) {
+		return FAIL;
+	}
+	if (read_data(dentry.inode, 0, buf, sizeof(buf)) != fs_file_length(dentry.inode)) {
+		result = FAIL;
+	}
+
+	inode = fs_create((uint8_t*)"extent_test.txt");
+	if (inode == -1) {
+		return FAIL;
+	}
+	ext = (extent_inode_t*)(index_node_start + inode);
+	if (!IS_EXTENT_INODE(ext) || ext->num_extents != 0) {
+		result = FAIL;
+	}
+	// written one block at a time, still one extent
+	if (write_data(inode, 0, buf, DATA_BLOCK_SIZE) != DATA_BLOCK_SIZE ||
+		write_data(inode, DATA_BLOCK_SIZE, buf, 2 * DATA_BLOCK_SIZE) != 2 * DATA_BLOCK_SIZE) {
+		result = FAIL;
+	}
+	if (ext->num_extents != 1 || ext->extents[0].count != 3) {
+		result = FAIL;
+	}
+	if (fs_truncate(inode, DATA_BLOCK_SIZE + 1) != 0 || ext->extents[0].count != 2) {
+		result = FAIL;
+	}
+	fs_truncate(inode, 0);
+	if (ext->num_extents != 0) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* path_lookup_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: leaves a directory "dir_test" holding an empty file "x"
+ * Coverage: mkdir inside the root, relative/absolute/dot paths, the dentry cache
+ * Files: file_system.c
+ */
+int path_lookup_test() {
+	TEST_HEADER;
+	dir_entry_t dentry, sub;
+	uint32_t hits;
+	int32_t inode;
+	int result = PASS;
+
+	if (read_dentry_by_path((uint8_t*)"dir_test", ROOT_DIR_INODE, &sub) == -1 &&
+		fs_create_path((uint8_t*)"dir_test", ROOT_DIR_INODE, FILE_TYPE_DIR) == -1) {
+		return FAIL;
+	}
+	if (read_dentry_by_path((uint8_t*)"dir_test", ROOT_DIR_INODE, &sub) == -1 || sub.file_type != FILE_TYPE_DIR) {
+		return FAIL;
+	}
+	if (read_dentry_by_path((uint8_t*)"dir_test/x", ROOT_DIR_INODE, &dentry) == -1) {
+		inode = fs_create_path((uint8_t*)"x", sub.inode, FILE_TYPE_FILE);
+	} else {
+		inode = dentry.inode;
+	}
+	if (inode == -1) {
+		return FAIL;
+	}
+
+	if (read_dentry_by_path((uint8_t*)"/dir_test/../dir_test/./x", ROOT_DIR_INODE, &dentry) == -1 || dentry.inode != inode) {
+		result = FAIL;
+	}
+	if (read_dentry_by_path((uint8_t*)"x", sub.inode, &dentry) == -1 || dentry.inode != inode) {
+		result = FAIL;
+	}
+	if (read_dentry_by_path((uint8_t*)"../frame0.txt", sub.inode, &dentry) == -1 || dentry.file_type != FILE_TYPE_FILE) {
+		result = FAIL;
+	}
+	// a file is not a directory, and x only lives in dir_test
+	if (read_dentry_by_path((uint8_t*)"dir_test/x/y", ROOT_DIR_INODE, &dentry) != -1 ||
+		read_dentry_by_path((uint8_t*)"x", ROOT_DIR_INODE, &dentry) != -1) {
+		result = FAIL;
+	}
+	hits = dcache_hits;
+	read_dentry_by_path((uint8_t*)"dir_test/x", ROOT_DIR_INODE, &dentry);
+	if (dcache_hits != hits + 2) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* page_cache_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: leaves a file "pcache_test.txt" holding "hELlo"
+ * Coverage: repeated reads hit the page cache, pages come from a slab, writes and
+ *           truncates keep cached pages current
+ * Files: page_cache.c, file_system.c
+ */
+int page_cache_test() {
+	TEST_HEADER;
+	static uint8_t buf[DATA_BLOCK_SIZE];
+	dir_entry_t dentry;
+	page_t* page;
+	uint32_t hits;
+	int32_t inode;
+	int result = PASS;
+
+	if (read_dentry_by_name((uint8_t*)"frame0.txt", &dentry) == -1) {
+		return FAIL;
+	}
+	read_data(dentry.inode, 0, buf, 100);
+	hits = page_cache_hits;
+	read_data(dentry.inode, 0, buf, 100);
+	if (page_cache_hits != hits + 1) {
+		result = FAIL;
+	}
+	// pages are objects of a slab cache
+	page = page_get(dentry.inode, 0);
+	if (page == NULL || ((slab_t*)((uint32_t)page & ~(SLAB_SIZE - 1)))->magic != SLAB_MAGIC) {
+		result = FAIL;
+	}
+	page_put(page);
+
+	if (read_dentry_by_name((uint8_t*)"pcache_test.txt", &dentry) == 0) {
+		inode = dentry.inode;
+	} else {
+		inode = fs_create((uint8_t*)"pcache_test.txt");
+	}
+	if (inode == -1 || fs_truncate(inode, 0) == -1) {
+		return FAIL;
+	}
+	write_data(inode, 0, (uint8_t*)"hello", 5);
+	read_data(inode, 0, buf, 5);	// now cached
+	write_data(inode, 1, (uint8_t*)"EL", 2);
+	if (read_data(inode, 0, buf, 5) != 5 || strncmp((int8_t*)buf, "hELlo", 5) != 0) {
+		result = FAIL;
+	}
+	// the cut off bytes read back as zeros
+	fs_truncate(inode, 2);
+	fs_truncate(inode, 5);
+	if (read_data(inode, 0, buf, 5) != 5 || buf[1] != 'E' || buf[2] != 0) {
+		result = FAIL;
+	}
+	write_data(inode, 2, (uint8_t*)"Llo", 3);
+	return result;
+}
+
+/* fs_data_block_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: the blocks mmap maps are page aligned and hold the file data, none past the end
+ * Files: file_system.c, mmap.c
+ */
+int fs_data_block_test() {
+	TEST_HEADER;
+	static uint8_t buf[DATA_BLOCK_SIZE];
+	dir_entry_t dentry;
+	uint8_t* block;
+	uint32_t length, i;
+
+	if (read_dentry_by_name((uint8_t*)"fish", &dentry) == -1) {
+		return FAIL;
+	}
+	length = fs_file_length(dentry.inode);
+	block = fs_data_block(dentry.inode, 1);
+	if (block == NULL || ((uint32_t)block & (FOUR_KB - 1)) != 0) {
+		return FAIL;
+	}
+	if (read_data(dentry.inode, DATA_BLOCK_SIZE, buf, DATA_BLOCK_SIZE) != DATA_BLOCK_SIZE) {
+		return FAIL;
+	}
+	for (i = 0; i < DATA_BLOCK_SIZE; i++) {
+		if (buf[i] != block[i]) {
+			return FAIL;
+		}
+	}
+	if (fs_data_block(dentry.inode, (length + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE) != NULL) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* getdents_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: the root directory packs into one buffer, and in pieces into a small one
+ * Files: file_system.c
+ */
+int getdents_test() {
+	TEST_HEADER;
+	static uint8_t buf[4096];
+	dirent_t* rec;
+	uint32_t index = 0, count = 0, pos;
+	int32_t used;
+
+	used = fs_getdents(ROOT_DIR_INODE, &index, buf, sizeof(buf));
+	if (used <= 0 || index != get_num_dir_entry() || fs_getdents(ROOT_DIR_INODE, &index, buf, sizeof(buf)) != 0) {
+		return FAIL;
+	}
+	for (pos = 0; pos < used; pos += rec->reclen) {
+		rec = (dirent_t*)(buf + pos);
+		if (rec->reclen % 4 != 0 || rec->name[rec->name_len] != '\0') {
+			return FAIL;
+		}
+		if (strncmp(rec->name, "fish", 5) == 0 && (rec->type != FILE_TYPE_FILE || rec->size != fs_file_length(rec->inode))) {
+			return FAIL;
+		}
+		++count;
+	}
+	if (count != get_num_dir_entry()) {
+		return FAIL;
+	}
+
+	// one record at a time
+	index = 0;
+	while ((used = fs_getdents(ROOT_DIR_INODE, &index, buf, DIRENT_RECLEN(FILE_NAME_LENGTH))) > 0);
+	if (used != 0 || index != get_num_dir_entry() || fs_getdents(ROOT_DIR_INODE, &index, buf, 4) != 0) {
+		return FAIL;
+	}
+	index = 0;
+	if (fs_getdents(ROOT_DIR_INODE, &index, buf, 4) != -1 || index != 0) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* file_seek_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: opens frame0.txt as the current process and grows its heap by a
+ *               page for the user buffers, both are put back after
+ * Coverage: lseek from the start, the position and the end, positions before the
+ *           start are refused; pread reads at an offset without moving the position
+ *           and refuses kernel buffers; fstat fills in a regular file
+ * Files: syscall.c, file_system.c
+ */
+int file_seek_test() {
+	static uint8_t expect[64];
+	pcb_t* pcb = get_current_pcb();
+	dir_entry_t dentry;
+	stat_t* st;
+	uint8_t* buf;
+	int32_t fd, len, i;
+	int result = PASS;
+
+	if (pcb == NULL || read_dentry_by_name((uint8_t*)"frame0.txt", &dentry) == -1) {
+		return FAIL;
+	}
+	len = fs_file_length(dentry.inode);
+	set_current_pcb(pcb);	// the file system calls use current_PCB
+	fd = open((uint8_t*)"frame0.txt");
+	buf = (uint8_t*)sbrk(FOUR_KB);
+	if (len < 20 + sizeof(expect) || fd == -1 || (int32_t)buf == -1) {
+		result = FAIL;
+		goto done;
+	}
+	st = (stat_t*)(buf + sizeof(expect));
+
+	if (lseek(fd, 0, SEEK_END) != len || lseek(fd, 10, SEEK_SET) != 10 || lseek(fd, -4, SEEK_CUR) != 6) {
+		result = FAIL;
+	}
+	if (lseek(fd, -7, SEEK_CUR) != -1 || lseek(fd, -(len + 1), SEEK_END) != -1 || lseek(fd, 0, 3) != -1 ||
+		lseek(fd, 0, SEEK_CUR) != 6) {
+		result = FAIL;
+	}
+
+	read_data(dentry.inode, 20, expect, sizeof(expect));
+	if (pread(fd, buf, sizeof(expect), 20) != sizeof(expect) || lseek(fd, 0, SEEK_CUR) != 6) {
+		result = FAIL;
+	}
+	for (i = 0; i < sizeof(expect); i++) {
+		if (buf[i] != expect[i]) result = FAIL;
+	}
+	if (pread(fd, buf, sizeof(expect), len) != 0 || pread(fd, expect, sizeof(expect), 0) != -1 ||
+		pread(fd, buf, FOUR_KB + 1, 0) != -1 || pread(fd, buf, -1, 0) != -1) {
+		result = FAIL;
+	}
+
+	if (fstat(fd, st) != 0 || st->inode != dentry.inode || st->type != FILE_TYPE_FILE || st->length != len ||
+		st->blocks != (len + DATA_BLOCK_SIZE - 1) / DATA_BLOCK_SIZE || fstat(fd, (stat_t*)expect) != -1) {
+		result = FAIL;
+	}
+done:
+	if ((int32_t)buf != -1) sbrk(-FOUR_KB);
+	if (fd != -1) close(fd);
+	return result;
+}
+
+/* file_write_check_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: leaves an empty file "write_check.txt", grows the heap by a page
+ *               for the user buffer and puts it back after
+ * Coverage: write refuses a kernel buffer and an unmapped heap buffer and leaves
+ *           the file as it was, a buffer in the heap is written
+ * Files: syscall.c, file_system.c
+ */
+int file_write_check_test() {
+	static uint8_t kernel_buf[16] = "kernel memory";
+	pcb_t* pcb = get_current_pcb();
+	dir_entry_t dentry;
+	uint8_t* buf;
+	int32_t fd, inode;
+	int result = PASS;
+
+	if (pcb == NULL) return FAIL;
+	inode = fs_create((uint8_t*)"write_check.txt");
+	if (inode == -1) {		// left by an earlier run
+		if (read_dentry_by_name((uint8_t*)"write_check.txt", &dentry) == -1) return FAIL;
+		inode = dentry.inode;
+		fs_truncate(inode, 0);
+	}
+	set_current_pcb(pcb);	// the file system calls use current_PCB
+	fd = open((uint8_t*)"write_check.txt");
+	buf = (uint8_t*)sbrk(FOUR_KB);
+	if (fd == -1 || (int32_t)buf == -1) {
+		result = FAIL;
+		goto done;
+	}
+
+	if (write(fd, kernel_buf, sizeof(kernel_buf)) != -1 || write(fd, buf + FOUR_KB, 1) != -1 ||
+		write(fd, buf, FOUR_KB + 1) != -1 || fs_file_length(inode) != 0) {
+		result = FAIL;
+	}
+	memcpy(buf, "user", 4);
+	if (write(fd, buf, 4) != 4 || fs_file_length(inode) != 4) {
+		result = FAIL;
+	}
+done:
+	if ((int32_t)buf != -1) sbrk(-FOUR_KB);
+	if (fd != -1) close(fd);
+	fs_truncate(inode, 0);
+	return result;
+}
+
+/* lz_decompress_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: literals, an overlapping match, a final literal, corrupt input
+ * Files: lz.c
+ */
+int lz_decompress_test() {
+	TEST_HEADER;
+	// "abc", copy 9 bytes from 3 back, "!"
+	uint8_t src[] = {0x35, 'a', 'b', 'c', 0x03, 0x00, 0x10, '!'};
+	uint8_t bad[] = {0x30, 'a', 'b', 'c', 0x04, 0x00};
+	uint8_t out[16];
+	int8_t* expect = "abcabcabcabc!";
+	int i;
+
+	if (lz_decompress(src, sizeof(src), out, sizeof(out)) != 13) {
+		return FAIL;
+	}
+	for (i = 0; i < 13; i++) {
+		if (out[i] != (uint8_t)expect[i]) return FAIL;
+	}
+	if (lz_decompress(src, sizeof(src), out, 12) != -1 ||		// output does not fit
+		lz_decompress(bad, sizeof(bad), out, sizeof(out)) != -1 ||	// match before the start
+		lz_decompress(src, 5, out, sizeof(out)) != -1) {		// cut off in the offset
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* fs_mount_check_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: every file of the image passed the mount checks, bad inodes are refused, crc32
+ * Files: file_system.c, lib.c
+ */
+int fs_mount_check_test() {
+	TEST_HEADER;
+	dir_entry_t dentry;
+	uint8_t c;
+	uint32_t i;
+
+	if (fs_bad_files() != 0 || crc32(0, "123456789", 9) != 0xCBF43926) {
+		return FAIL;
+	}
+	for (i = 0; i < get_num_dir_entry(); i++) {
+		read_dentry_by_index(i, &dentry);
+		if (dentry.file_type == FILE_TYPE_FILE && fs_file_length(dentry.inode) > 0 &&
+			read_data(dentry.inode, 0, &c, 1) != 1) {
+			return FAIL;
+		}
+	}
+	if (read_data(ROOT_DIR_INODE, 0, &c, 1) != -1 ||
+		read_data(FS_MAX_INODES, 0, &c, 1) != -1 || fs_file_length(FS_MAX_INODES) != 0) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* fs_write_benchmark
+ * 
+ * Inputs: None
+ * Outputs: return 0;
+ * Side Effects: leaves an empty file "bench.out", prints the cycle counts
+ * Coverage: write throughput in 4KB writes, and reading the data back
+ * Files: file_system.c
+ */
+#define FS_BENCH_BYTES	(1024 * 1024)
+int fs_write_benchmark() {
+	static uint8_t buf[DATA_BLOCK_SIZE];
+	dir_entry_t dentry;
+	uint32_t start, write_cycles, read_cycles, pos;
+	int32_t inode;
+
+	if (read_dentry_by_name((uint8_t*)"bench.out", &dentry) == 0) {
+		inode = dentry.inode;
+	} else {
+		inode = fs_create((uint8_t*)"bench.out");
+	}
+	if (inode == -1 || fs_truncate(inode, 0) == -1) {
+		printf("cannot create bench.out\n");
+		return 0;
+	}
+	memset(buf, 'w', sizeof(buf));
+
+	start = rdtsc_low();
+	for (pos = 0; pos < FS_BENCH_BYTES; pos += sizeof(buf)) {
+		if (write_data(inode, pos, buf, sizeof(buf)) != sizeof(buf)) {
+			printf("file system full at %u bytes\n", pos);
+			break;
+		}
+	}
+	write_cycles = rdtsc_low() - start;
+
+	start = rdtsc_low();
+	for (pos = 0; pos < FS_BENCH_BYTES; pos += sizeof(buf)) {
+		read_data(inode, pos, buf, sizeof(buf));
+	}
+	read_cycles = rdtsc_low() - start;
+
+	printf("write %u bytes: %u cycles, %u per 4KB\n", FS_BENCH_BYTES, write_cycles, write_cycles / (FS_BENCH_BYTES / DATA_BLOCK_SIZE));
+	printf("read  %u bytes: %u cycles, %u per 4KB\n", FS_BENCH_BYTES, read_cycles, read_cycles / (FS_BENCH_BYTES / DATA_BLOCK_SIZE));
+	fs_truncate(inode, 0);
+	return 0;
+}
+
+/* file_read_benchmark
+ * 
+ * Inputs: None
+ * Outputs: return 0;
+ * Side Effects: prints the cycle counts
+ * Coverage: sequential reads in small chunks, straight through read_data as file_read
+ *           used to, and through an open file with its kept page and read-ahead
+ * Files: file_system.c, page_cache.c
+ */
+#define READ_BENCH_PASSES	32
+int file_read_benchmark() {
+	static uint8_t buf[1024];
+	static int32_t chunks[] = { 64, 1024 };
+	file_descriptor_entry_t entry;
+	dir_entry_t dentry;
+	uint32_t start, old_cycles, new_cycles, pos, length, pass, c;
+	int32_t ret;
+
+	if (read_dentry_by_name((uint8_t*)"fish", &dentry) == -1) {
+		return 0;
+	}
+	length = fs_file_length(dentry.inode);
+
+	for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+		start = rdtsc_low();
+		for (pass = 0; pass < READ_BENCH_PASSES; pass++) {
+			for (pos = 0; (ret = read_data(dentry.inode, pos, buf, chunks[c])) > 0; pos += ret);
+		}
+		old_cycles = rdtsc_low() - start;
+
+		start = rdtsc_low();
+		for (pass = 0; pass < READ_BENCH_PASSES; pass++) {
+			memset(&entry, 0, sizeof(entry));
+			entry.inode = dentry.inode;
+			entry.flags = FD_IN_USE;
+			while (file_read_entry(&entry, buf, chunks[c]) > 0);
+			page_put(entry.ra.page);
+		}
+		new_cycles = rdtsc_low() - start;
+
+		printf("%d byte reads of %u bytes: read_data %u cycles, file_read %u cycles\n",
+			chunks[c], length * READ_BENCH_PASSES, old_cycles, new_cycles);
+	}
+	return 0;
+}
+
+/* slab_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: objects of a cache are distinct and aligned, a full slab makes a new one,
+ *           freed objects are reused, empty slabs go back to the frame pool, kmalloc classes
+ * Files: slab.c
+ */
+#define SLAB_TEST_OBJS	200
+int slab_test() {
+	static kmem_cache_t cache;
+	static uint8_t* objs[SLAB_TEST_OBJS];
+	uint8_t* p;
+	int i;
+
+	if (kmem_cache_init(&cache, "slab_test", 0) != -1 || kmem_cache_init(&cache, "slab_test", 100) != 0 || cache.size != 104) {
+		return FAIL;
+	}
+	for (i = 0; i < SLAB_TEST_OBJS; i++) {
+		objs[i] = kmem_cache_alloc(&cache);
+		if (objs[i] == NULL || (uint32_t)objs[i] % SLAB_ALIGN != 0) {
+			return FAIL;
+		}
+		memset(objs[i], i, 100);
+	}
+	if (cache.active != SLAB_TEST_OBJS || cache.slabs != (SLAB_TEST_OBJS + cache.per_slab - 1) / cache.per_slab) {
+		return FAIL;
+	}
+	for (i = 0; i < SLAB_TEST_OBJS; i++) {
+		if (objs[i][0] != (uint8_t)i || objs[i][99] != (uint8_t)i) {
+			return FAIL;	// two objects overlap
+		}
+	}
+	p = objs[5];
+	kfree(objs[5]);
+	if (kmem_cache_alloc(&cache) != p) {
+		return FAIL;
+	}
+	for (i = 0; i < SLAB_TEST_OBJS; i++) {
+		kmem_cache_free(&cache, objs[i]);
+	}
+	if (cache.active != 0 || cache.slabs != SLAB_KEEP_EMPTY || cache.frees != SLAB_TEST_OBJS + 1) {
+		return FAIL;
+	}
+
+	if (kmalloc(0) != NULL || kmalloc(KMALLOC_MAX + 1) != NULL) {
+		return FAIL;
+	}
+	for (i = 1; i <= KMALLOC_MAX; i *= 3) {
+		p = kmalloc(i);
+		if (p == NULL || ((slab_t*)((uint32_t)p & ~(SLAB_SIZE - 1)))->cache->size < i) {
+			return FAIL;
+		}
+		memset(p, 0, i);
+		kfree(p);
+	}
+	return PASS;
+}
+
+/* slab_benchmark
+ * 
+ * Inputs: None
+ * Outputs: return 0;
+ * Side Effects: prints the cycle counts
+ * Coverage: allocating and freeing small objects from a cache, and whole frames
+ * Files: slab.c, paging.c
+ */
+#define SLAB_BENCH_OBJS		256
+#define SLAB_BENCH_ROUNDS	64
+int slab_benchmark() {
+	static kmem_cache_t cache;
+	static void* objs[SLAB_BENCH_OBJS];
+	uint32_t start, slab_cycles, kmalloc_cycles, frame_cycles, round, i;
+
+	kmem_cache_init(&cache, "slab_bench", 64);
+
+	start = rdtsc_low();
+	for (round = 0; round < SLAB_BENCH_ROUNDS; round++) {
+		for (i = 0; i < SLAB_BENCH_OBJS; i++) objs[i] = kmem_cache_alloc(&cache);
+		for (i = 0; i < SLAB_BENCH_OBJS; i++) kmem_cache_free(&cache, objs[i]);
+	}
+	slab_cycles = rdtsc_low() - start;
+
+	start = rdtsc_low();
+	for (round = 0; round < SLAB_BENCH_ROUNDS; round++) {
+		for (i = 0; i < SLAB_BENCH_OBJS; i++) objs[i] = kmalloc(64);
+		for (i = 0; i < SLAB_BENCH_OBJS; i++) kfree(objs[i]);
+	}
+	kmalloc_cycles = rdtsc_low() - start;
+
+	start = rdtsc_low();
+	for (round = 0; round < SLAB_BENCH_ROUNDS; round++) {
+		for (i = 0; i < SLAB_BENCH_OBJS; i++) objs[i] = frame_alloc(1);
+		for (i = 0; i < SLAB_BENCH_OBJS; i++) frame_free(objs[i], 1);
+	}
+	frame_cycles = rdtsc_low() - start;
+
+	printf("%u alloc/free pairs: cache %u cycles, kmalloc %u cycles, frame_alloc %u cycles\n",
+		SLAB_BENCH_OBJS * SLAB_BENCH_ROUNDS, slab_cycles, kmalloc_cycles, frame_cycles);
+	return 0;
+}
+
+/* frame_alloc_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: frames are aligned to their buddy block and don't overlap, the frames past
+ *           count are given back, bad frees are ignored, 4MB program frames
+ * Files: frame.c
+ */
+#define FRAME_TEST_BLOCKS	9
+int frame_alloc_test() {
+	uint8_t* blocks[FRAME_TEST_BLOCKS];
+	uint32_t i, j, size, frees, a, b;
+
+	if (frame_alloc(0) != NULL || frame_alloc((1 << FRAME_MAX_ORDER) + 1) != NULL) {
+		return FAIL;
+	}
+	for (i = 0; i < FRAME_TEST_BLOCKS; i++) {
+		blocks[i] = frame_alloc(i + 1);
+		for (size = 1; size < i + 1; size <<= 1);
+		if (blocks[i] == NULL || (uint32_t)blocks[i] % (size * FOUR_K_BYTE) != 0 ||
+			!frame_in_use(blocks[i]) || !frame_in_use(blocks[i] + i * FOUR_K_BYTE)) {
+			return FAIL;
+		}
+		memset(blocks[i], i, (i + 1) * FOUR_K_BYTE);
+	}
+	for (i = 0; i < FRAME_TEST_BLOCKS; i++) {
+		for (j = 0; j <= i; j++) {
+			if (blocks[i][j * FOUR_K_BYTE] != i || blocks[i][(j + 1) * FOUR_K_BYTE - 1] != i) {
+				return FAIL;	// two blocks overlap
+			}
+		}
+	}
+	// 3 frames take a block of 4, the 4th frame is free again
+	if (frame_in_use(blocks[2] + 3 * FOUR_K_BYTE)) {
+		return FAIL;
+	}
+	frees = frame_frees;
+	for (i = 0; i < FRAME_TEST_BLOCKS; i++) {
+		frame_free(blocks[i], i + 1);
+	}
+	frame_free(blocks[0], 1);
+	frame_free(blocks[1] + 1, 2);
+	if (frame_frees != frees + FRAME_TEST_BLOCKS || frame_in_use(blocks[0])) {
+		return FAIL;
+	}
+
+	a = program_frame_alloc();
+	b = program_frame_alloc();
+	if (a == 0 || b == 0 || a == b || a % PROGRAM_SIZE != 0 || b % PROGRAM_SIZE != 0 || a == EIGHT_MB - PROGRAM_SIZE) {
+		return FAIL;
+	}
+	program_frame_free(a);
+	program_frame_free(b);
+	return PASS;
+}
+
+/* sbrk_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: runs as a made up process, puts the current one back after
+ * Coverage: the heap grows with zeroed pages, stays inside the heap area, system
+ *           calls accept buffers in it, shrinking unmaps the pages
+ * Files: mmap.c, lib.c
+ */
+int sbrk_test() {
+	static pcb_t pcb;
+	pcb_t* saved = get_current_pcb();
+	uint8_t* heap;
+	int result = PASS;
+	int i;
+
+	set_current_pcb(&pcb);
+	mmap_reset(&pcb);
+	heap = (uint8_t*)sbrk(0);
+	if (heap != (uint8_t*)HEAP_ADDR_START || sbrk(5000) != HEAP_ADDR_START || sbrk(0) != HEAP_ADDR_START + 5000) {
+		result = FAIL;
+		goto done;
+	}
+	for (i = 0; i < 2 * FOUR_KB; i++) {
+		if (heap[i] != 0) result = FAIL;
+		heap[i] = i;
+	}
+	if (bad_userspace_addr(heap, 5000) || !bad_userspace_addr(heap, 5001) ||
+		sbrk(HEAP_ADDR_END - HEAP_ADDR_START) != -1 || sbrk(-5001) != -1) {
+		result = FAIL;
+	}
+	if (sbrk(-5000 + FOUR_KB) != HEAP_ADDR_START + 5000 || !pcb.heap_tables[0][0].present || pcb.heap_tables[0][1].present) {
+		result = FAIL;
+	}
+done:
+	mmap_release(&pcb);
+	set_current_pcb(saved);
+	if (saved != NULL) mmap_load(saved);
+	flush_tlb();
+	return result;
+}
+
+/* stack_fault_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: runs as a made up process, puts the current one back after
+ * Coverage: stack pages are mapped zeroed on a fault anywhere above the limit, the
+ *           guard page and addresses outside the stack are not
+ * Files: mmap.c, idt.c
+ */
+int stack_fault_test() {
+	static pcb_t pcb;
+	pcb_t* saved = get_current_pcb();
+	uint32_t* top = (uint32_t*)(STACK_ADDR_END - FOUR_B);
+	uint32_t* bottom = (uint32_t*)(STACK_ADDR_END - STACK_LIMIT);
+	int result = PASS;
+
+	set_current_pcb(&pcb);
+	mmap_reset(&pcb);
+	if (stack_fault((uint32_t)top, PF_WRITE) != 0 || *top != 0 || stack_fault((uint32_t)bottom, PF_WRITE) != 0) {
+		result = FAIL;
+		goto done;
+	}
+	*top = 391;
+	*bottom = 391;
+	if (stack_fault((uint32_t)bottom - 1, PF_WRITE) != -1 || stack_fault(STACK_ADDR_START - 1, PF_WRITE) != -1 ||
+		stack_fault((uint32_t)top, PF_PRESENT | PF_WRITE) != -1 || *top != 391 || *bottom != 391) {
+		result = FAIL;
+	}
+	if (bad_userspace_addr(top, 4) || !bad_userspace_addr(top, 5) || !bad_userspace_addr((uint8_t*)bottom - 1, 1)) {
+		result = FAIL;
+	}
+done:
+	mmap_release(&pcb);
+	set_current_pcb(saved);
+	if (saved != NULL) mmap_load(saved);
+	flush_tlb();
+	return result;
+}
+
+/* signal_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: runs as a made up process, puts the current one back after
+ * Coverage: ignored signals are dropped, blocked ones stay pending, a handled one
+ *           pushes the frame sigtest expects (eax 7 words above signum) and enters the handler
+ * Files: signal.c
+ */
+int signal_test() {
+	static pcb_t pcb;
+	pcb_t* saved = get_current_pcb();
+	hw_context_t ctx;
+	uint32_t* frame;
+	uint32_t top = STACK_ADDR_END - FOUR_B;
+	int result = PASS;
+
+	set_current_pcb(&pcb);
+	mmap_reset(&pcb);
+	signal_reset(&pcb);
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.cs = USER_CS;
+	ctx.esp = top;
+	ctx.eip = VIRTUAL_ADDR_START + PROGRAM_IMAGE_ADDR;
+	ctx.eax = 391;
+
+	pcb.sig_pending = SIGNAL_BIT(SIG_ALARM);
+	signal_check(&ctx);
+	if (pcb.sig_pending != 0 || ctx.esp != top || signal_pending()) {
+		result = FAIL;
+		goto done;
+	}
+
+	pcb.sig_handlers[SIG_USER1] = (void*)(VIRTUAL_ADDR_START + PROGRAM_IMAGE_ADDR + FOUR_KB);
+	pcb.sig_blocked = SIGNAL_BIT(SIG_USER1);
+	pcb.sig_pending = SIGNAL_BIT(SIG_USER1);
+	if (signal_pending()) result = FAIL;
+	pcb.sig_blocked = 0;
+	if (!signal_pending()) result = FAIL;
+
+	signal_check(&ctx);
+	frame = (uint32_t*)ctx.esp;
+	if (ctx.eip != (uint32_t)pcb.sig_handlers[SIG_USER1] || ctx.esp != top - sizeof(hw_context_t) - 4 * FOUR_B ||
+		frame[0] != top - 2 * FOUR_B || frame[1] != SIG_USER1 || *(&frame[1] + 7) != 391 ||
+		pcb.sig_pending != 0 || pcb.sig_blocked != SIGNAL_ALL) {
+		result = FAIL;
+	}
+done:
+	mmap_release(&pcb);
+	set_current_pcb(saved);
+	if (saved != NULL) mmap_load(saved);
+	flush_tlb();
+	return result;
+}
+
+/* clock_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: halts for a few PIT ticks, needs interrupts on
+ * Coverage: a second of TSC cycles converts to a second, the clock never goes back,
+ *           follows the PIT and the time page user programs read is mapped
+ * Files: clock.c
+ */
+int clock_test() {
+	time_page_t* page = (time_page_t*)TIME_PAGE_ADDR;
+	uint64_t start, prev, now;
+	uint32_t ticks = pit_ticks;
+	uint32_t ns;
+	int result = PASS;
+
+	if (clock_tsc_hz() != 0) {
+		ns = (uint32_t)clock_cycles_to_ns(clock_tsc_hz());
+		if (ns < NSEC_PER_SEC - 1000 || ns > NSEC_PER_SEC + 1000 || page->tsc_hz != clock_tsc_hz()) {
+			result = FAIL;
+		}
+	}
+
+	start = prev = clock_ns();
+	while (pit_ticks - ticks < PIT_HZ / 4) {
+		now = clock_ns();
+		if (now < prev) result = FAIL;
+		prev = now;
+	}
+	// a quarter of a second of PIT ticks, give or take a tick
+	now = clock_ns() - start;
+	if (now < (uint64_t)(PIT_HZ / 4 - 1) * (NSEC_PER_SEC / PIT_HZ) || now > (uint64_t)(PIT_HZ / 4 + 1) * (NSEC_PER_SEC / PIT_HZ)) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* timer_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None, uses its own wheel
+ * Coverage: timers in the root and in every outer level run on their tick and not
+ *           before, across the 32-bit wrap, moving and cancelling armed timers
+ * Files: timer.c
+ */
+#define TIMER_TEST_TIMERS	10
+static uint32_t timer_test_ran[TIMER_TEST_TIMERS];
+static timer_wheel_t timer_test_wheel;
+static void timer_test_func(uint32_t i) {
+	timer_test_ran[i] = timer_test_wheel.now;	// one past the tick being run
+}
+int timer_test() {
+	static timer_t timers[TIMER_TEST_TIMERS];
+	static const uint32_t delays[TIMER_TEST_TIMERS] = {
+		0, 1, 255, 256, 300, 16383, 16384, 20000, (1 << 20) + 5, (1 << 20) + 300
+	};
+	uint32_t start = 0xFFFFFF00;	// the wheel wraps around while the test runs
+	uint32_t i;
+	int result = PASS;
+
+	timer_wheel_init(&timer_test_wheel, start);
+	for (i = 0; i < TIMER_TEST_TIMERS; i++) {
+		timer_test_ran[i] = 0;
+		timer_init(&timers[i], timer_test_func, i);
+		timer_wheel_add(&timer_test_wheel, &timers[i], start + 1);	// moved below
+		timer_wheel_add(&timer_test_wheel, &timers[i], start + delays[i]);
+	}
+	if (timer_cancel(&timers[TIMER_TEST_TIMERS - 1]) != 1 || timer_cancel(&timers[TIMER_TEST_TIMERS - 1]) != 0) {
+		return FAIL;
+	}
+
+	for (i = 0; i < TIMER_TEST_TIMERS - 1; i++) {
+		if (delays[i] > 0) timer_wheel_run(&timer_test_wheel, start + delays[i] - 1);
+		if (timer_test_ran[i] != 0 || !timer_pending(&timers[i])) result = FAIL;
+		timer_wheel_run(&timer_test_wheel, start + delays[i]);
+		if (timer_test_ran[i] != start + delays[i] + 1 || timer_pending(&timers[i])) result = FAIL;
+	}
+	timer_wheel_run(&timer_test_wheel, start + delays[TIMER_TEST_TIMERS - 1]);
+	if (timer_test_ran[TIMER_TEST_TIMERS - 1] != 0) result = FAIL;
+	return result;
+}
+
+/* timer_benchmark
+ * 
+ * Inputs: None
+ * Outputs: return 0;
+ * Side Effects: prints the cycle counts, halts for about two seconds, needs interrupts on
+ * Coverage: cost of arming and cancelling timers and of a PIT tick with thousands of
+ *           timers armed, and how many ticks late they ran
+ * Files: timer.c, pit.c
+ */
+#define TIMER_BENCH_TIMERS	4096
+static volatile uint32_t timer_bench_ran;
+static volatile uint32_t timer_bench_late;
+static timer_t timer_bench_timers[TIMER_BENCH_TIMERS];
+static void timer_bench_func(uint32_t i) {
+	uint32_t late = pit_ticks - timer_bench_timers[i].expires;
+
+	if (late > timer_bench_late) timer_bench_late = late;
+	++timer_bench_ran;
+}
+int timer_benchmark() {
+	uint32_t start, add_cycles, cancel_cycles, i, seed = 391;
+
+	for (i = 0; i < TIMER_BENCH_TIMERS; i++) timer_init(&timer_bench_timers[i], timer_bench_func, i);
+
+	// armed and cancelled far enough out that none of them runs
+	start = rdtsc_low();
+	for (i = 0; i < TIMER_BENCH_TIMERS; i++) timer_add(&timer_bench_timers[i], 1000 + i * 37);
+	add_cycles = rdtsc_low() - start;
+	start = rdtsc_low();
+	for (i = 0; i < TIMER_BENCH_TIMERS; i++) timer_cancel(&timer_bench_timers[i]);
+	cancel_cycles = rdtsc_low() - start;
+
+	timer_bench_ran = 0;
+	timer_bench_late = 0;
+	timer_ticks_run = timer_cycles_total = timer_cycles_max = 0;
+	for (i = 0; i < TIMER_BENCH_TIMERS; i++) {
+		seed = seed * 1103515245 + 12345;
+		timer_add(&timer_bench_timers[i], 1 + (seed >> 16) % (2 * PIT_HZ));
+	}
+	while (timer_bench_ran < TIMER_BENCH_TIMERS) asm volatile ("hlt");
+
+	printf("%u timers: add %u cycles, cancel %u cycles each\n", TIMER_BENCH_TIMERS,
+		add_cycles / TIMER_BENCH_TIMERS, cancel_cycles / TIMER_BENCH_TIMERS);
+	printf("%u ticks: %u cycles average, %u max, latest timer %u ticks late\n", timer_ticks_run,
+		timer_cycles_total / timer_ticks_run, timer_cycles_max, timer_bench_late);
+	return 0;
+}
+
+/* softirq_benchmark
+ * 
+ * Inputs: None
+ * Outputs: return 0;
+ * Side Effects: prints the cycle counts, halts for about five seconds while
+ *               keys are typed, needs interrupts on
+ * Coverage: the longest the keyboard interrupt handler keeps interrupts off,
+ *           against the longest the decoding it defers takes, which used to
+ *           run with interrupts off too
+ * Files: softirq.c, keyboard.c, pit.c
+ */
+#define SOFTIRQ_BENCH_SECONDS	5
+int softirq_benchmark() {
+	static const char* names[NUM_SOFTIRQS] = { "timer", "keyboard", "klog" };
+	uint32_t end, nr;
+
+	kb_irq_cycles_max = 0;
+	for (nr = 0; nr < NUM_SOFTIRQS; nr++) softirq_runs[nr] = softirq_cycles_max[nr] = 0;
+	printf("type for %u seconds\n", SOFTIRQ_BENCH_SECONDS);
+	end = pit_ticks + SOFTIRQ_BENCH_SECONDS * PIT_HZ;
+	while ((int32_t)(end - pit_ticks) > 0) asm volatile ("hlt");
+
+	printf("\nkeyboard interrupt: %u cycles max with interrupts off\n", kb_irq_cycles_max);
+	for (nr = 0; nr < NUM_SOFTIRQS; nr++) {
+		printf("%s softirq: %u runs, %u cycles max with interrupts on\n", names[nr],
+			softirq_runs[nr], softirq_cycles_max[nr]);
+	}
+	return 0;
+}
+
+/* irqtrace_test
+ * 
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: keeps interrupts off for a few thousand cycles
+ * Coverage: a stretch with interrupts off goes to the site that began it, a
+ *           nested cli_and_save and restore_flags neither begins nor ends one
+ * Files: irqtrace.c, lib.h
+ */
+#define IRQTRACE_TEST_CYCLES	5000
+int irqtrace_test() {
+	static irqtrace_site_t site = { __FILE__, __LINE__, "irqtrace_test" };
+	uint32_t start, bucket, total = 0;
+	long flags, inner;
+	int result = PASS;
+
+	cli_and_save(flags);
+	irqtrace_off(&site);
+	start = rdtsc_low();
+	while (rdtsc_low() - start < IRQTRACE_TEST_CYCLES);
+	cli_and_save(inner);
+	restore_flags(inner);
+	irqtrace_on();
+	irqtrace_on();		// nothing is open any more
+	restore_flags(flags);
+
+	if (site.id == 0 || site.stat.count != 1) result = FAIL;
+	if (site.stat.max < IRQTRACE_TEST_CYCLES || site.stat.total != site.stat.max) result = FAIL;
+	for (bucket = 0; bucket < IRQTRACE_BUCKETS; bucket++) total += site.stat.hist[bucket];
+	if (total != 1) result = FAIL;
+	return result;
+}
 
 /* Test suite entry point */
 void launch_tests(){
@@ -613,4 +1825,33 @@ void launch_tests(){
 	// read_data_test2();
 	// read_data_test3();
 	// read_directories_test();
+
+	// TEST_OUTPUT("rtc_poll_test", rtc_poll_test());
+	// TEST_OUTPUT("terminal_create_test", terminal_create_test());
+	// scroll_benchmark();
+	// TEST_OUTPUT("snprintf_test", snprintf_test());
+	// TEST_OUTPUT("serial_write_test", serial_write_test());
+	// TEST_OUTPUT("fs_write_test", fs_write_test());
+	// fs_write_benchmark();
+	// TEST_OUTPUT("extent_inode_test", extent_inode_test());
+	// TEST_OUTPUT("path_lookup_test", path_lookup_test());
+	// TEST_OUTPUT("page_cache_test", page_cache_test());
+	// TEST_OUTPUT("fs_data_block_test", fs_data_block_test());
+	// file_read_benchmark();
+	// TEST_OUTPUT("getdents_test", getdents_test());
+	// TEST_OUTPUT("file_seek_test", file_seek_test());
+	// TEST_OUTPUT("file_write_check_test", file_write_check_test());
+	// TEST_OUTPUT("lz_decompress_test", lz_decompress_test());
+	// TEST_OUTPUT("fs_mount_check_test", fs_mount_check_test());
+	// TEST_OUTPUT("slab_test", slab_test());
+	// slab_benchmark();
+	// TEST_OUTPUT("frame_alloc_test", frame_alloc_test());
+	// TEST_OUTPUT("sbrk_test", sbrk_test());
+	// TEST_OUTPUT("stack_fault_test", stack_fault_test());
+	// TEST_OUTPUT("signal_test", signal_test());
+	// TEST_OUTPUT("clock_test", clock_test());
+	// TEST_OUTPUT("timer_test", timer_test());
+	// timer_benchmark();
+	// softirq_benchmark();
+	// TEST_OUTPUT("irqtrace_test", irqtrace_test());
 }
@@ -0,0 +1,224 @@
+#include "timer.h"
+#include "lib.h"
+#include "pit.h"
+
+#define ROOT_MASK       (TIMER_ROOT_SIZE - 1)
+#define LEVEL_MASK      (TIMER_LEVEL_SIZE - 1)
+#define LEVEL_SHIFT(level)  (TIMER_ROOT_BITS + (level) * TIMER_LEVEL_BITS)
+
+timer_wheel_t timer_wheel;
+
+uint32_t timer_ticks_run = 0;
+uint32_t timer_cycles_total = 0;
+uint32_t timer_cycles_max = 0;
+uint32_t timers_fired = 0;
+
+
+/*
+    timer_unlink
+    Description: Takes an armed timer out of its slot
+    Input: timer - an armed timer
+    Output: none
+    Effects: caller must have interrupts disabled
+*/
+static void timer_unlink(timer_t* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/*
+    timer_insert
+    Description: Puts a timer in the slot for its expiry, in the root if it is due
+                 in the next TIMER_ROOT_SIZE ticks, otherwise in the first level
+                 whose slots are coarse enough. Timers already due go in the slot
+                 of the next tick
+    Input: wheel - the wheel
+           timer - a timer that is not armed
+    Output: none
+    Effects: caller must have interrupts disabled
+*/
+static void timer_insert(timer_wheel_t* wheel, timer_t* timer) {
+    uint32_t delta = timer->expires - wheel->now;
+    uint32_t level;
+    timer_t** slot;
+
+    if ((int32_t)delta < 0) {
+        slot = &wheel->root[wheel->now & ROOT_MASK];
+    } else if (delta < TIMER_ROOT_SIZE) {
+        slot = &wheel->root[timer->expires & ROOT_MASK];
+    } else {
+        for (level = 0; level < TIMER_LEVELS - 1 && (delta >> LEVEL_SHIFT(level + 1)) != 0; level++);
+        slot = &wheel->levels[level][(timer->expires >> LEVEL_SHIFT(level)) & LEVEL_MASK];
+    }
+
+    timer->next = *slot;
+    if (*slot != NULL) (*slot)->pprev = &timer->next;
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+/*
+    timer_cascade
+    Description: Moves the timers of a slot of an outer level closer in, now that
+                 the wheel reached the ticks the slot covers
+    Input: wheel - the wheel
+           level - the outer level
+           index - the slot
+    Output: none
+    Effects: caller must have interrupts disabled
+*/
+static void timer_cascade(timer_wheel_t* wheel, uint32_t level, uint32_t index) {
+    timer_t* timer = wheel->levels[level][index];
+    timer_t* next;
+
+    wheel->levels[level][index] = NULL;
+    for (; timer != NULL; timer = next) {
+        next = timer->next;
+        timer->pprev = NULL;
+        timer_insert(wheel, timer);
+    }
+}
+
+
+/*
+    timer_init
+    Input: timer - the timer
+           func - called with data when the timer expires
+           data - passed to func
+    Output: none
+*/
+void timer_init(timer_t* timer, timer_func_t func, uint32_t data) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->func = func;
+    timer->data = data;
+}
+
+/*
+    timer_wheel_init
+    Input: wheel - the wheel
+           now - the next tick it runs
+    Output: none
+    Effects: forgets every timer it held
+*/
+void timer_wheel_init(timer_wheel_t* wheel, uint32_t now) {
+    memset(wheel, 0, sizeof(timer_wheel_t));
+    wheel->now = now;
+}
+
+/*
+    timer_wheel_add
+    Input: wheel - the wheel
+           timer - the timer, armed or not
+           expires - tick to run it at
+    Output: none
+*/
+void timer_wheel_add(timer_wheel_t* wheel, timer_t* timer, uint32_t expires) {
+    long flags;
+
+    cli_and_save(flags);
+    if (timer_pending(timer)) timer_unlink(timer);
+    timer->expires = expires;
+    timer_insert(wheel, timer);
+    restore_flags(flags);
+}
+
+/*
+    timer_wheel_run
+    Description: Turns the wheel one tick at a time up to now. Every TIMER_ROOT_SIZE
+                 ticks the next slot of the first level moves in, and each time a
+                 level wraps the next slot of the level above it does too. The
+                 timers of the root slot of a tick are taken off the wheel first,
+                 so a function may arm or cancel any timer
+    Input: wheel - the wheel
+           now - last tick to run
+    Output: none
+    Effects: timer functions run with interrupts as the caller had them
+*/
+void timer_wheel_run(timer_wheel_t* wheel, uint32_t now) {
+    timer_t* expired;
+    timer_t* timer;
+    uint32_t index, level, slot;
+    long flags;
+
+    cli_and_save(flags);
+    if (wheel->running) {
+        restore_flags(flags);
+        return;
+    }
+    wheel->running = 1;
+
+    while ((int32_t)(now - wheel->now) >= 0) {
+        index = wheel->now & ROOT_MASK;
+        if (index == 0) {
+            for (level = 0; level < TIMER_LEVELS; level++) {
+                slot = (wheel->now >> LEVEL_SHIFT(level)) & LEVEL_MASK;
+                timer_cascade(wheel, level, slot);
+                if (slot != 0) break;
+            }
+        }
+
+        expired = wheel->root[index];
+        wheel->root[index] = NULL;
+        if (expired != NULL) expired->pprev = &expired;
+        ++wheel->now;
+
+        while ((timer = expired) != NULL) {
+            timer_unlink(timer);
+            ++timers_fired;
+            restore_flags(flags);
+            timer->func(timer->data);
+            cli_and_save(flags);
+        }
+    }
+
+    wheel->running = 0;
+    restore_flags(flags);
+}
+
+/*
+    timer_add
+    Input: timer - the timer, armed or not
+           ticks - PIT ticks from now, 0 runs it on the next tick
+    Output: none
+*/
+void timer_add(timer_t* timer, uint32_t ticks) {
+    timer_wheel_add(&timer_wheel, timer, pit_ticks + ticks);
+}
+
+/*
+    timer_cancel
+    Input: timer - the timer
+    Output: 1 if it was armed, 0 if it was not or already ran
+*/
+int32_t timer_cancel(timer_t* timer) {
+    int32_t armed;
+    long flags;
+
+    cli_and_save(flags);
+    armed = timer_pending(timer);
+    if (armed) timer_unlink(timer);
+    restore_flags(flags);
+    return armed;
+}
+
+/*
+    timer_tick
+    Description: Runs the PIT wheel up to the current tick and counts the cycles it took
+    Input: none
+    Output: none
+    Effects: the timer softirq, raised by every PIT tick
+*/
+void timer_tick(void) {
+    uint32_t start = rdtsc_low();
+    uint32_t cycles;
+
+    timer_wheel_run(&timer_wheel, pit_ticks);
+    cycles = rdtsc_low() - start;
+    ++timer_ticks_run;
+    timer_cycles_total += cycles;
+    if (cycles > timer_cycles_max) timer_cycles_max = cycles;
+}
@@ -0,0 +1,74 @@
+/* timer.h - functions called a number of PIT ticks from now
+ * Timers are kept in a hierarchical wheel. Those due in the next 256 ticks
+ * are in the root slot of their tick; later ones are in the coarser slots
+ * of the outer levels and move inward every 256 ticks as the wheel turns.
+ * Adding and cancelling a timer take constant time, and a tick only looks
+ * at one root slot. Expired timers run from the timer softirq the PIT
+ * interrupt raises, with interrupts enabled.
+ */
+
+#ifndef _TIMER_H
+#define _TIMER_H
+
+#include "types.h"
+
+#define TIMER_ROOT_BITS     8
+#define TIMER_LEVEL_BITS    6
+#define TIMER_ROOT_SIZE     (1 << TIMER_ROOT_BITS)
+#define TIMER_LEVEL_SIZE    (1 << TIMER_LEVEL_BITS)
+#define TIMER_LEVELS        4       // outer levels, with the root they cover 2^32 ticks
+
+#ifndef ASM
+
+typedef void (*timer_func_t)(uint32_t data);
+
+typedef struct timer_t {
+    struct timer_t* next;       // other timers in the same slot
+    struct timer_t** pprev;     // what points at this timer, NULL if it is not armed
+    uint32_t expires;           // tick it runs at, less than 2^31 ticks away
+    timer_func_t func;
+    uint32_t data;              // passed to func
+} timer_t;
+
+typedef struct timer_wheel_t {
+    uint32_t now;               // next tick to run
+    uint8_t running;            // expired timers are being run, a nested call returns at once
+    timer_t* root[TIMER_ROOT_SIZE];
+    timer_t* levels[TIMER_LEVELS][TIMER_LEVEL_SIZE];
+} timer_wheel_t;
+
+/* the wheel turned by the PIT, its ticks are pit_ticks */
+extern timer_wheel_t timer_wheel;
+
+/* cost of the PIT ticks, expired timers included */
+extern uint32_t timer_ticks_run;
+extern uint32_t timer_cycles_total;
+extern uint32_t timer_cycles_max;
+extern uint32_t timers_fired;
+
+#define timer_pending(timer)    ((timer)->pprev != NULL)
+
+/* Sets up a timer that is not armed */
+void timer_init(timer_t* timer, timer_func_t func, uint32_t data);
+
+/* Empties a wheel, its next tick is now */
+void timer_wheel_init(timer_wheel_t* wheel, uint32_t now);
+
+/* Arms a timer to run at tick expires of a wheel, moving it if it was armed */
+void timer_wheel_add(timer_wheel_t* wheel, timer_t* timer, uint32_t expires);
+
+/* Runs the timers of a wheel that expire up to tick now */
+void timer_wheel_run(timer_wheel_t* wheel, uint32_t now);
+
+/* Arms a timer ticks PIT ticks from now */
+void timer_add(timer_t* timer, uint32_t ticks);
+
+/* Disarms a timer, 1 if it was armed */
+int32_t timer_cancel(timer_t* timer);
+
+/* Runs the PIT wheel up to pit_ticks, the timer softirq */
+void timer_tick(void);
+
+#endif /* ASM */
+
+#endif /* _TIMER_H */
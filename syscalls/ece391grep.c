@@ -4,60 +4,89 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
-#define SBUFSIZE 33
+#define DIRBUFSIZE 4096     /* holds every entry of the root directory */
 
+/* search the lines of a file that is in memory, lines are printed in place */
 int32_t
-do_one_file (const char* s, const char* fname) 
+do_mapped_file (const char* s, const char* fname, const uint8_t* data,
+		uint32_t len)
 {
-    int32_t fd, cnt, last, line_start, line_end, check, s_len;
-    uint8_t data[BUFSIZE+1];
+    uint32_t line_start, line_end, check, s_len;
 
     s_len = ece391_strlen ((uint8_t*)s);
+    for (line_start = 0; line_start < len; line_start = line_end + 1) {
+	line_end = line_start;
+	while (line_end < len && '\n' != data[line_end])
+	    line_end++;
+	for (check = line_start; check + s_len <= line_end; check++) {
+	    if (s[0] == data[check] &&
+		0 == ece391_strncmp (data + check, (uint8_t*)s, s_len)) {
+		ece391_fdputs (1, (uint8_t*)fname);
+		ece391_fdputs (1, (uint8_t*)":");
+		ece391_write (1, data + line_start, line_end - line_start);
+		ece391_fdputs (1, (uint8_t*)"\n");
+		break;
+	    }
+	}
+    }
+    return 0;
+}
+
+int32_t
+do_one_file (const char* s, const char* fname) 
+{
+    int32_t fd, cnt, last, end, size, i;
+    uint8_t* data;
+    uint8_t* bigger;
+    uint8_t* map;
+    int32_t map_len;
+
     if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
         ece391_fdputs (1, (uint8_t*)"file open failed\n");
         return -1;
     }
+    /* scan the file in place if it can be mapped, otherwise copy it in */
+    if (-1 != (map_len = ece391_mmap (fd, 0, &map))) {
+	ece391_close (fd);
+	do_mapped_file (s, fname, map, map_len);
+	ece391_munmap (map);
+	return 0;
+    }
+    /* the buffer doubles whenever a line does not fit, so lines of any
+       length are searched whole */
+    size = BUFSIZE;
+    if (NULL == (data = ece391_malloc (size))) {
+        ece391_fdputs (1, (uint8_t*)"out of memory\n");
+        return -1;
+    }
     last = 0;
     while (1) {
-        cnt = ece391_read (fd, data + last, BUFSIZE - last);
+	if (last == size) {
+	    if (NULL == (bigger = ece391_realloc (data, 2 * size))) {
+		ece391_fdputs (1, (uint8_t*)"out of memory\n");
+		ece391_free (data);
+		return -1;
+	    }
+	    data = bigger;
+	    size *= 2;
+	}
+        cnt = ece391_read (fd, data + last, size - last);
 	if (-1 == cnt) {
             ece391_fdputs (1, (uint8_t*)"file read failed\n");
+	    ece391_free (data);
             return -1;
 	}
 	last += cnt;
-	line_start = 0;
-	while (1) {
-	    line_end = line_start;
-	    while (line_end < last && '\n' != data[line_end])
-		line_end++;
-	    if ('\n' != data[line_end] && 0 != cnt && line_start != 0) {
-		/* copy from line_start to last down to 0 and fix last */
-		data[line_end] = '\0';
-		ece391_strcpy (data, data + line_start);
-		last -= line_start;
-		break;
-	    }
-	    /* search the line */
-	    data[line_end] = '\0';
-	    for (check = line_start; check < line_end; check++) {
-		if (s[0] == data[check] && 
-		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
-		    ece391_fdputs (1, data + line_start);
-		    ece391_fdputs (1, (uint8_t*)"\n");
-		    break;
-		}
-	    }
-	    line_start = line_end + 1;
-	    if (line_start >= last) {
-	        last = 0;
-		break;
-	    }
-	}
+	/* search the complete lines, keep the partial last one for the next read */
+	for (end = last; 0 != cnt && end > 0 && '\n' != data[end - 1]; end--);
+	do_mapped_file (s, fname, data, end);
+	for (i = end; i < last; i++)
+	    data[i - end] = data[i];
+	last -= end;
 	if (0 == cnt)
 	    break;
     }
+    ece391_free (data);
     if (-1 == ece391_close (fd)) {
         ece391_fdputs (1, (uint8_t*)"file close failed\n");
         return -1;
@@ -67,9 +96,10 @@ do_one_file (const char* s, const char* fname)
 
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, pos;
+    uint8_t buf[DIRBUFSIZE];
     uint8_t search[BUFSIZE];
+    struct ece391_dirent* d;
 
     if (0 != ece391_getargs (search, BUFSIZE)) {
         ece391_fdputs (1, (uint8_t*)"could not read argument\n");
@@ -81,16 +111,18 @@ int main ()
 	return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    while (0 != (cnt = ece391_getdents (fd, buf, DIRBUFSIZE))) {
         if (-1 == cnt) {
 	    ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	    return 3;
 	}
-	if ('.' == buf[0]) /* a directory... */
-	    continue;
-	buf[cnt] = '\0';
-	if (0 != do_one_file ((char*)search, (char*)buf))
-	    return 3;
+	for (pos = 0; pos < cnt; pos += d->reclen) {
+	    d = (struct ece391_dirent*)(buf + pos);
+	    if (STAT_TYPE_FILE != d->type) /* directories and devices */
+		continue;
+	    if (0 != do_one_file ((char*)search, d->name))
+		return 3;
+	}
     }
 
     return 0;
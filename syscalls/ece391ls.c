@@ -3,26 +3,35 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
-#define SBUFSIZE 33
+#define BUFSIZE 1024
+#define DIRBUFSIZE 4096     /* holds every entry of the root directory */
 
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, pos;
+    uint8_t buf[DIRBUFSIZE];
+    uint8_t path[BUFSIZE];
+    struct ece391_dirent* d;
 
-    if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
+    if (0 != ece391_getargs (path, BUFSIZE) || '\0' == path[0])
+        ece391_strcpy (path, (uint8_t*)".");
+
+    if (-1 == (fd = ece391_open (path))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    while (0 != (cnt = ece391_getdents (fd, buf, DIRBUFSIZE))) {
         if (-1 == cnt) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
-	        return 3;
+	    for (pos = 0; pos < cnt; pos += d->reclen) {
+	        d = (struct ece391_dirent*)(buf + pos);
+	        d->name[d->name_len] = '\n';
+	        if (-1 == ece391_write (1, d->name, d->name_len + 1))
+	            return 3;
+	    }
     }
 
     return 0;
@@ -0,0 +1,78 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+#define ROUNDS  16
+
+/* Compares scanning a file through read with scanning it mapped, the two
+ * ways grep can look at a file. Prints the cycles of each for ROUNDS scans. */
+
+static uint32_t
+rdtsc (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
+
+static void
+print_result (const char* name, uint32_t cycles, uint32_t lines)
+{
+    uint8_t num[16];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_itoa (cycles, num, 10);
+    ece391_fdputs (1, num);
+    ece391_fdputs (1, (uint8_t*)" cycles, ");
+    ece391_itoa (lines, num, 10);
+    ece391_fdputs (1, num);
+    ece391_fdputs (1, (uint8_t*)" lines\n");
+}
+
+int main ()
+{
+    int32_t fd, cnt, len, i, round;
+    uint32_t start, lines;
+    uint8_t fname[BUFSIZE];
+    uint8_t buf[BUFSIZE];
+    uint8_t* map;
+
+    if (0 != ece391_getargs (fname, BUFSIZE) || '\0' == fname[0])
+        ece391_strcpy (fname, (uint8_t*)"verylargetextwithverylongname.txt");
+
+    /* copy the file in with read */
+    lines = 0;
+    start = rdtsc ();
+    for (round = 0; round < ROUNDS; round++) {
+	if (-1 == (fd = ece391_open (fname))) {
+	    ece391_fdputs (1, (uint8_t*)"file open failed\n");
+	    return 2;
+	}
+	while (0 < (cnt = ece391_read (fd, buf, BUFSIZE))) {
+	    for (i = 0; i < cnt; i++)
+		lines += ('\n' == buf[i]);
+	}
+	ece391_close (fd);
+    }
+    print_result ("read: ", rdtsc () - start, lines);
+
+    /* scan the file in place */
+    lines = 0;
+    start = rdtsc ();
+    for (round = 0; round < ROUNDS; round++) {
+	fd = ece391_open (fname);
+	if (-1 == (len = ece391_mmap (fd, 0, &map))) {
+	    ece391_fdputs (1, (uint8_t*)"mmap failed\n");
+	    return 3;
+	}
+	ece391_close (fd);
+	for (i = 0; i < len; i++)
+	    lines += ('\n' == map[i]);
+	ece391_munmap (map);
+    }
+    print_result ("mmap: ", rdtsc () - start, lines);
+
+    return 0;
+}
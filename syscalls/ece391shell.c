@@ -5,15 +5,30 @@
 
 #define BUFSIZE 1024
 
+static volatile int32_t interrupted = 0;
+
+/* Ctrl+C at the prompt only throws away the line being typed */
+static void
+interrupt_sighandler (int signum)
+{
+    interrupted = 1;
+}
+
 int main ()
 {
     int32_t cnt, rval;
     uint8_t buf[BUFSIZE];
+    uint8_t* path;
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
+    ece391_set_handler (INTERRUPT, interrupt_sighandler);
 
     while (1) {
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
+	    if (interrupted) {
+		interrupted = 0;
+		continue;
+	    }
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
 	    return 3;
 	}
@@ -24,6 +39,21 @@ int main ()
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
+	if (0 == ece391_strncmp (buf, (uint8_t*)"cd", 2) &&
+	    ('\0' == buf[2] || ' ' == buf[2])) {
+	    for (path = buf + 2; ' ' == *path; path++);
+	    if ('\0' == *path)
+	        path = (uint8_t*)"/";
+	    if (-1 == ece391_chdir (path))
+	        ece391_fdputs (1, (uint8_t*)"no such directory\n");
+	    continue;
+	}
+	if (0 == ece391_strncmp (buf, (uint8_t*)"mkdir ", 6)) {
+	    for (path = buf + 6; ' ' == *path; path++);
+	    if (-1 == ece391_mkdir (path))
+	        ece391_fdputs (1, (uint8_t*)"mkdir failed\n");
+	    continue;
+	}
 	rval = ece391_execute (buf);
 	if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
@@ -1,6 +1,10 @@
 #if !defined(ECE391SUPPORT_H)
 #define ECE391SUPPORT_H
 
+#if !defined(NULL)
+#define NULL ((void*)0)
+#endif
+
 extern uint32_t ece391_strlen(const uint8_t* s);
 extern void ece391_strcpy(uint8_t* dst, const uint8_t* src);
 extern void ece391_fdputs(int32_t fd, const uint8_t* s);
@@ -9,5 +13,14 @@ extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
 
+/* heap memory from sbrk, NULL if the heap is full */
+extern void* ece391_malloc(uint32_t size);
+extern void ece391_free(void* ptr);
+extern void* ece391_realloc(void* ptr, uint32_t size);
+
+/* clock_gettime through the kernel's time page, without a system call */
+struct ece391_timespec;
+extern int32_t ece391_vclock_gettime(struct ece391_timespec* ts);
+
 #endif /* ECE391SUPPORT_H */
 
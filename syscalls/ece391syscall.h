@@ -5,6 +5,53 @@
 
 /* All calls return >= 0 on success or -1 on failure. */
 
+#define O_NONBLOCK  0x2
+#define O_APPEND    0x4
+
+#define F_GETFL     3
+#define F_SETFL     4
+
+#define POLLIN      0x01
+#define POLLOUT     0x04
+#define POLLNVAL    0x20
+
+#define SEEK_SET    0
+#define SEEK_CUR    1
+#define SEEK_END    2
+
+#define STAT_TYPE_RTC       0
+#define STAT_TYPE_DIR       1
+#define STAT_TYPE_FILE      2
+#define STAT_TYPE_DEVICE    3
+
+struct ece391_pollfd {
+	int32_t fd;
+	int16_t events;
+	int16_t revents;
+};
+
+/* getdents record, the next one starts reclen bytes after this one */
+struct ece391_dirent {
+	uint16_t reclen;
+	uint8_t name_len;
+	uint8_t type;		/* STAT_TYPE_* */
+	uint32_t inode;
+	uint32_t size;
+	char name[0];		/* name_len bytes and a '\0' */
+};
+
+struct ece391_timespec {
+	uint32_t tv_sec;
+	uint32_t tv_nsec;	/* less than 1000000000 */
+};
+
+struct ece391_stat {
+	uint32_t inode;
+	uint32_t type;
+	uint32_t length;
+	uint32_t blocks;
+};
+
 /*  
  * Note that the system call for halt will have to make sure that only
  * the low byte of EBX (the status argument) is returned to the calling
@@ -22,6 +69,81 @@ extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
 
+/*
+ * poll waits until one of the descriptors is ready; timeout is in
+ * milliseconds, 0 returns at once and -1 waits forever.  fcntl with
+ * F_SETFL and O_NONBLOCK makes read return -1 instead of waiting.
+ */
+extern int32_t ece391_poll (struct ece391_pollfd* fds, int32_t nfds, int32_t timeout);
+extern int32_t ece391_fcntl (int32_t fd, int32_t cmd, int32_t arg);
+
+/*
+ * create makes an empty file, or empties an existing one, and opens it.
+ * write extends files; with O_APPEND set through fcntl every write goes
+ * to the end.  truncate sets the length of an open file.
+ */
+extern int32_t ece391_create (const uint8_t* filename);
+extern int32_t ece391_truncate (int32_t fd, uint32_t length);
+
+/*
+ * Names given to open, execute, create, chdir and mkdir may be paths:
+ * '/' separated and absolute if they start with '/', otherwise from the
+ * working directory.  execute also finds plain names in the root.
+ */
+extern int32_t ece391_chdir (const uint8_t* path);
+extern int32_t ece391_mkdir (const uint8_t* path);
+
+/*
+ * mmap maps the first length bytes of an open file (all of it if length
+ * is 0) read-only, sets *addr to the start and returns the number of
+ * bytes mapped.  The mapping stays valid after the file is closed, until
+ * munmap or halt.
+ */
+extern int32_t ece391_mmap (int32_t fd, uint32_t length, uint8_t** addr);
+extern int32_t ece391_munmap (void* addr);
+
+/*
+ * lseek moves the position of a regular file and returns it.  pread
+ * reads at offset without using or moving the position.  fstat works on
+ * any open descriptor.
+ */
+extern int32_t ece391_lseek (int32_t fd, int32_t offset, int32_t whence);
+extern int32_t ece391_pread (int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+extern int32_t ece391_fstat (int32_t fd, struct ece391_stat* st);
+
+/*
+ * getdents fills buf with as many ece391_dirent records of an open
+ * directory as fit, and returns the bytes filled, 0 after the last entry.
+ */
+extern int32_t ece391_getdents (int32_t fd, void* buf, int32_t nbytes);
+
+/*
+ * sbrk moves the end of the heap by increment bytes, a negative increment
+ * gives memory back.  It returns the old end, so the new memory starts
+ * there, or (void*)-1 if the heap is full.  New heap memory is zeroed.
+ */
+extern void* ece391_sbrk (int32_t increment);
+
+/*
+ * set_handler installs a handler for a signal, NULL restores the default:
+ * DIV_ZERO, SEGFAULT and INTERRUPT (Ctrl+C) kill the program, ALARM and
+ * USER1 are ignored.  The handler gets the signal number and the saved
+ * registers above it; sigreturn is called for it when it returns.  A
+ * read, poll or RTC read waiting when a signal comes in returns -1.
+ * alarm sends ALARM once after ms milliseconds, 0 cancels it; it returns
+ * the milliseconds that were left of the previous alarm.
+ */
+extern int32_t ece391_alarm (uint32_t ms);
+
+/*
+ * clock_gettime gives the time since boot, counted by the TSC.
+ * ece391_vclock_gettime in the support library reads the same clock
+ * without a system call.  nanosleep waits at least req; it returns -1
+ * early if a signal comes in.
+ */
+extern int32_t ece391_clock_gettime (struct ece391_timespec* ts);
+extern int32_t ece391_nanosleep (const struct ece391_timespec* req);
+
 enum signums {
 	DIV_ZERO = 0,
 	SEGFAULT,
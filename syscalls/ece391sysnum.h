@@ -11,5 +11,21 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_POLL    11
+#define SYS_FCNTL   12
+#define SYS_CREATE  13
+#define SYS_TRUNCATE 14
+#define SYS_CHDIR   15
+#define SYS_MKDIR   16
+#define SYS_MMAP    17
+#define SYS_MUNMAP  18
+#define SYS_LSEEK   19
+#define SYS_PREAD   20
+#define SYS_FSTAT   21
+#define SYS_GETDENTS 22
+#define SYS_SBRK    23
+#define SYS_ALARM   24
+#define SYS_CLOCK_GETTIME 25
+#define SYS_NANOSLEEP 26
 
 #endif /* ECE391SYSNUM_H */